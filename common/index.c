@@ -2,66 +2,1553 @@
  * index.c - Tiny search engine index data structure
  *
  * Creates an index struct that is a hashtable of
- * counters for words
+ * counters for words. The words and counters are
+ * allocated from two arenas, so building the index
+ * makes few calls to malloc, and deleting it frees
+ * whole blocks at once.
+ *
+ * An index can be saved as text, one word per line, or in a binary
+ * format that stores each word's docIDs as varint-encoded gaps;
+ * index_load tells the two apart by the binary format's magic bytes.
+ * The binary format ends with a front-coded lexicon mapping each word
+ * to where its postings start, so index_map can map the file and
+ * search it in place instead of loading anything.  A text index is
+ * read into memory whole, split at line boundaries, and parsed by
+ * several threads at once.
+ *
+ * Deleting a document only sets its bit in a bitmap of deleted
+ * docIDs, which index_postings hands to the cursors so they skip it;
+ * its postings go when the index is next saved or merged.  A binary
+ * file carries the bitmap in its header, one bit for every docID up
+ * to the highest, so index_markDeleted can set a bit in place.
+ *
+ * The index also keeps statistics for scoring and query planning:
+ * the number of words indexed from each document, their total, and
+ * for each word its document and collection frequencies.  A binary
+ * file stores them, so a mapped index reads them in place.
  * 
  * Jake Fleming - 10/28/24
  */
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include "../libcs50/hashtable.h"
-#include "../libcs50/counters.h"
-#include "word.h"
-#include "index.h"
+#define _POSIX_C_SOURCE 200809L     // mmap, open, fstat
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include "../libcs50/hashtable.h"
+#include "../libcs50/counters.h"
+#include "../libcs50/arena.h"
+#include "../libcs50/file.h"
+#include "../libcs50/varint.h"
+#include "../libcs50/crc32.h"
+#include "../libcs50/fasthash.h"
+#include "../libcs50/mem.h"
+#include "word.h"
+#include "postings.h"
+#include "lexicon.h"
+#include "index.h"
+
+/**************** local types ****************/
+
+struct index {
+    hashtable_t* hashtable;     // word -> counters_t of (docID, count)
+    arena_t* keys;              // holds the words
+    arena_t* postings;          // holds the counters
+    arena_t** loaded;           // more counters, one arena per load thread
+    int numLoaded;
+    int numDocs;                // highest docID in the index
+    unsigned char* deleted;     // bit d set if docID d is deleted, or NULL;
+    int deletedBytes;           // points into the file if mapped
+
+    // statistics, not counting deleted documents
+    int* lengths;               // words indexed from each docID, or NULL
+    int lengthsSize;            // entries in lengths
+    int numLive;                // documents with a nonzero length
+    int64_t numTokens;          // the sum of their lengths
+    bool statsStale;            // mapped: deletions not yet taken off
+    const unsigned char* mapLengths;    // mapped: 4-byte lengths of
+    int mapFirst;                       // docIDs mapFirst on,
+    int mapCount;                       // mapCount of them
+
+    // an index from index_map has no hashtable, only these
+    const unsigned char* map;   // the whole file, mapped read-only
+    size_t mapSize;
+    lexicon_t* lexicon;         // word -> file offset of its postings
+    const unsigned char* recordsEnd;    // postings stop here
+};
+
+// the header of a binary index, as parse_header finds it
+typedef struct binheader {
+    uint64_t numWords;
+    uint64_t numDocs;           // highest docID
+    const unsigned char* deleted;       // bitmap of deleted docIDs
+    uint64_t deletedBytes;
+    uint64_t numLive;           // documents with postings
+    uint64_t numTokens;         // their total length
+    uint64_t firstLength;       // docID of the first stored length
+    uint64_t numLengths;        // how many are stored
+    const unsigned char* lengths;       // 4 bytes each, little-endian
+} binheader_t;
+
+// one word and its counters, for saving words in sorted order
+typedef struct wordentry {
+    const char* word;
+    counters_t* counter;
+} wordentry_t;
+
+typedef struct wordlist {
+    wordentry_t* entries;
+    int count;
+} wordlist_t;
+
+// what a full load of a binary index needs while walking its lexicon
+typedef struct binload {
+    index_t* index;
+    const unsigned char* bytes; // the file, minus its magic bytes
+    uint64_t start;             // lowest offset a word's postings may have
+    uint64_t end;               // postings stop at this offset
+    counters_t* counter;        // the current word's counters
+    uint64_t decoded;           // postings decoded for the current word
+    bool ok;
+} binload_t;
+
+// one line of a text index, parsed by a load thread
+typedef struct textline {
+    const char* word;           // inside the file's bytes
+    counters_t* counter;        // in the thread's arena
+} textline_t;
+
+// one load thread's share of a text index, and what it made of it
+typedef struct textchunk {
+    char* start;                // from the start of a line...
+    char* end;                  // ...to just past a newline, or the end
+    arena_t* arena;             // holds the chunk's counters
+    textline_t* lines;
+    int count;
+    int capacity;
+    int numDocs;                // highest docID in the chunk
+    bool ok;
+} textchunk_t;
+
+// bytes waiting to be written to a binary index file
+typedef struct outbuf {
+    FILE* fp;
+    unsigned char* bytes;
+    size_t len;
+    size_t capacity;
+    uint64_t written;           // bytes already written to fp
+    uint32_t crc;               // CRC-32 of the bytes written so far
+    bool ok;                    // false once any write has failed
+} outbuf_t;
+
+// one word's postings, gathered from its counters for encoding
+typedef struct postlist {
+    int* docIDs;
+    int* counts;
+    int count;
+    int capacity;
+    bool ok;
+} postlist_t;
+
+// a binary index being written, one word at a time in sorted order;
+// a text merge uses it too, without the lexicon builder
+typedef struct binwriter {
+    outbuf_t out;
+    lexbuilder_t* builder;      // each word's postings offset
+    postlist_t postings;        // the postings of the next word to write
+} binwriter_t;
+
+// one input of a merge, and the word its lexicon cursor is on
+typedef struct mergeinput {
+    index_t* index;
+    lexcursor_t* cursor;
+    const char* word;           // NULL once the lexicon is used up
+    uint64_t offset;            // where word's postings are
+    bool matched;               // word is the one being merged
+} mergeinput_t;
+
+// the mapped indexes a merge reads, and the format it writes
+typedef struct mergejob {
+    index_t** indexes;
+    int n;
+    bool anyDeleted;            // some input has a deleted document
+    index_format_t format;
+} mergejob_t;
+
+// one merge thread's share of index_mergeParts: the words whose hash
+// is slice modulo slices, from all the parts, merged into out
+typedef struct partmerge {
+    index_t** parts;
+    int n;
+    int slice;
+    int slices;
+    int current;                // the part being walked
+    index_t* out;
+    counters_t** sources;       // the current word's counters,
+    int* owners;                // the parts they are from,
+    int* next;                  // and the merge's position in each
+    bool ok;
+} partmerge_t;
+
+// a word's counters, while dropping the postings of deleted documents
+typedef struct purge {
+    index_t* index;
+    counters_t* counter;
+} purge_t;
+
+// an index and a format to save it in, for write_atomically
+typedef struct savejob {
+    index_t* index;
+    index_format_t format;
+} savejob_t;
+
+/**************** local constants ****************/
+// the binary format starts with these bytes; the first is not ASCII,
+// so a text index can never be mistaken for a binary one
+static const unsigned char BINARY_MAGIC[8] = { 0x89, 'T', 'S', 'E', 'I', 'D', 'X', '\n' };
+static const uint64_t BINARY_VERSION = 6;
+static const size_t TRAILER_SIZE = 8;       // the lexicon's offset, at the end
+static const size_t FLUSH_SIZE = 65536;     // write out the buffer past this
+static const size_t MIN_CHUNK = 65536;      // text bytes worth a load thread
+#define MAX_LOAD_THREADS 64
+static const char TEXT_FOOTER[] = "#crc32 ";  // then 8 hex digits and a newline
+
+/**************** local functions ****************/
+
+/**************** free_tagged ****************/
+/* mem_free, for memory from the mem_ allocators, but a NULL pointer
+ * is fine here; mem_free counts a free(NULL) as a mistake */
+static void
+free_tagged(void* ptr)
+{
+    if (ptr != NULL) {
+        mem_free(ptr);
+    }
+}
+
+/**************** parse_header ****************/
+/* parse the header of a binary index, which starts at p, just past
+ * the magic bytes, and return where the postings start, or NULL if
+ * it is not a header of the current version */
+static const unsigned char*
+parse_header(const unsigned char* p, const unsigned char* end, binheader_t* header)
+{
+    uint64_t version;
+    if ((p = varint_get(p, end, &version)) == NULL || version != BINARY_VERSION
+        || (p = varint_get(p, end, &header->numWords)) == NULL
+        || header->numWords > INT32_MAX
+        || (p = varint_get(p, end, &header->numDocs)) == NULL
+        || header->numDocs > INT32_MAX
+        || (p = varint_get(p, end, &header->deletedBytes)) == NULL
+        || header->deletedBytes > (uint64_t)(end - p)) {
+        return NULL;
+    }
+    header->deleted = p;
+    p += header->deletedBytes;
+
+    // the statistics block
+    if ((p = varint_get(p, end, &header->numLive)) == NULL
+        || header->numLive > INT32_MAX
+        || (p = varint_get(p, end, &header->numTokens)) == NULL
+        || header->numTokens > INT64_MAX
+        || (p = varint_get(p, end, &header->firstLength)) == NULL
+        || (p = varint_get(p, end, &header->numLengths)) == NULL
+        || header->numLengths > (uint64_t)(end - p) / 4
+        || header->firstLength + header->numLengths > header->numDocs + 1) {
+        return NULL;
+    }
+    header->lengths = p;
+    return p + 4 * header->numLengths;
+}
+
+/**************** doc_length ****************/
+/* the number of words indexed from docID, deleted or not */
+static int
+doc_length(index_t* index, const int docID)
+{
+    if (index->map != NULL) {
+        int i = docID - index->mapFirst;
+        return (i < 0 || i >= index->mapCount) ? 0
+               : (int)le32_get(index->mapLengths + 4 * (size_t)i);
+    }
+    return (docID < 0 || docID >= index->lengthsSize) ? 0 : index->lengths[docID];
+}
+
+/**************** drop_deleted ****************/
+/* take the deleted documents of a mapped index off its totals, once */
+static void
+drop_deleted(index_t* index)
+{
+    for (int i = 0; i < index->deletedBytes; i++) {
+        for (unsigned int bits = index->deleted[i]; bits != 0; bits &= bits - 1) {
+            int length = doc_length(index, 8 * i + __builtin_ctz(bits));
+            if (length > 0) {
+                index->numLive--;
+                index->numTokens -= length;
+            }
+        }
+    }
+    index->statsStale = false;
+}
+
+/**************** add_length ****************/
+/* count n more words indexed from docID, in a built index */
+static bool
+add_length(index_t* index, const int docID, const int n)
+{
+    if (docID >= index->lengthsSize) {
+        int size = (index->lengthsSize == 0) ? 1024 : index->lengthsSize;
+        while (size <= docID) {
+            size *= 2;
+        }
+        int* lengths = mem_realloc_tagged(index->lengths, size * sizeof(int), MEM_INDEX);
+        if (lengths == NULL) {
+            return false;
+        }
+        memset(lengths + index->lengthsSize, 0, (size - index->lengthsSize) * sizeof(int));
+        index->lengths = lengths;
+        index->lengthsSize = size;
+    }
+    if (!postings_isDeleted(index->deleted, index->deletedBytes, docID)) {
+        index->numLive += (index->lengths[docID] == 0 && n > 0);
+        index->numTokens += n;
+    }
+    index->lengths[docID] += n;
+    return true;
+}
+
+/**************** length_posting ****************/
+/* counters_iterate helper: count one posting in its document's length */
+static void
+length_posting(void* arg, const int key, int count)
+{
+    index_t* index = arg;
+    add_length(index, key, count);
+}
+
+/**************** length_word ****************/
+/* hashtable_iterate helper: count one word's postings */
+static void
+length_word(void* arg, const char* key, void* item)
+{
+    counters_iterate(item, arg, length_posting);
+}
+
+/**************** count_lengths ****************/
+/* work out the document lengths from scratch, from the postings */
+static bool
+count_lengths(index_t* index)
+{
+    free_tagged(index->lengths);
+    index->lengths = NULL;
+    index->lengthsSize = 0;
+    index->numLive = 0;
+    index->numTokens = 0;
+    if (!add_length(index, index->numDocs, 0)) {
+        return false;
+    }
+    hashtable_iterate(index->hashtable, index, length_word);
+    return true;
+}
+
+/**************** outbuf_reserve ****************/
+/* make room for n more bytes in the buffer */
+static bool
+outbuf_reserve(outbuf_t* out, size_t n)
+{
+    if (out->len + n <= out->capacity) {
+        return true;
+    }
+    size_t capacity = (out->capacity == 0) ? FLUSH_SIZE : out->capacity;
+    while (capacity < out->len + n) {
+        capacity *= 2;
+    }
+    unsigned char* bytes = realloc(out->bytes, capacity);
+    if (bytes == NULL) {
+        out->ok = false;
+        return false;
+    }
+    out->bytes = bytes;
+    out->capacity = capacity;
+    return true;
+}
+
+/**************** outbuf_bytes ****************/
+/* append n bytes to the buffer */
+static void
+outbuf_bytes(outbuf_t* out, const void* bytes, size_t n)
+{
+    if (outbuf_reserve(out, n)) {
+        memcpy(out->bytes + out->len, bytes, n);
+        out->len += n;
+    }
+}
+
+/**************** outbuf_u64 ****************/
+/* append a fixed-width, little-endian 64-bit number */
+static void
+outbuf_u64(outbuf_t* out, uint64_t value)
+{
+    if (outbuf_reserve(out, 8)) {
+        le64_put(out->bytes + out->len, value);
+        out->len += 8;
+    }
+}
+
+/**************** outbuf_varint ****************/
+/* append one varint to the buffer */
+static void
+outbuf_varint(outbuf_t* out, uint64_t value)
+{
+    if (outbuf_reserve(out, VARINT_MAX)) {
+        out->len += varint_put(out->bytes + out->len, value);
+    }
+}
+
+/**************** put_uint ****************/
+/* write a number in decimal at p, without a trip through printf;
+ * return the number of digits written (at most 10) */
+static inline int
+put_uint(unsigned char* p, unsigned int value)
+{
+    int n = 1;
+    for (unsigned int rest = value / 10; rest != 0; rest /= 10) {
+        n++;
+    }
+    for (int i = n - 1; i >= 0; i--) {
+        p[i] = (unsigned char)('0' + value % 10);
+        value /= 10;
+    }
+    return n;
+}
+
+/**************** outbuf_uint ****************/
+/* append a number in decimal */
+static void
+outbuf_uint(outbuf_t* out, unsigned int value)
+{
+    if (outbuf_reserve(out, 10)) {
+        out->len += put_uint(out->bytes + out->len, value);
+    }
+}
+
+/**************** outbuf_flush ****************/
+/* write the buffered bytes to the file */
+static void
+outbuf_flush(outbuf_t* out)
+{
+    if (out->len > 0 && fwrite(out->bytes, 1, out->len, out->fp) != out->len) {
+        out->ok = false;
+    }
+    out->crc = crc32_update(out->crc, out->bytes, out->len);
+    out->written += out->len;
+    out->len = 0;
+}
+
+/**************** gather_posting ****************/
+/* append one posting to the list, growing it if need be */
+static void
+gather_posting(void* arg, const int key, int count)
+{
+    postlist_t* list = arg;
+    if (count <= 0 || !list->ok) {
+        return;
+    }
+    if (list->count == list->capacity) {
+        int capacity = (list->capacity == 0) ? POSTINGS_BLOCK : 2 * list->capacity;
+        int* docIDs = mem_realloc_tagged(list->docIDs, capacity * sizeof(int), MEM_INDEX);
+        if (docIDs != NULL) {
+            list->docIDs = docIDs;
+        }
+        int* counts = mem_realloc_tagged(list->counts, capacity * sizeof(int), MEM_INDEX);
+        if (counts != NULL) {
+            list->counts = counts;
+        }
+        if (docIDs == NULL || counts == NULL) {
+            list->ok = false;
+            return;
+        }
+        list->capacity = capacity;
+    }
+    list->docIDs[list->count] = key;
+    list->counts[list->count] = count;
+    list->count++;
+}
+
+/**************** postlist_free ****************/
+/* free a list's postings, which gather_posting allocated */
+static void
+postlist_free(postlist_t* list)
+{
+    free_tagged(list->docIDs);
+    free_tagged(list->counts);
+}
+
+/**************** purge_posting ****************/
+/* zero one posting of the word, if its document is deleted */
+static void
+purge_posting(void* arg, const int key, int count)
+{
+    purge_t* purge = arg;
+    if (postings_isDeleted(purge->index->deleted, purge->index->deletedBytes, key)) {
+        counters_set(purge->counter, key, 0);
+    }
+}
+
+/**************** purge_word ****************/
+/* drop the postings of deleted documents from one word */
+static void
+purge_word(void* arg, const char* key, void* item)
+{
+    purge_t* purge = arg;
+    purge->counter = item;
+    counters_iterate(item, purge, purge_posting);
+}
+
+/**************** purge_deleted ****************/
+/* drop the postings of every deleted document, and forget which were
+ * deleted; numDocs still counts them, so they are not indexed again */
+static void
+purge_deleted(index_t* index)
+{
+    if (index->deleted != NULL) {
+        purge_t purge = { index, NULL };
+        hashtable_iterate(index->hashtable, &purge, purge_word);
+        for (int docID = 0; docID < index->lengthsSize; docID++) {
+            if (postings_isDeleted(index->deleted, index->deletedBytes, docID)) {
+                index->lengths[docID] = 0;
+            }
+        }
+        mem_free(index->deleted);
+        index->deleted = NULL;
+        index->deletedBytes = 0;
+    }
+}
+
+/**************** collect_word ****************/
+/* add one word to the list being gathered for sorting, unless it
+ * has no postings left */
+static void
+collect_word(void* arg, const char* key, void* item)
+{
+    wordlist_t* list = arg;
+    if (counters_size(item) == 0) {
+        return;
+    }
+    list->entries[list->count].word = key;
+    list->entries[list->count].counter = item;
+    list->count++;
+}
+
+/**************** compare_words ****************/
+/* order word entries alphabetically */
+static int
+compare_words(const void* a, const void* b)
+{
+    const wordentry_t* first = a;
+    const wordentry_t* second = b;
+    return strcmp(first->word, second->word);
+}
+
+/**************** sort_words ****************/
+/* drop deleted postings, then gather the index's words and their
+ * counters in sorted order; the caller frees list->entries, which is
+ * NULL if out of memory */
+static void
+sort_words(index_t* index, wordlist_t* list)
+{
+    purge_deleted(index);
+    list->entries = malloc((hashtable_size(index->hashtable) + 1) * sizeof(wordentry_t));
+    list->count = 0;
+    if (list->entries != NULL) {
+        hashtable_iterate(index->hashtable, list, collect_word);
+        qsort(list->entries, list->count, sizeof(wordentry_t), compare_words);
+    }
+}
+
+/**************** text_posting ****************/
+/* append " docID count" for one posting */
+static void
+text_posting(void* arg, const int key, int count)
+{
+    outbuf_t* out = arg;
+    if (count > 0 && outbuf_reserve(out, 22)) {
+        unsigned char* p = out->bytes + out->len;
+        unsigned char* start = p;
+        *p++ = ' ';
+        p += put_uint(p, key);
+        *p++ = ' ';
+        p += put_uint(p, count);
+        out->len += p - start;
+    }
+}
+
+/**************** save_text ****************/
+/* write the header line, then a line per word in sorted order with
+ * its postings in increasing docID order, then a footer line holding
+ * the CRC-32 of everything before it */
+static bool
+save_text(index_t* index, FILE* fp)
+{
+    wordlist_t list;
+    sort_words(index, &list);
+    if (list.entries == NULL) {
+        return false;
+    }
+
+    outbuf_t out = { fp, NULL, 0, 0, 0, 0, true };
+    outbuf_bytes(&out, "#index ", 7);
+    outbuf_uint(&out, list.count);
+    outbuf_bytes(&out, " ", 1);
+    outbuf_uint(&out, index->numDocs);
+    outbuf_bytes(&out, "\n", 1);
+    for (int i = 0; i < list.count && out.ok; i++) {
+        outbuf_bytes(&out, list.entries[i].word, strlen(list.entries[i].word));
+        counters_iterate(list.entries[i].counter, &out, text_posting);
+        outbuf_bytes(&out, "\n", 1);
+        if (out.len >= FLUSH_SIZE) {
+            outbuf_flush(&out);
+        }
+    }
+    outbuf_flush(&out);
+
+    char footer[32];
+    int len = snprintf(footer, sizeof(footer), "%s%08x\n", TEXT_FOOTER, (unsigned int)out.crc);
+    outbuf_bytes(&out, footer, len);
+    outbuf_flush(&out);
+
+    free(out.bytes);
+    free(list.entries);
+    return out.ok;
+}
+
+/**************** binwriter_begin ****************/
+/* start a binary index: the magic bytes, then a header of version,
+ * number of words, highest docID, and a bitmap of deleted docIDs with
+ * a bit for each up to the highest, all clear, led by its length;
+ * then the statistics block, with the document lengths of the given
+ * indexes, whose docIDs do not overlap */
+static bool
+binwriter_begin(binwriter_t* writer, FILE* fp, int numWords, int numDocs,
+                index_t** indexes, int n)
+{
+    outbuf_t out = { fp, NULL, 0, 0, 0, 0, true };
+    postlist_t postings = { NULL, NULL, 0, 0, true };
+    writer->out = out;
+    writer->postings = postings;
+    writer->builder = lexbuilder_new();
+    if (writer->builder == NULL) {
+        writer->out.ok = false;
+        return false;
+    }
+    outbuf_bytes(&writer->out, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    outbuf_varint(&writer->out, BINARY_VERSION);
+    outbuf_varint(&writer->out, numWords);
+    outbuf_varint(&writer->out, numDocs);
+    size_t deletedBytes = numDocs / 8 + 1;
+    outbuf_varint(&writer->out, deletedBytes);
+    if (outbuf_reserve(&writer->out, deletedBytes)) {
+        memset(writer->out.bytes + writer->out.len, 0, deletedBytes);
+        writer->out.len += deletedBytes;
+    }
+
+    // the number of documents and words, then the length of each
+    // document from the first to the last with a length, 4 bytes each
+    int first = 0, last = 0, numLive = 0;
+    int64_t numTokens = 0;
+    for (int docID = 1; docID <= numDocs; docID++) {
+        int length = 0;
+        for (int i = 0; i < n; i++) {
+            length += index_docLength(indexes[i], docID);
+        }
+        if (length > 0) {
+            first = (first == 0) ? docID : first;
+            last = docID;
+            numLive++;
+            numTokens += length;
+        }
+    }
+    int numLengths = (first == 0) ? 0 : last - first + 1;
+    outbuf_varint(&writer->out, numLive);
+    outbuf_varint(&writer->out, numTokens);
+    outbuf_varint(&writer->out, first);
+    outbuf_varint(&writer->out, numLengths);
+    if (outbuf_reserve(&writer->out, 4 * (size_t)numLengths)) {
+        for (int docID = first; docID < first + numLengths; docID++) {
+            int length = 0;
+            for (int i = 0; i < n; i++) {
+                length += index_docLength(indexes[i], docID);
+            }
+            le32_put(writer->out.bytes + writer->out.len, length);
+            writer->out.len += 4;
+        }
+    }
+    return writer->out.ok;
+}
+
+/**************** binwriter_word ****************/
+/* append the word's postings, gathered in writer->postings: their
+ * number, the sum of their counts, then the blocks written by
+ * postings_encode */
+static void
+binwriter_word(binwriter_t* writer, const char* word)
+{
+    outbuf_t* out = &writer->out;
+    postlist_t* list = &writer->postings;
+    if (!list->ok || !lexbuilder_add(writer->builder, word, out->written + out->len)) {
+        out->ok = false;
+        return;
+    }
+    int64_t total = 0;
+    for (int i = 0; i < list->count; i++) {
+        total += list->counts[i];
+    }
+    outbuf_varint(out, list->count);
+    outbuf_varint(out, total);
+    if (outbuf_reserve(out, postings_encodedSize(list->docIDs, list->counts, list->count))) {
+        out->len += postings_encode(list->docIDs, list->counts, list->count,
+                                    out->bytes + out->len);
+    }
+    if (out->len >= FLUSH_SIZE) {
+        outbuf_flush(out);
+    }
+    list->count = 0;
+}
+
+/**************** binwriter_finish ****************/
+/* append the lexicon, mapping each word to its postings' offset,
+ * and last the lexicon's own offset; free the writer's memory */
+static bool
+binwriter_finish(binwriter_t* writer)
+{
+    outbuf_t* out = &writer->out;
+    uint64_t lexiconOffset = out->written + out->len;
+    size_t lexiconLen;
+    unsigned char* lexicon = lexbuilder_finish(writer->builder, &lexiconLen);
+    if (lexicon == NULL) {
+        out->ok = false;
+    }
+    else if (out->ok) {
+        outbuf_bytes(out, lexicon, lexiconLen);
+        outbuf_u64(out, lexiconOffset);
+        outbuf_flush(out);
+    }
+    free(lexicon);
+    lexbuilder_delete(writer->builder);
+    postlist_free(&writer->postings);
+    free(out->bytes);
+    return out->ok;
+}
+
+/**************** save_binary ****************/
+/* write every word and its postings, in sorted order */
+static bool
+save_binary(index_t* index, FILE* fp)
+{
+    wordlist_t list;
+    sort_words(index, &list);
+    if (list.entries == NULL) {
+        return false;
+    }
+    binwriter_t writer;
+    bool ok = binwriter_begin(&writer, fp, list.count, index->numDocs, &index, 1);
+    for (int i = 0; i < list.count && ok; i++) {
+        counters_iterate(list.entries[i].counter, &writer.postings, gather_posting);
+        binwriter_word(&writer, list.entries[i].word);
+        ok = writer.out.ok;
+    }
+    ok = binwriter_finish(&writer) && ok;
+    free(list.entries);
+    return ok;
+}
+
+/**************** word_counter ****************/
+/* find the counters for word, creating them if need be */
+static counters_t*
+word_counter(index_t* index, const char* word)
+{
+    counters_t* counter = hashtable_find(index->hashtable, word);
+    if (counter == NULL) {
+        counter = counters_newArena(index->postings);
+        if (counter == NULL) {
+            return NULL;
+        }
+        // nothing to free on failure; the counters live in the arena
+        if (!hashtable_insert(index->hashtable, word, counter)) {
+            return NULL;
+        }
+    }
+    return counter;
+}
+
+/**************** load_posting ****************/
+/* set one decoded posting in the current word's counters */
+static void
+load_posting(void* arg, const int docID, const int count)
+{
+    binload_t* load = arg;
+    counters_set(load->counter, docID, count);
+    load->decoded++;
+    if (docID > load->index->numDocs) {
+        load->index->numDocs = docID;
+    }
+}
+
+/**************** load_word ****************/
+/* decode the postings of one word from the lexicon into the index */
+static void
+load_word(void* arg, const char* word, uint64_t offset)
+{
+    binload_t* load = arg;
+    if (!load->ok) {
+        return;
+    }
+    if (offset < load->start || offset >= load->end) {
+        load->ok = false;
+        return;
+    }
+    const unsigned char* bytes = load->bytes - sizeof(BINARY_MAGIC);
+    const unsigned char* end = bytes + load->end;
+    uint64_t npostings, total;
+    const unsigned char* p = varint_get(bytes + offset, end, &npostings);
+    p = (p == NULL) ? NULL : varint_get(p, end, &total);
+    load->counter = word_counter(load->index, word);
+    if (p == NULL || npostings > INT32_MAX || load->counter == NULL) {
+        load->ok = false;
+        return;
+    }
+    postings_t postings = postings_fromBytes(p, end, (int)npostings);
+    load->decoded = 0;
+    postings_iterate(&postings, load, load_posting);
+    if (load->decoded != npostings || (uint64_t)counters_total(load->counter) != total) {
+        load->ok = false;
+    }
+}
+
+/**************** load_binary ****************/
+/* read a binary index, whose magic bytes have already been read */
+static bool
+load_binary(index_t* index, FILE* fp)
+{
+    size_t size;
+    unsigned char* bytes = (unsigned char*)file_readFileLen(fp, &size);
+    if (bytes == NULL) {
+        return false;
+    }
+
+    // the header, and the trailer that says where the lexicon starts;
+    // offsets in the file count the magic bytes we have already read
+    const unsigned char* p = bytes;
+    const unsigned char* end = bytes + size;
+    binheader_t header;
+    if (size < TRAILER_SIZE || (p = parse_header(p, end, &header)) == NULL) {
+        free(bytes);
+        return false;
+    }
+    binload_t load = { index, bytes, (p - bytes) + sizeof(BINARY_MAGIC),
+                       le64_get(end - TRAILER_SIZE), NULL, 0, true };
+    uint64_t fileSize = size + sizeof(BINARY_MAGIC);
+    if (load.end < load.start || load.end > fileSize - TRAILER_SIZE) {
+        free(bytes);
+        return false;
+    }
+    lexicon_t* lexicon = lexicon_open(bytes + (load.end - sizeof(BINARY_MAGIC)),
+                                      fileSize - TRAILER_SIZE - load.end);
+    if (lexicon == NULL || lexicon_size(lexicon) != (int)header.numWords) {
+        lexicon_close(lexicon);
+        free(bytes);
+        return false;
+    }
+
+    hashtable_reserve(index->hashtable, (int)header.numWords);
+    lexicon_range(lexicon, NULL, NULL, &load, load_word);
+
+    // the stored document lengths, then the deleted documents, whose
+    // postings are still there
+    if ((int)header.numDocs > index->numDocs) {
+        index->numDocs = (int)header.numDocs;
+    }
+    load.ok = load.ok && add_length(index, index->numDocs, 0);
+    for (uint64_t i = 0; i < header.numLengths && load.ok; i++) {
+        load.ok = add_length(index, (int)(header.firstLength + i),
+                             (int)le32_get(header.lengths + 4 * i));
+    }
+    for (uint64_t i = 0; i < header.deletedBytes && load.ok; i++) {
+        for (int bit = 0; bit < 8; bit++) {
+            if ((header.deleted[i] >> bit) & 1) {
+                load.ok = index_deleteDoc(index, (int)(8 * i + bit));
+            }
+        }
+    }
+
+    lexicon_close(lexicon);
+    free(bytes);
+    return load.ok;
+}
+
+/**************** is_space ****************/
+/* the characters fscanf would skip between tokens */
+static inline bool
+is_space(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/**************** skip_space ****************/
+/* return the first non-space character at or after p, or end */
+static char*
+skip_space(char* p, char* end)
+{
+    while (p < end && is_space(*p)) {
+        p++;
+    }
+    return p;
+}
+
+/**************** parse_int ****************/
+/* parse the whole token at *pp as a decimal int and move *pp past it;
+ * return false, leaving *pp alone, if the token is anything else */
+static bool
+parse_int(char** pp, char* end, int* value)
+{
+    char* p = *pp;
+    bool negative = (p < end && (*p == '-' || *p == '+')) ? (*p++ == '-') : false;
+    if (p == end || *p < '0' || *p > '9') {
+        return false;
+    }
+    long long result = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        result = 10 * result + (*p++ - '0');
+        if (result > INT32_MAX) {
+            return false;
+        }
+    }
+    if (p < end && !is_space(*p)) {
+        return false;
+    }
+    *value = negative ? -(int)result : (int)result;
+    *pp = p;
+    return true;
+}
+
+/**************** chunk_line ****************/
+/* make room for one more line in the chunk */
+static textline_t*
+chunk_line(textchunk_t* chunk)
+{
+    if (chunk->count == chunk->capacity) {
+        int capacity = (chunk->capacity == 0) ? 256 : 2 * chunk->capacity;
+        textline_t* lines = realloc(chunk->lines, capacity * sizeof(textline_t));
+        if (lines == NULL) {
+            return NULL;
+        }
+        chunk->lines = lines;
+        chunk->capacity = capacity;
+    }
+    return &chunk->lines[chunk->count++];
+}
+
+/**************** parse_chunk ****************/
+/* thread body: parse every line of one chunk into counters of the
+ * chunk's own arena, ending each word in place with a '\0' */
+static void*
+parse_chunk(void* arg)
+{
+    textchunk_t* chunk = arg;
+    int* pairs = NULL;      // docID,count pairs of the current line
+    int capacity = 0;       // number of pairs that fit in pairs
+    char* p = skip_space(chunk->start, chunk->end);
+
+    while (p < chunk->end) {
+        // the word runs to the next space, which becomes its terminator
+        char* word = p;
+        while (p < chunk->end && !is_space(*p)) {
+            p++;
+        }
+        if (p < chunk->end) {
+            *p++ = '\0';
+        }
+        normalizeWord(word);
+
+        // read all docID and count pairs for this word
+        int npairs = 0;
+        int docID, count;
+        p = skip_space(p, chunk->end);
+        while (parse_int(&p, chunk->end, &docID)) {
+            p = skip_space(p, chunk->end);
+            if (!parse_int(&p, chunk->end, &count)) {
+                break;
+            }
+            p = skip_space(p, chunk->end);
+            if (npairs == capacity) {
+                capacity = (capacity == 0) ? 64 : capacity * 2;
+                int* grown = realloc(pairs, 2 * capacity * sizeof(int));
+                if (grown == NULL) {
+                    chunk->ok = false;
+                    free(pairs);
+                    return NULL;
+                }
+                pairs = grown;
+            }
+            pairs[2 * npairs] = docID;
+            pairs[2 * npairs + 1] = count;
+            npairs++;
+            if (docID > chunk->numDocs) {
+                chunk->numDocs = docID;
+            }
+        }
+        p = skip_space(p, chunk->end);
+
+        textline_t* line = chunk_line(chunk);
+        counters_t* counter = counters_newArena(chunk->arena);
+        if (line == NULL || counter == NULL) {
+            chunk->ok = false;
+            break;
+        }
+        line->word = word;
+        line->counter = counter;
+
+        // older index files list the pairs in decreasing docID order, so
+        // walk such a line backward to keep every counters_set an append
+        if (npairs > 1 && pairs[0] > pairs[2 * (npairs - 1)]) {
+            for (int i = npairs - 1; i >= 0; i--) {
+                counters_set(counter, pairs[2 * i], pairs[2 * i + 1]);
+            }
+        }
+        else {
+            for (int i = 0; i < npairs; i++) {
+                counters_set(counter, pairs[2 * i], pairs[2 * i + 1]);
+            }
+        }
+    }
+    free(pairs);
+    return NULL;
+}
+
+/**************** set_count ****************/
+/* counters_iterate helper: set one count in other counters */
+static void
+set_count(void* arg, const int key, const int count)
+{
+    counters_set(arg, key, count);
+}
+
+/**************** merge_chunk ****************/
+/* add a parsed chunk's lines to the index, in file order; a word seen
+ * before keeps its counters, and the line's counts are set in them */
+static bool
+merge_chunk(index_t* index, textchunk_t* chunk)
+{
+    for (int i = 0; i < chunk->count; i++) {
+        textline_t* line = &chunk->lines[i];
+        counters_t* counter = hashtable_find(index->hashtable, line->word);
+        if (counter == NULL) {
+            if (!hashtable_insert(index->hashtable, line->word, line->counter)) {
+                return false;
+            }
+        }
+        else {
+            counters_iterate(line->counter, counter, set_count);
+        }
+    }
+    if (chunk->numDocs > index->numDocs) {
+        index->numDocs = chunk->numDocs;
+    }
+    return true;
+}
+
+/**************** check_footer ****************/
+/* if the text ends with a footer line, check its CRC-32 against the
+ * bytes before it and move *end back to the start of the footer;
+ * return false if the checksum does not match */
+static bool
+check_footer(char* bytes, char** end)
+{
+    size_t footerLen = strlen(TEXT_FOOTER) + 9;
+    char* footer = *end - footerLen;
+    if (*end - bytes < (ptrdiff_t)footerLen || (footer > bytes && footer[-1] != '\n')
+        || strncmp(footer, TEXT_FOOTER, strlen(TEXT_FOOTER)) != 0 || (*end)[-1] != '\n') {
+        return true;        // no footer, as in files from older versions
+    }
+    uint32_t crc = 0;
+    for (char* p = footer + strlen(TEXT_FOOTER); p < *end - 1; p++) {
+        int digit = (*p >= '0' && *p <= '9') ? *p - '0'
+                    : (*p >= 'a' && *p <= 'f') ? *p - 'a' + 10 : -1;
+        if (digit < 0) {
+            return false;
+        }
+        crc = (crc << 4) | (uint32_t)digit;
+    }
+    *end = footer;
+    return crc == crc32_update(0, bytes, footer - bytes);
+}
+
+/**************** load_threads ****************/
+/* how many threads to parse len bytes of text with */
+static int
+load_threads(size_t len, int threads)
+{
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (int)cpus : 1;
+    }
+    size_t most = len / MIN_CHUNK + 1;
+    if ((size_t)threads > most) {
+        threads = (int)most;
+    }
+    return (threads > MAX_LOAD_THREADS) ? MAX_LOAD_THREADS : threads;
+}
+
+/**************** load_text ****************/
+/* read a text index, one word and its (docID, count) pairs per line;
+ * the file is read whole and split into one chunk per thread, each
+ * chunk is parsed into its own arena, and the chunks are merged into
+ * the hashtable in order, so the result is what a serial read gives */
+static bool
+load_text(index_t* index, FILE* fp, int threads)
+{
+    size_t len;
+    char* bytes = file_readFileLen(fp, &len);
+    if (bytes == NULL) {
+        return !ferror(fp);     // an empty file is an empty index
+    }
+    char* p = bytes;
+    char* end = bytes + len;
+
+    // a footer, if there is one, must hold the checksum of the rest
+    if (!check_footer(bytes, &end)) {
+        free(bytes);
+        return false;
+    }
+
+    // an optional header gives the number of words and documents, so
+    // the hashtable can be sized once instead of growing as we read
+    if (p < end && *p == '#') {
+        char* eol = memchr(p, '\n', len);
+        eol = (eol == NULL) ? end : eol + 1;
+        int numWords, numDocs;
+        char* q = skip_space(p + 1, eol);
+        if (eol - q > 5 && strncmp(q, "index", 5) == 0 && is_space(q[5])) {
+            q = skip_space(q + 5, eol);
+            if (parse_int(&q, eol, &numWords)) {
+                q = skip_space(q, eol);
+                if (parse_int(&q, eol, &numDocs)) {
+                    hashtable_reserve(index->hashtable, numWords);
+                    if (numDocs > index->numDocs) {
+                        index->numDocs = numDocs;
+                    }
+                }
+            }
+        }
+        p = eol;
+    }
+
+    // split into chunks that start at line boundaries
+    threads = load_threads(end - p, threads);
+    textchunk_t chunks[MAX_LOAD_THREADS];
+    pthread_t tids[MAX_LOAD_THREADS];
+    int nchunks = 0;
+    while (p < end && nchunks < threads) {
+        char* stop = end;
+        if (nchunks < threads - 1) {
+            stop = p + (end - p) / (threads - nchunks);
+            char* eol = memchr(stop, '\n', end - stop);
+            stop = (eol == NULL) ? end : eol + 1;
+        }
+        textchunk_t chunk = { p, stop, arena_newTagged(0, MEM_POSTINGS), NULL, 0, 0, 0, true };
+        chunks[nchunks++] = chunk;
+        p = stop;
+    }
+
+    // parse chunk 0 on this thread and the rest on their own
+    bool ok = true;
+    int started = 0;
+    for (int i = 1; i < nchunks; i++) {
+        if (chunks[i].arena == NULL || pthread_create(&tids[i], NULL, parse_chunk, &chunks[i]) != 0) {
+            chunks[i].ok = false;
+            break;
+        }
+        started = i;
+    }
+    if (nchunks > 0 && chunks[0].arena != NULL) {
+        parse_chunk(&chunks[0]);
+    }
+    for (int i = 1; i <= started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+
+    // merge; the index keeps the chunks' arenas, since counters
+    // allocate from their own arena when they grow
+    arena_t** loaded = mem_realloc_tagged(index->loaded,
+                                          (index->numLoaded + nchunks) * sizeof(arena_t*),
+                                          MEM_INDEX);
+    if (loaded != NULL) {
+        index->loaded = loaded;
+    }
+    for (int i = 0; i < nchunks; i++) {
+        ok = ok && loaded != NULL && chunks[i].arena != NULL && chunks[i].ok
+             && merge_chunk(index, &chunks[i]);
+        if (loaded != NULL && chunks[i].arena != NULL) {
+            index->loaded[index->numLoaded++] = chunks[i].arena;
+        }
+        else {
+            arena_delete(chunks[i].arena);
+        }
+        free(chunks[i].lines);
+    }
+    free(bytes);
+    return ok && count_lengths(index);
+}
+
+/**************** mapped_postings ****************/
+/* point *postings at the encoded postings at offset in a mapped index */
+static bool
+mapped_postings(index_t* index, uint64_t offset, postings_t* postings)
+{
+    if (offset >= (uint64_t)(index->recordsEnd - index->map)) {
+        return false;
+    }
+    uint64_t npostings, total;
+    const unsigned char* p = varint_get(index->map + offset, index->recordsEnd, &npostings);
+    p = (p == NULL) ? NULL : varint_get(p, index->recordsEnd, &total);
+    if (p == NULL || npostings > INT32_MAX) {
+        return false;
+    }
+    *postings = postings_fromBytes(p, index->recordsEnd, (int)npostings);
+    return true;
+}
+
+/**************** find_mapped ****************/
+/* look word up in the lexicon of a mapped index; on success point
+ * *postings at the word's encoded postings, inside the mapping */
+static bool
+find_mapped(index_t* index, const char* word, postings_t* postings)
+{
+    uint64_t offset;
+    return lexicon_find(index->lexicon, word, &offset, NULL)
+           && mapped_postings(index, offset, postings);
+}
+
+/**************** text_word ****************/
+/* append a line of a text index for the word, with the postings
+ * gathered in writer->postings */
+static void
+text_word(binwriter_t* writer, const char* word)
+{
+    outbuf_t* out = &writer->out;
+    postlist_t* list = &writer->postings;
+    if (!list->ok) {
+        out->ok = false;
+        return;
+    }
+    outbuf_bytes(out, word, strlen(word));
+    for (int i = 0; i < list->count; i++) {
+        text_posting(out, list->docIDs[i], list->counts[i]);
+    }
+    outbuf_bytes(out, "\n", 1);
+    if (out->len >= FLUSH_SIZE) {
+        outbuf_flush(out);
+    }
+    list->count = 0;
+}
+
+/**************** merge_words ****************/
+/* walk the lexicons of the merge's inputs together, in sorted order,
+ * and return the number of distinct words with any postings left, or
+ * -1 on error; if writer is not NULL, also write each word with the
+ * postings of every input that has it, which must come in increasing
+ * docID order, leaving out those of deleted documents */
+static int
+merge_words(mergejob_t* job, binwriter_t* writer)
+{
+    postlist_t scratch = { NULL, NULL, 0, 0, true };
+    mergeinput_t* inputs = mem_calloc_tagged(job->n, sizeof(mergeinput_t), MEM_INDEX);
+    if (inputs == NULL) {
+        return -1;
+    }
+    bool ok = true;
+    for (int i = 0; i < job->n; i++) {
+        inputs[i].index = job->indexes[i];
+        inputs[i].cursor = lexicon_cursor(job->indexes[i]->lexicon);
+        ok = ok && inputs[i].cursor != NULL;
+        if (ok && !lexcursor_next(inputs[i].cursor, &inputs[i].word, &inputs[i].offset)) {
+            inputs[i].word = NULL;
+        }
+    }
+
+    int numWords = 0;
+    while (ok) {
+        // the smallest word any input is on
+        const char* word = NULL;
+        for (int i = 0; i < job->n; i++) {
+            if (inputs[i].word != NULL && (word == NULL || strcmp(inputs[i].word, word) < 0)) {
+                word = inputs[i].word;
+            }
+        }
+        if (word == NULL) {
+            break;
+        }
+        for (int i = 0; i < job->n; i++) {
+            inputs[i].matched = (inputs[i].word != NULL && strcmp(inputs[i].word, word) == 0);
+        }
+
+        // gather its postings from each input in turn, then write them;
+        // just counting the word needs them only if some may be deleted
+        if (writer == NULL && !job->anyDeleted) {
+            numWords++;
+        }
+        else {
+            postlist_t* list = (writer != NULL) ? &writer->postings : &scratch;
+            for (int i = 0; i < job->n && ok; i++) {
+                postings_t postings;
+                postcursor_t cursor;
+                if (!inputs[i].matched) {
+                    continue;
+                }
+                ok = mapped_postings(inputs[i].index, inputs[i].offset, &postings);
+                if (ok) {
+                    postings_skipDeleted(&postings, inputs[i].index->deleted,
+                                         inputs[i].index->deletedBytes);
+                    postings_cursor(&postings, &cursor);
+                }
+                while (ok && postcursor_next(&cursor)) {
+                    int docID = postcursor_docID(&cursor);
+                    ok = (list->count == 0 || docID > list->docIDs[list->count - 1]);
+                    gather_posting(list, docID, postcursor_count(&cursor));
+                }
+            }
+            ok = ok && list->ok;
+            if (ok && list->count > 0) {
+                numWords++;
+                if (writer != NULL && job->format == INDEX_TEXT) {
+                    text_word(writer, word);
+                    ok = writer->out.ok;
+                }
+                else if (writer != NULL) {
+                    binwriter_word(writer, word);
+                    ok = writer->out.ok;
+                }
+            }
+            list->count = 0;
+        }
 
-/**************** local types ****************/
+        for (int i = 0; i < job->n; i++) {
+            if (inputs[i].matched
+                && !lexcursor_next(inputs[i].cursor, &inputs[i].word, &inputs[i].offset)) {
+                inputs[i].word = NULL;
+            }
+        }
+    }
 
-struct index {
-    hashtable_t* hashtable;
-};
+    for (int i = 0; i < job->n; i++) {
+        lexcursor_delete(inputs[i].cursor);
+    }
+    mem_free(inputs);
+    postlist_free(&scratch);
+    return ok ? numWords : -1;
+}
 
-/**************** local functions ****************/
+/**************** merge_text ****************/
+/* write the merged words as a text index, as save_text would */
+static bool
+merge_text(mergejob_t* job, FILE* fp, int numWords, int numDocs)
+{
+    outbuf_t out = { fp, NULL, 0, 0, 0, 0, true };
+    postlist_t postings = { NULL, NULL, 0, 0, true };
+    binwriter_t writer = { out, NULL, postings };
+    outbuf_bytes(&writer.out, "#index ", 7);
+    outbuf_uint(&writer.out, numWords);
+    outbuf_bytes(&writer.out, " ", 1);
+    outbuf_uint(&writer.out, numDocs);
+    outbuf_bytes(&writer.out, "\n", 1);
+    bool ok = merge_words(job, &writer) == numWords;
+    outbuf_flush(&writer.out);
 
-/****************** print_counter ******************/
-/* print the docID and count of word for every file*/
-static void
-print_counter(void* arg, const int key, int count)
+    char footer[32];
+    int len = snprintf(footer, sizeof(footer), "%s%08x\n", TEXT_FOOTER,
+                       (unsigned int)writer.out.crc);
+    outbuf_bytes(&writer.out, footer, len);
+    outbuf_flush(&writer.out);
+
+    free(writer.out.bytes);
+    postlist_free(&writer.postings);
+    return writer.out.ok && ok;
+}
+
+/**************** merge_binary ****************/
+/* write_atomically helper: count the merged words, then write them */
+static bool
+merge_binary(void* arg, FILE* fp)
 {
-    FILE* fp = (FILE*)arg;
-    if (fp != NULL && count > 0) {
-        // print docID and count
-        fprintf(fp, " %d %d", key, count);
+    mergejob_t* job = arg;
+    int numWords = merge_words(job, NULL);
+    if (numWords < 0) {
+        return false;
     }
+    int numDocs = 0;
+    for (int i = 0; i < job->n; i++) {
+        if (job->indexes[i]->numDocs > numDocs) {
+            numDocs = job->indexes[i]->numDocs;
+        }
+    }
+    if (job->format == INDEX_TEXT) {
+        return merge_text(job, fp, numWords, numDocs);
+    }
+    binwriter_t writer;
+    bool ok = binwriter_begin(&writer, fp, numWords, numDocs, job->indexes, job->n)
+              && merge_words(job, &writer) == numWords;
+    return binwriter_finish(&writer) && ok;
 }
 
+/**************** word_slice ****************/
+/* which of slices merge threads owns word */
+static int
+word_slice(const char* word, int slices)
+{
+    // the high bits, since the hashtables bucket by the low ones
+    return (int)((fasthash_string(word) >> 32) % (uint64_t)slices);
+}
 
-/**************** index_save_helper ****************/
-/* print the word then iterate through the counter*/
+/**************** merge_partWord ****************/
+/* hashtable_iterate helper: merge a word of the current part, if it
+ * is in this thread's slice and no earlier part had it, with the same
+ * word in the later parts; each part's counters are in docID order,
+ * so the merge takes the lowest docID of any part at each step */
 static void
-index_save_helper(void* fp, const char* key, void* item)
+merge_partWord(void* arg, const char* word, void* item)
 {
-    FILE* outputFile = (FILE*) fp;
-    counters_t* counter = (counters_t*) item;
-
-    if (key != NULL && counter != NULL) {
-        // print word
-        fprintf(outputFile, "%s", key);
+    partmerge_t* job = arg;
+    if (!job->ok || word_slice(word, job->slices) != job->slice
+        || hashtable_find(job->out->hashtable, word) != NULL) {
+        return;
+    }
+    int k = 0;
+    for (int i = job->current; i < job->n; i++) {
+        counters_t* counter = (i == job->current) ? item
+                              : hashtable_find(job->parts[i]->hashtable, word);
+        if (counter != NULL) {
+            job->sources[k] = counter;
+            job->owners[k] = i;
+            job->next[k] = 0;
+            k++;
+        }
+    }
 
-        // iterate through counter and print docID and count
-        counters_iterate(counter, outputFile, print_counter);
+    // the parts are only read here, with positions, since other merge
+    // threads are reading them too
+    int* next = job->next;
+    counters_t* merged = NULL;
+    for (;;) {
+        int best = -1, bestKey = 0, bestCount = 0;
+        for (int j = 0; j < k; j++) {
+            int key, count;
+            if (counters_at(job->sources[j], next[j], &key, &count)
+                && (best < 0 || key < bestKey)) {
+                best = j;
+                bestKey = key;
+                bestCount = count;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        next[best]++;
+        index_t* part = job->parts[job->owners[best]];
+        if (bestCount == 0 || postings_isDeleted(part->deleted, part->deletedBytes, bestKey)) {
+            continue;
+        }
+        if (merged == NULL && (merged = word_counter(job->out, word)) == NULL) {
+            job->ok = false;
+            return;
+        }
+        counters_set(merged, bestKey, bestCount);
+    }
+}
 
-        fprintf(fp, "\n");
+/**************** merge_slice ****************/
+/* merge one slice of the parts' words into job->out; run by its own
+ * thread, or the caller's */
+static void*
+merge_slice(void* arg)
+{
+    partmerge_t* job = arg;
+    for (job->current = 0; job->current < job->n && job->ok; job->current++) {
+        hashtable_iterate(job->parts[job->current]->hashtable, job, merge_partWord);
     }
+    return NULL;
 }
 
-/*********** index_delete_helper ***********/
-/* delete the counters in the index */
+/**************** absorb_word ****************/
+/* hashtable_iterate helper: move a merged word into the index; a word
+ * the index already has gets the postings added to its counters */
 static void
-index_delete_helper(void* item) 
+absorb_word(void* arg, const char* word, void* item)
+{
+    partmerge_t* job = arg;
+    counters_t* counter = hashtable_find(job->out->hashtable, word);
+    if (counter != NULL) {
+        counters_iterate(item, counter, set_count);
+    }
+    else if (!hashtable_insert(job->out->hashtable, word, item)) {
+        job->ok = false;
+    }
+}
+
+/**************** save_format ****************/
+/* write_atomically helper: save an index in the job's format */
+static bool
+save_format(void* arg, FILE* fp)
+{
+    savejob_t* job = arg;
+    return index_saveFormat(job->index, fp, job->format);
+}
+
+/**************** write_atomically ****************/
+/* have writefunc write a temporary file beside filename, then flush
+ * it to disk and rename it over filename, so a reader sees either the
+ * old file or the whole new one; on failure remove the temporary */
+static bool
+write_atomically(const char* filename, void* arg, bool (*writefunc)(void* arg, FILE* fp))
 {
-    counters_t* counter = item;
-    counters_delete(counter);
+    size_t len = strlen(filename);
+    char* tempname = malloc(len + 8);
+    if (tempname == NULL) {
+        return false;
+    }
+    memcpy(tempname, filename, len);
+    memcpy(tempname + len, ".XXXXXX", 8);
+    int fd = mkstemp(tempname);
+    if (fd < 0) {
+        free(tempname);
+        return false;
+    }
+    // mkstemp makes the file private; give it the mode fopen would
+    mode_t mask = umask(0);
+    umask(mask);
+    fchmod(fd, 0666 & ~mask);
+
+    FILE* fp = fdopen(fd, "wb");
+    bool ok = (fp != NULL) && (*writefunc)(arg, fp)
+              && fflush(fp) == 0 && fsync(fd) == 0;
+    if (fp != NULL) {
+        ok = (fclose(fp) == 0) && ok;
+    }
+    else {
+        close(fd);
+    }
+    ok = ok && rename(tempname, filename) == 0;
+    if (!ok) {
+        unlink(tempname);
+    }
+    free(tempname);
+    return ok;
 }
 
 /**************** global functions ****************/
@@ -72,21 +1559,122 @@ index_delete_helper(void* item)
 index_t*
 index_new(const int num_slots)
 {
-    index_t* index = malloc(sizeof(index_t));
+    index_t* index = mem_malloc_tagged(sizeof(index_t), MEM_INDEX);
 
     // error allocating space
     if (index == NULL) {
         return NULL;
     }
 
-    // instantiate the hashtable
-    index->hashtable = hashtable_new(num_slots);
+    // instantiate the arenas and the hashtable on top of them;
+    // separate arenas let memory reports tell words from postings
+    index->numDocs = 0;
+    index->deleted = NULL;
+    index->deletedBytes = 0;
+    index->lengths = NULL;
+    index->lengthsSize = 0;
+    index->numLive = 0;
+    index->numTokens = 0;
+    index->statsStale = false;
+    index->mapLengths = NULL;
+    index->mapFirst = 0;
+    index->mapCount = 0;
+    index->loaded = NULL;
+    index->numLoaded = 0;
+    index->map = NULL;
+    index->mapSize = 0;
+    index->lexicon = NULL;
+    index->recordsEnd = NULL;
+    index->keys = arena_newTagged(0, MEM_INDEXKEYS);
+    index->postings = arena_newTagged(0, MEM_POSTINGS);
+    index->hashtable = hashtable_newArena(num_slots, index->keys);
 
     // error allocating hashtable
-    if (index->hashtable == NULL) {
-        free(index);
+    if (index->postings == NULL || index->hashtable == NULL) {
+        hashtable_delete(index->hashtable, NULL);
+        arena_delete(index->keys);
+        arena_delete(index->postings);
+        mem_free(index);
+        return NULL;
+    }
+    return index;
+}
+
+/**************** index_map ****************/
+/* see index.h header for more details */
+index_t*
+index_map(const char* filename)
+{
+    if (filename == NULL) {
+        return NULL;
+    }
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)(sizeof(BINARY_MAGIC) + TRAILER_SIZE)) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = st.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);      // the mapping keeps its own reference to the file
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    // check the magic bytes and the header, and open the lexicon
+    const unsigned char* bytes = map;
+    const unsigned char* end = bytes + size;
+    const unsigned char* p = bytes + sizeof(BINARY_MAGIC);
+    binheader_t header;
+    uint64_t lexiconOffset = le64_get(end - TRAILER_SIZE);
+    lexicon_t* lexicon = NULL;
+    if (memcmp(bytes, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0
+        || (p = parse_header(p, end, &header)) == NULL
+        || header.deletedBytes > INT32_MAX
+        || lexiconOffset < (uint64_t)(p - bytes)
+        || lexiconOffset > size - TRAILER_SIZE
+        || (lexicon = lexicon_open(bytes + lexiconOffset,
+                                   size - TRAILER_SIZE - lexiconOffset)) == NULL
+        || lexicon_size(lexicon) != (int)header.numWords) {
+        lexicon_close(lexicon);
+        munmap(map, size);
+        return NULL;
+    }
+
+    index_t* index = mem_malloc_tagged(sizeof(index_t), MEM_INDEX);
+    if (index == NULL) {
+        lexicon_close(lexicon);
+        munmap(map, size);
         return NULL;
     }
+    index->hashtable = NULL;
+    index->keys = NULL;
+    index->postings = NULL;
+    index->loaded = NULL;
+    index->numLoaded = 0;
+    index->numDocs = (int)header.numDocs;
+    // read-only, but shared: a bit set in the file by index_markDeleted
+    // shows up here at once
+    index->deleted = (unsigned char*)header.deleted;
+    index->deletedBytes = (int)header.deletedBytes;
+    index->lengths = NULL;
+    index->lengthsSize = 0;
+    index->mapLengths = header.lengths;
+    index->mapFirst = (int)header.firstLength;
+    index->mapCount = (int)header.numLengths;
+
+    // the stored totals; index_stats takes off documents deleted since
+    // they were stored, the first time it is asked, so opening stays cheap
+    index->numLive = (int)header.numLive;
+    index->numTokens = (int64_t)header.numTokens;
+    index->statsStale = index->deletedBytes > 0;
+    index->map = bytes;
+    index->mapSize = size;
+    index->lexicon = lexicon;
+    index->recordsEnd = bytes + lexiconOffset;
     return index;
 }
 
@@ -95,27 +1683,23 @@ index_new(const int num_slots)
 bool
 index_insert(index_t* index, const char* word, int docID)
 {
-    if (index == NULL || word == NULL || docID < 1) {
+    if (index == NULL || word == NULL || docID < 1 || index->map != NULL) {
         return false;
     }
 
-    // Find the counters for the word
-    counters_t* counter = hashtable_find(index->hashtable, word);
+    // Find the counters for the word, or create them if it is new
+    counters_t* counter = word_counter(index, word);
     if (counter == NULL) {
-        // If the word isn't in the hashtable, create a new counter for it
-        counter = counters_new();
-        if (counter == NULL) {
-            return false;
-        }
-        // Insert the new word and its counter into the hashtable
-        if (!hashtable_insert(index->hashtable, word, counter)) {
-            counters_delete(counter);
-            return false;
-        }
+        return false;
     }
 
-    // Increment the count for this docID
-    counters_add(counter, docID);
+    // Increment the count for this docID, and the document's length
+    if (counters_add(counter, docID) == 0 || !add_length(index, docID, 1)) {
+        return false;
+    }
+    if (docID > index->numDocs) {
+        index->numDocs = docID;
+    }
     return true;
 }
 
@@ -124,63 +1708,403 @@ index_insert(index_t* index, const char* word, int docID)
 void*
 index_find(index_t* index, const char* word)
 {
-    if (index == NULL || word == NULL) {
+    if (index == NULL || word == NULL || index->map != NULL) {
         return NULL;
     }
     return hashtable_find(index->hashtable, word);
 }
 
-/**************** index_save ****************/
+/**************** index_postings ****************/
 /* see index.h header for more details */
 bool
-index_save(index_t* index, FILE* fp)
+index_postings(index_t* index, const char* word, postings_t* postings)
 {
-    // handle bad parameters
-    if (index == NULL || fp == NULL) {
+    if (index == NULL || word == NULL || postings == NULL) {
         return false;
     }
-    // iterate through hashtable with helper 
-    hashtable_iterate(index->hashtable, fp, index_save_helper);
+    if (index->map != NULL) {
+        if (!find_mapped(index, word, postings)) {
+            return false;
+        }
+    }
+    else {
+        counters_t* counter = hashtable_find(index->hashtable, word);
+        if (counter == NULL) {
+            return false;
+        }
+        *postings = postings_fromCounters(counter);
+    }
+    postings_skipDeleted(postings, index->deleted, index->deletedBytes);
     return true;
 }
 
-/**************** index_load ****************/
+/**************** index_lastDocID ****************/
 /* see index.h header for more details */
-bool 
-index_load(index_t* index, FILE* fp)
+int
+index_lastDocID(index_t* index)
+{
+    return (index == NULL) ? 0 : index->numDocs;
+}
+
+/**************** index_deleteDoc ****************/
+/* see index.h header for more details */
+bool
+index_deleteDoc(index_t* index, const int docID)
 {
-    if (fp == NULL || index == NULL) {
+    if (index == NULL || docID < 1 || index->map != NULL) {
         return false;
     }
+    int byte = docID >> 3;
+    if (byte >= index->deletedBytes) {
+        int deletedBytes = (index->deletedBytes == 0) ? 64 : index->deletedBytes;
+        while (deletedBytes <= byte) {
+            deletedBytes *= 2;
+        }
+        unsigned char* deleted = mem_realloc_tagged(index->deleted, deletedBytes, MEM_INDEX);
+        if (deleted == NULL) {
+            return false;
+        }
+        memset(deleted + index->deletedBytes, 0, deletedBytes - index->deletedBytes);
+        index->deleted = deleted;
+        index->deletedBytes = deletedBytes;
+    }
+    int length = doc_length(index, docID);
+    if (length > 0 && !postings_isDeleted(index->deleted, index->deletedBytes, docID)) {
+        index->numLive--;
+        index->numTokens -= length;
+    }
+    index->deleted[byte] |= (unsigned char)(1 << (docID & 7));
+    if (docID > index->numDocs) {
+        index->numDocs = docID;
+    }
+    return true;
+}
 
-    char word[256];
-    int docID, count;
+/**************** index_isDeleted ****************/
+/* see index.h header for more details */
+bool
+index_isDeleted(index_t* index, const int docID)
+{
+    return index != NULL && docID >= 1
+           && postings_isDeleted(index->deleted, index->deletedBytes, docID);
+}
 
-    // read each word from file
-    while (fscanf(fp, "%255s", word) == 1) {
-        normalizeWord(word);
+/**************** index_numDeleted ****************/
+/* see index.h header for more details */
+int
+index_numDeleted(index_t* index)
+{
+    int n = 0;
+    for (int i = 0; index != NULL && i < index->deletedBytes; i++) {
+        for (unsigned int bits = index->deleted[i]; bits != 0; bits &= bits - 1) {
+            n++;
+        }
+    }
+    return n;
+}
+
+/**************** index_markDeleted ****************/
+/* see index.h header for more details */
+bool
+index_markDeleted(const char* filename, const int docID)
+{
+    if (filename == NULL || docID < 1) {
+        return false;
+    }
+    int fd = open(filename, O_RDWR);
+    if (fd < 0) {
+        return false;
+    }
+    // setting a bit is a read-modify-write of its byte; hold the file
+    // so a docdelete of a docID in the same byte cannot lose this one
+    if (flock(fd, LOCK_EX) != 0) {
+        close(fd);
+        return false;
+    }
+
+    // the header ends with the bitmap; find the byte with docID's bit
+    unsigned char head[sizeof(BINARY_MAGIC) + 4 * VARINT_MAX];
+    ssize_t len = pread(fd, head, sizeof(head), 0);
+    const unsigned char* end = head + ((len < 0) ? 0 : len);
+    const unsigned char* p = NULL;
+    uint64_t numWords, numDocs, deletedBytes;
+    unsigned char byte;
+    off_t at = 0;
+    bool ok = len > (ssize_t)sizeof(BINARY_MAGIC)
+              && memcmp(head, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0;
+    if (ok) {
+        // the bitmap may run past what we read; only its length matters
+        const unsigned char* q = head + sizeof(BINARY_MAGIC);
+        uint64_t version;
+        ok = (q = varint_get(q, end, &version)) != NULL && version == BINARY_VERSION
+             && (q = varint_get(q, end, &numWords)) != NULL
+             && (q = varint_get(q, end, &numDocs)) != NULL
+             && (q = varint_get(q, end, &deletedBytes)) != NULL;
+        p = q;
+    }
+    ok = ok && (uint64_t)docID <= numDocs && (uint64_t)(docID >> 3) < deletedBytes;
+    if (ok) {
+        at = (p - head) + (docID >> 3);
+        ok = pread(fd, &byte, 1, at) == 1;
+    }
+    if (ok) {
+        byte |= (unsigned char)(1 << (docID & 7));
+        ok = pwrite(fd, &byte, 1, at) == 1 && fsync(fd) == 0;
+    }
+    flock(fd, LOCK_UN);
+    ok = (close(fd) == 0) && ok;
+    return ok;
+}
+
+/**************** index_stats ****************/
+/* see index.h header for more details */
+bool
+index_stats(index_t* index, index_stats_t* stats)
+{
+    if (index == NULL || stats == NULL) {
+        return false;
+    }
+    if (index->statsStale) {
+        drop_deleted(index);
+    }
+    stats->numDocs = index->numLive;
+    stats->numTokens = index->numTokens;
+    stats->avgLength = (index->numLive == 0) ? 0.0
+                       : (double)index->numTokens / index->numLive;
+    return true;
+}
+
+/**************** index_docLength ****************/
+/* see index.h header for more details */
+int
+index_docLength(index_t* index, const int docID)
+{
+    if (index == NULL || index_isDeleted(index, docID)) {
+        return 0;
+    }
+    return doc_length(index, docID);
+}
 
-        // retrieve or create the counter for this word
+/**************** index_termStats ****************/
+/* see index.h header for more details */
+bool
+index_termStats(index_t* index, const char* word, int* df, int64_t* cf)
+{
+    if (index == NULL || word == NULL || df == NULL || cf == NULL) {
+        return false;
+    }
+    if (index->map == NULL) {
         counters_t* counter = hashtable_find(index->hashtable, word);
         if (counter == NULL) {
-            counter = counters_new();
-            // error making counter
-            if (counter == NULL) {
-                return false;
-            }
-            // insert the new word and its counter into the hashtable
-            if (!hashtable_insert(index->hashtable, word, counter)) {
-                counters_delete(counter);
-                return false;
+            return false;
+        }
+        *df = counters_size(counter);
+        *cf = counters_total(counter);
+        return true;
+    }
+
+    // a mapped word's postings start with their number and total
+    uint64_t offset, npostings, total;
+    const unsigned char* p = NULL;
+    if (lexicon_find(index->lexicon, word, &offset, NULL)
+        && offset < (uint64_t)(index->recordsEnd - index->map)
+        && (p = varint_get(index->map + offset, index->recordsEnd, &npostings)) != NULL
+        && (p = varint_get(p, index->recordsEnd, &total)) != NULL
+        && npostings <= INT32_MAX && total <= INT64_MAX) {
+        *df = (int)npostings;
+        *cf = (int64_t)total;
+        return true;
+    }
+    return false;
+}
+
+/**************** index_save ****************/
+/* see index.h header for more details */
+bool
+index_save(index_t* index, FILE* fp)
+{
+    return index_saveFormat(index, fp, INDEX_TEXT);
+}
+
+/**************** index_saveFormat ****************/
+/* see index.h header for more details */
+bool
+index_saveFormat(index_t* index, FILE* fp, index_format_t format)
+{
+    // handle bad parameters; a mapped index is already saved
+    if (index == NULL || fp == NULL || index->map != NULL) {
+        return false;
+    }
+    return (format == INDEX_BINARY) ? save_binary(index, fp) : save_text(index, fp);
+}
+
+/**************** index_saveFile ****************/
+/* see index.h header for more details */
+bool
+index_saveFile(index_t* index, const char* filename, index_format_t format)
+{
+    if (index == NULL || filename == NULL || index->map != NULL) {
+        return false;
+    }
+    savejob_t job = { index, format };
+    return write_atomically(filename, &job, save_format);
+}
+
+/**************** index_merge ****************/
+/* see index.h header for more details */
+bool
+index_merge(index_t** indexes, int n, const char* filename)
+{
+    return index_mergeFormat(indexes, n, filename, INDEX_BINARY);
+}
+
+/**************** index_mergeFormat ****************/
+/* see index.h header for more details */
+bool
+index_mergeFormat(index_t** indexes, int n, const char* filename, index_format_t format)
+{
+    if (indexes == NULL || n <= 0 || filename == NULL) {
+        return false;
+    }
+    for (int i = 0; i < n; i++) {
+        if (indexes[i] == NULL || indexes[i]->map == NULL) {
+            return false;
+        }
+    }
+    mergejob_t job = { indexes, n, false, format };
+    for (int i = 0; i < n; i++) {
+        job.anyDeleted = job.anyDeleted || index_numDeleted(indexes[i]) > 0;
+    }
+    return write_atomically(filename, &job, merge_binary);
+}
+
+/**************** index_mergeParts ****************/
+/* see index.h header for more details */
+bool
+index_mergeParts(index_t* index, index_t** parts, int n, int threads)
+{
+    if (index == NULL || index->map != NULL || parts == NULL || n < 0) {
+        return false;
+    }
+    for (int i = 0; i < n; i++) {
+        if (parts[i] == NULL || parts[i]->map != NULL) {
+            return false;
+        }
+    }
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (int)cpus : 1;
+    }
+    threads = (threads > MAX_LOAD_THREADS) ? MAX_LOAD_THREADS : threads;
+
+    // each thread merges its slice of the words into an index of its
+    // own, so no two threads ever touch the same words or memory
+    partmerge_t jobs[MAX_LOAD_THREADS];
+    pthread_t tids[MAX_LOAD_THREADS];
+    bool ok = true;
+    for (int t = 0; t < threads; t++) {
+        partmerge_t job = { parts, n, t, threads, 0, index_new(500),
+                            mem_malloc_tagged((n + 1) * sizeof(counters_t*), MEM_INDEX),
+                            mem_malloc_tagged((n + 1) * sizeof(int), MEM_INDEX),
+                            mem_malloc_tagged((n + 1) * sizeof(int), MEM_INDEX), true };
+        job.ok = job.out != NULL && job.sources != NULL && job.owners != NULL && job.next != NULL;
+        jobs[t] = job;
+        ok = ok && job.ok;
+    }
+    // a slice whose thread cannot be started is merged on this thread
+    int started = 0;
+    for (int t = 1; t < threads && ok; t++) {
+        if (pthread_create(&tids[t], NULL, merge_slice, &jobs[t]) != 0) {
+            break;
+        }
+        started = t;
+    }
+    if (ok) {
+        merge_slice(&jobs[0]);
+        for (int t = started + 1; t < threads; t++) {
+            merge_slice(&jobs[t]);
+        }
+    }
+    for (int t = 1; t <= started; t++) {
+        pthread_join(tids[t], NULL);
+    }
+
+    // the slices hold disjoint words, so gathering them is one insert
+    // per word; the index keeps their counters' arenas
+    int numWords = hashtable_size(index->hashtable);
+    for (int t = 0; t < threads; t++) {
+        ok = ok && jobs[t].ok;
+        numWords += (jobs[t].out == NULL) ? 0 : hashtable_size(jobs[t].out->hashtable);
+    }
+    arena_t** loaded = ok ? mem_realloc_tagged(index->loaded,
+                                               (index->numLoaded + threads) * sizeof(arena_t*),
+                                               MEM_INDEX)
+                          : NULL;
+    ok = ok && loaded != NULL;
+    if (ok) {
+        index->loaded = loaded;
+        hashtable_reserve(index->hashtable, numWords);
+    }
+    for (int t = 0; t < threads; t++) {
+        if (ok) {
+            partmerge_t absorb = { NULL, 0, 0, 0, 0, index, NULL, NULL, NULL, true };
+            hashtable_iterate(jobs[t].out->hashtable, &absorb, absorb_word);
+            ok = absorb.ok;
+            index->loaded[index->numLoaded++] = jobs[t].out->postings;
+            jobs[t].out->postings = NULL;
+        }
+        index_delete(jobs[t].out);
+        free_tagged(jobs[t].sources);
+        free_tagged(jobs[t].owners);
+        free_tagged(jobs[t].next);
+    }
+
+    // the document lengths, and the highest docID left with postings
+    for (int i = 0; i < n && ok; i++) {
+        for (int docID = 1; docID < parts[i]->lengthsSize && ok; docID++) {
+            int length = index_docLength(parts[i], docID);
+            if (length > 0) {
+                ok = add_length(index, docID, length);
+                if (docID > index->numDocs) {
+                    index->numDocs = docID;
+                }
             }
         }
+    }
+    return ok;
+}
 
-        // read all docID and count pairs for this word
-        while (fscanf(fp, "%d %d", &docID, &count) == 2) {
-            counters_set(counter, docID, count);
+/**************** index_load ****************/
+/* see index.h header for more details */
+bool 
+index_load(index_t* index, FILE* fp)
+{
+    return index_loadThreads(index, fp, 0);
+}
+
+/**************** index_loadThreads ****************/
+/* see index.h header for more details */
+bool
+index_loadThreads(index_t* index, FILE* fp, int threads)
+{
+    if (fp == NULL || index == NULL || index->map != NULL) {
+        return false;
+    }
+
+    // a binary index announces itself with its magic bytes
+    int c = getc(fp);
+    if (c != BINARY_MAGIC[0]) {
+        if (c != EOF) {
+            ungetc(c, fp);
         }
+        return load_text(index, fp, threads);
     }
-    return true;
+    unsigned char magic[sizeof(BINARY_MAGIC) - 1];
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic)
+        || memcmp(magic, BINARY_MAGIC + 1, sizeof(magic)) != 0) {
+        return false;
+    }
+    return load_binary(index, fp);
 }
 
 /**************** index_delete ****************/
@@ -191,10 +2115,24 @@ index_delete(index_t* index)
     if (index == NULL) {
         return;
     }
+    if (index->map != NULL) {
+        lexicon_close(index->lexicon);
+        munmap((void*)index->map, index->mapSize);
+        mem_free(index);
+        return;
+    }
 
-    // delete hashtable
-    hashtable_delete(index->hashtable, index_delete_helper);
+    // delete hashtable; the words and counters all live in the arenas
+    hashtable_delete(index->hashtable, NULL);
+    free_tagged(index->deleted);
+    free_tagged(index->lengths);
+    arena_delete(index->keys);
+    arena_delete(index->postings);
+    for (int i = 0; i < index->numLoaded; i++) {
+        arena_delete(index->loaded[i]);
+    }
+    free_tagged(index->loaded);
 
     // free the index
-    free(index);
+    mem_free(index);
 }
\ No newline at end of file
@@ -10,11 +10,28 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "postings.h"
 
 /**************** index_t ****************/
 // Opaque structure that represents the index
 typedef struct index index_t;
 
+/**************** index_format_t ****************/
+// The formats an index can be saved in
+typedef enum {
+    INDEX_TEXT,         // one line per word, readable and diffable
+    INDEX_BINARY        // bit-packed blocks of postings, much smaller
+} index_format_t;
+
+/**************** index_stats_t ****************/
+// Statistics of the documents in an index, for scoring
+typedef struct index_stats {
+    int numDocs;            // documents with postings, not deleted
+    int64_t numTokens;      // words indexed from them, in all
+    double avgLength;       // numTokens / numDocs, 0 if no documents
+} index_stats_t;
+
 /**************** index_new ****************/
 /* 
  * Create a new index. Caller is responsible for
@@ -28,6 +45,30 @@ typedef struct index index_t;
  */
 index_t* index_new(const int num_slots);
 
+/**************** index_map ****************/
+/*
+ * Open a binary index file read-only, by mapping it into memory.
+ * Nothing is loaded or allocated per word: lookups search the
+ * file's lexicon in place, so opening is immediate however
+ * large the index, and processes that map the same file share
+ * its pages.  Caller is responsible for later calling index_delete,
+ * which unmaps the file.
+ *
+ * Inputs:
+ *   filename - path of a file saved with INDEX_BINARY
+ *
+ * Return:
+ *   a pointer to the read-only index, or NULL if the file cannot
+ *   be mapped or is not a binary index of the current version
+ *
+ * Notes:
+ *   a mapped index cannot be inserted into, loaded into or saved,
+ *   and index_find returns NULL for it; use index_postings.
+ *   The file must not be changed while it is mapped, except by
+ *   index_markDeleted.
+ */
+index_t* index_map(const char* filename);
+
 /**************** index_insert ****************/
 /* 
  * Insert a word with the given document ID and count into the index
@@ -57,11 +98,133 @@ bool index_insert(index_t* index, const char* word, int docID);
  */
 void* index_find(index_t* index, const char* word);
 
+/**************** index_postings ****************/
+/*
+ * Find the postings of the given word, in an index that was
+ * built, loaded, or mapped.
+ *
+ * Cursors on the view skip deleted documents.
+ *
+ * Inputs:
+ *   index - a pointer to the index
+ *   word - a string representing the word
+ *   postings - where to put a view of the word's postings; the
+ *              view is valid until the index is changed or deleted
+ *
+ * Return:
+ *   true if the word was found, false otherwise
+ */
+bool index_postings(index_t* index, const char* word, postings_t* postings);
+
+/**************** index_lastDocID ****************/
+/*
+ * Return the highest docID the index has seen, built, loaded, or
+ * mapped: the highest with a posting, or deleted, or recorded in the
+ * file it was loaded from; 0 if the index is empty or NULL.
+ */
+int index_lastDocID(index_t* index);
+
+/**************** index_deleteDoc ****************/
+/*
+ * Mark a document deleted.  Its postings stay in the index, but
+ * index_postings hands out views whose cursors skip them, so no
+ * query sees the document; saving the index drops them for good.
+ *
+ * Inputs:
+ *   index - a built or loaded index, not a mapped one
+ *   docID - the document, which need not have any postings
+ *
+ * Return:
+ *   true if successful, false otherwise
+ */
+bool index_deleteDoc(index_t* index, const int docID);
+
+/**************** index_isDeleted ****************/
+/*
+ * Return true if the document is marked deleted in the index.
+ */
+bool index_isDeleted(index_t* index, const int docID);
+
+/**************** index_numDeleted ****************/
+/*
+ * Return the number of documents marked deleted whose postings
+ * are still in the index, 0 if NULL.
+ */
+int index_numDeleted(index_t* index);
+
+/**************** index_markDeleted ****************/
+/*
+ * Mark a document deleted in a binary index file, in place: the
+ * file's header has a bit for every docID up to its highest, and
+ * this sets one, without reading or rewriting anything else.
+ * Processes that have the file mapped see the deletion at once.
+ * The postings stay in the file until it is merged or rewritten.
+ *
+ * Inputs:
+ *   filename - path of a file saved with INDEX_BINARY
+ *   docID - the document to delete
+ *
+ * Return:
+ *   true if successful; false if the file is not a binary index of
+ *   the current version, cannot be written, or docID is past its
+ *   highest docID
+ */
+bool index_markDeleted(const char* filename, const int docID);
+
+/**************** index_stats ****************/
+/*
+ * Fill in the collection statistics of the index, whether it was
+ * built, loaded, or mapped: a binary file stores them, and the other
+ * indexes keep them up to date.  Deleted documents are not counted;
+ * for a mapped file with deletions, the first call takes them off
+ * the stored totals, in time proportional to the bitmap, and later
+ * calls take constant time.
+ *
+ * Return:
+ *   true if successful, false if either argument is NULL
+ */
+bool index_stats(index_t* index, index_stats_t* stats);
+
+/**************** index_docLength ****************/
+/*
+ * Return the number of words indexed from docID, the sum of its
+ * counts over all words; 0 if it has none, is deleted, or is not
+ * in the index.
+ */
+int index_docLength(index_t* index, const int docID);
+
+/**************** index_termStats ****************/
+/*
+ * Find a word's document frequency (the number of documents it is
+ * in) and collection frequency (the number of times it occurs in
+ * all of them), in constant time.
+ *
+ * Return:
+ *   true if the word was found, false otherwise
+ *
+ * Notes:
+ *   both still count deleted documents whose postings have not yet
+ *   been dropped, by saving or merging; they are upper bounds.
+ */
+bool index_termStats(index_t* index, const char* word, int* df, int64_t* cf);
+
 /**************** index_save ****************/
 /*
  * Save the index to a file
- * Each line of the output will be formatted as follows:
+ * The first line is a header giving the number of words and
+ * the highest docID in the index:
+ *   #index numWords numDocs
+ * Each following line of the output will be formatted as follows:
  *   word docID count [docID count]...
+ * with the words in strcmp order and each word's docIDs increasing,
+ * so the same index always saves to the same bytes.  The last line
+ * is a footer with the CRC-32 of everything before it, in hex:
+ *   #crc32 1a2b3c4d
+ * index_load refuses a file whose footer does not match, and reads
+ * files without a footer as before.
+ * The postings of deleted documents are dropped from the index
+ * first, and words left without postings are not saved; numDocs
+ * still counts the deleted documents.
  * 
  * Inputs:
  *   index - a pointer to the index
@@ -72,19 +235,159 @@ void* index_find(index_t* index, const char* word);
  */
 bool index_save(index_t* index, FILE* fp);
 
+/**************** index_saveFormat ****************/
+/*
+ * Save the index to a file in the given format.
+ * INDEX_TEXT is the format described under index_save.
+ * INDEX_BINARY starts with 8 magic bytes ("\x89TSEIDX\n"), followed
+ * by varints: the format version, the number of words, the
+ * highest docID, and the length of a bitmap of deleted docIDs,
+ * numDocs / 8 + 1 bytes, which follows with all its bits clear
+ * (see index_markDeleted).  A statistics block follows: varints for
+ * the number of documents and their total length (see index_stats),
+ * the first docID with a length and the number of lengths stored,
+ * then that many lengths, 4 bytes each, little-endian, one per docID
+ * from the first.  Then, for each word in sorted order, come its
+ * number of postings and the sum of their counts as varints, then
+ * the postings in blocks with skip entries, as written by
+ * postings_encode (see postings.h).
+ * Then comes the lexicon (see lexicon.h), mapping each word
+ * to the file offset of its postings, and last the file offset of the
+ * lexicon as an 8-byte little-endian number.
+ * 
+ * Inputs:
+ *   index - a pointer to the index
+ *   fp - a writable FILE* for the output file, opened in binary mode
+ *        if the platform distinguishes
+ *   format - INDEX_TEXT or INDEX_BINARY
+ * 
+ * Return:
+ *   true if successful, false otherwise
+ */
+bool index_saveFormat(index_t* index, FILE* fp, index_format_t format);
+
+/**************** index_saveFile ****************/
+/*
+ * Save the index to the named file in the given format, atomically:
+ * the index is written to a temporary file in the same directory,
+ * flushed to disk, and renamed over filename, so a reader sees
+ * either the old file or the whole new one, never part of it.
+ * 
+ * Inputs:
+ *   index - a pointer to the index
+ *   filename - the file to create or replace
+ *   format - INDEX_TEXT or INDEX_BINARY
+ * 
+ * Return:
+ *   true if successful; false otherwise, in which case filename is
+ *   left as it was and the temporary file is removed
+ */
+bool index_saveFile(index_t* index, const char* filename, index_format_t format);
+
+/**************** index_merge ****************/
+/*
+ * Merge mapped indexes into one binary index file, atomically as
+ * index_saveFile does.  The inputs are read a word at a time, in
+ * sorted order, and their postings are streamed to the output, so
+ * the merge needs memory for one word's postings, not whole indexes.
+ * The postings of deleted documents are left out, and so are words
+ * left without any; merging a single index thus compacts it.
+ * 
+ * Inputs:
+ *   indexes - n indexes from index_map, covering ranges of docIDs
+ *             that do not overlap, in increasing docID order
+ *   n - number of indexes, at least 1
+ *   filename - the file to create or replace
+ * 
+ * Return:
+ *   true if successful; false if any index is not mapped, a word's
+ *   docIDs would not increase from one input to the next, or on
+ *   any error, in which case filename is left as it was
+ */
+bool index_merge(index_t** indexes, int n, const char* filename);
+
+/**************** index_mergeFormat ****************/
+/*
+ * Merge mapped indexes into one file like index_merge, in the given
+ * format.  An INDEX_TEXT file is the same as index_saveFile would
+ * write for an index holding all the inputs' postings, and it is
+ * written as it is merged too, so neither format needs the inputs
+ * to fit in memory.
+ * 
+ * Inputs:
+ *   as for index_merge, and format - INDEX_TEXT or INDEX_BINARY
+ * 
+ * Return:
+ *   as for index_merge
+ */
+bool index_mergeFormat(index_t** indexes, int n, const char* filename, index_format_t format);
+
+/**************** index_mergeParts ****************/
+/*
+ * Merge built indexes, such as the partial indexes of threads that
+ * each indexed some of the pages, into an index in memory.  The work
+ * is split by word: each of the threads takes the words whose hash
+ * falls in its slice, from every part, and merges their postings in
+ * docID order, so no two threads touch the same word; the slices
+ * are then gathered into the index.  The postings of documents
+ * deleted from a part are left out.
+ *
+ * Inputs:
+ *   index - the built or loaded index to merge into
+ *   parts - n built indexes whose docIDs do not overlap each other,
+ *           nor the index's; they are only read, and the caller
+ *           deletes them
+ *   threads - how many threads to merge with; 0 means one per CPU
+ *
+ * Return:
+ *   true if successful, false otherwise
+ *
+ * Notes:
+ *   the index ends up as if it had been built from all the parts'
+ *   pages in one thread, so it saves to the same bytes.
+ */
+bool index_mergeParts(index_t* index, index_t** parts, int n, int threads);
+
 /**************** index_load ****************/
 /*
- * Load an index from a file.
+ * Load an index from a file in either format; a file that begins
+ * with the binary magic bytes is read as binary, anything else as text.
+ * The text header line written by index_save is optional; when it is
+ * there, the index is sized for the words up front, so the caller
+ * need not count the lines of the file first.
  * 
  * Inputs:
  *   index - a pointer to an empty index
  *   fp - a readable FILE* for the input file
  * 
  * Returns:
- *   true if successful, false otherwise
+ *   true if successful, false otherwise (including a binary file
+ *   that is truncated, corrupt, or of an unknown version)
+ *
+ * Notes:
+ *   a text file is parsed by one thread per CPU, as index_loadThreads
+ *   does with threads 0.
  */
 bool index_load(index_t* index, FILE* fp);
 
+/**************** index_loadThreads ****************/
+/*
+ * Load an index like index_load, parsing a text file with the given
+ * number of threads.  The file is read into memory whole and split
+ * at line boundaries, so each thread parses a run of whole lines;
+ * a file too small to be worth it gets fewer threads.  The result
+ * is the same for any number of threads.
+ *
+ * Inputs:
+ *   index - a pointer to an empty index
+ *   fp - a readable FILE* for the input file
+ *   threads - number of threads, or 0 for one per online CPU
+ *
+ * Returns:
+ *   true if successful, false otherwise
+ */
+bool index_loadThreads(index_t* index, FILE* fp, int threads);
+
 /**************** index_delete ****************/
 /*
  * Delete the entire index, freeing all memory
@@ -0,0 +1,523 @@
+/*
+ * lexicon.c - sorted, front-coded lexicon
+ *
+ * see lexicon.h for more information
+ *
+ * An encoded lexicon is laid out as
+ *   header: numWords, LEXICON_BLOCK, numBlocks, maxWordLen (4 bytes each)
+ *   block table: offset of each block from the start (4 bytes each)
+ *   blocks: for each word, varints for the bytes it shares with the
+ *           word before it (0 for the first of a block), the length
+ *           of the rest, then the rest itself, then a varint value.
+ * All fixed-width numbers are little-endian.
+ *
+ * Jake Fleming - 11/25/24
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../libcs50/varint.h"
+#include "lexicon.h"
+
+/**************** local types ****************/
+
+struct lexbuilder {
+    unsigned char* blocks;      // encoded blocks so far
+    size_t len;
+    size_t capacity;
+    uint32_t* offsets;          // where each block starts in blocks
+    int numBlocks;
+    int blockCapacity;
+    char* prev;                 // the word added last
+    size_t prevLen;
+    size_t prevCapacity;
+    int numWords;
+    size_t maxLen;              // length of the longest word
+    bool ok;                    // false once any add has failed
+};
+
+struct lexicon {
+    const unsigned char* bytes;
+    const unsigned char* end;
+    const unsigned char* table; // the block table
+    int numWords;
+    int numBlocks;
+    size_t maxLen;
+};
+
+struct lexcursor {
+    lexicon_t* lex;
+    int next;                   // position of the next word
+    const unsigned char* p;     // its entry
+    const unsigned char* end;   // and the end of its block
+    size_t len;                 // length of the current word
+    char word[];                // the current word, rebuilt
+};
+
+/**************** local constants ****************/
+static const size_t HEADER_SIZE = 16;
+
+/**************** local functions ****************/
+
+/**************** compare_bytes ****************/
+/* strcmp for two strings given by pointer and length */
+static int
+compare_bytes(const char* a, size_t alen, const unsigned char* b, size_t blen)
+{
+    int cmp = memcmp(a, b, (alen < blen) ? alen : blen);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return (alen > blen) - (alen < blen);
+}
+
+/**************** block_start ****************/
+/* return where block b starts, and in *endp where it stops */
+static const unsigned char*
+block_start(lexicon_t* lex, int b, const unsigned char** endp)
+{
+    *endp = (b + 1 < lex->numBlocks) ? lex->bytes + le32_get(lex->table + 4 * (b + 1))
+                                     : lex->end;
+    return lex->bytes + le32_get(lex->table + 4 * b);
+}
+
+/**************** entry_get ****************/
+/* decode one word entry at p; return the byte after it, or NULL */
+static const unsigned char*
+entry_get(const unsigned char* p, const unsigned char* end, uint64_t* shared,
+          uint64_t* suffixLen, const unsigned char** suffix, uint64_t* value)
+{
+    if ((p = varint_get(p, end, shared)) == NULL
+        || (p = varint_get(p, end, suffixLen)) == NULL
+        || *suffixLen > (uint64_t)(end - p)) {
+        return NULL;
+    }
+    *suffix = p;
+    return varint_get(p + *suffixLen, end, value);
+}
+
+/**************** find_block ****************/
+/* return the last block whose first word is <= word, or -1 if
+ * word comes before every word in the lexicon */
+static int
+find_block(lexicon_t* lex, const char* word)
+{
+    size_t wordLen = strlen(word);
+    int lo = 0;
+    int hi = lex->numBlocks;    // answer is in [lo - 1, hi - 1]
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        const unsigned char* end;
+        const unsigned char* p = block_start(lex, mid, &end);
+        uint64_t shared, suffixLen, value;
+        const unsigned char* suffix;
+        if (entry_get(p, end, &shared, &suffixLen, &suffix, &value) == NULL) {
+            return -1;      // corrupt; treat as not found
+        }
+        if (compare_bytes(word, wordLen, suffix, suffixLen) < 0) {
+            hi = mid;
+        }
+        else {
+            lo = mid + 1;
+        }
+    }
+    return lo - 1;
+}
+
+/**************** block_words ****************/
+/* the number of words in block b */
+static int
+block_words(lexicon_t* lex, int b)
+{
+    int rest = lex->numWords - b * LEXICON_BLOCK;
+    return (rest < LEXICON_BLOCK) ? rest : LEXICON_BLOCK;
+}
+
+/**************** scan ****************/
+/* visit words from lo (inclusive) to hi (exclusive), stopping early at
+ * the first word that does not start with prefix, if prefix is given */
+static void
+scan(lexicon_t* lex, const char* lo, const char* hi, const char* prefix, void* arg,
+     void (*itemfunc)(void* arg, const char* word, uint64_t value))
+{
+    if (lex == NULL || itemfunc == NULL || lex->numWords == 0) {
+        return;
+    }
+    char* word = malloc(lex->maxLen + 1);     // the word being rebuilt
+    if (word == NULL) {
+        return;
+    }
+    size_t prefixLen = (prefix == NULL) ? 0 : strlen(prefix);
+    int first = (lo == NULL) ? 0 : find_block(lex, lo);
+    if (first < 0) {
+        first = 0;
+    }
+
+    for (int b = first; b < lex->numBlocks; b++) {
+        const unsigned char* end;
+        const unsigned char* p = block_start(lex, b, &end);
+        size_t len = 0;
+        int count = block_words(lex, b);
+        for (int i = 0; i < count; i++) {
+            uint64_t shared, suffixLen, value;
+            const unsigned char* suffix;
+            p = entry_get(p, end, &shared, &suffixLen, &suffix, &value);
+            if (p == NULL || shared > len || shared + suffixLen > lex->maxLen) {
+                free(word);
+                return;     // corrupt
+            }
+            memcpy(word + shared, suffix, suffixLen);
+            len = shared + suffixLen;
+            word[len] = '\0';
+
+            if (lo != NULL && strcmp(word, lo) < 0) {
+                continue;
+            }
+            if ((hi != NULL && strcmp(word, hi) >= 0)
+                || (prefix != NULL && strncmp(word, prefix, prefixLen) != 0)) {
+                free(word);
+                return;
+            }
+            (*itemfunc)(arg, word, value);
+        }
+    }
+    free(word);
+}
+
+/**************** lexbuilder_new ****************/
+/* see lexicon.h header for more details */
+lexbuilder_t*
+lexbuilder_new(void)
+{
+    lexbuilder_t* builder = calloc(1, sizeof(lexbuilder_t));
+    if (builder == NULL) {
+        return NULL;
+    }
+    builder->ok = true;
+    return builder;
+}
+
+/**************** lexbuilder_add ****************/
+/* see lexicon.h header for more details */
+bool
+lexbuilder_add(lexbuilder_t* builder, const char* word, uint64_t value)
+{
+    if (builder == NULL || word == NULL || !builder->ok) {
+        return false;
+    }
+    size_t len = strlen(word);
+    if (builder->numWords > 0
+        && compare_bytes(word, len, (unsigned char*)builder->prev, builder->prevLen) <= 0) {
+        builder->ok = false;
+        return false;
+    }
+
+    // every LEXICON_BLOCK words, start a block with a word stored whole
+    size_t shared = 0;
+    if (builder->numWords % LEXICON_BLOCK == 0) {
+        if (builder->numBlocks == builder->blockCapacity) {
+            int capacity = (builder->blockCapacity == 0) ? 64 : builder->blockCapacity * 2;
+            uint32_t* offsets = realloc(builder->offsets, capacity * sizeof(uint32_t));
+            if (offsets == NULL) {
+                builder->ok = false;
+                return false;
+            }
+            builder->offsets = offsets;
+            builder->blockCapacity = capacity;
+        }
+        builder->offsets[builder->numBlocks++] = builder->len;
+    }
+    else {
+        while (shared < len && shared < builder->prevLen
+               && word[shared] == builder->prev[shared]) {
+            shared++;
+        }
+    }
+
+    // make room for the entry, and remember this word for the next one
+    size_t need = builder->len + 3 * VARINT_MAX + (len - shared);
+    if (need > builder->capacity) {
+        size_t capacity = (builder->capacity == 0) ? 4096 : builder->capacity;
+        while (capacity < need) {
+            capacity *= 2;
+        }
+        unsigned char* blocks = realloc(builder->blocks, capacity);
+        if (blocks == NULL) {
+            builder->ok = false;
+            return false;
+        }
+        builder->blocks = blocks;
+        builder->capacity = capacity;
+    }
+    if (len + 1 > builder->prevCapacity) {
+        size_t capacity = (len + 1 > 2 * builder->prevCapacity) ? len + 1
+                                                                : 2 * builder->prevCapacity;
+        char* prev = realloc(builder->prev, capacity);
+        if (prev == NULL) {
+            builder->ok = false;
+            return false;
+        }
+        builder->prev = prev;
+        builder->prevCapacity = capacity;
+    }
+
+    unsigned char* out = builder->blocks + builder->len;
+    out += varint_put(out, shared);
+    out += varint_put(out, len - shared);
+    memcpy(out, word + shared, len - shared);
+    out += len - shared;
+    out += varint_put(out, value);
+    builder->len = out - builder->blocks;
+
+    memcpy(builder->prev, word, len + 1);
+    builder->prevLen = len;
+    builder->numWords++;
+    if (len > builder->maxLen) {
+        builder->maxLen = len;
+    }
+    return true;
+}
+
+/**************** lexbuilder_finish ****************/
+/* see lexicon.h header for more details */
+unsigned char*
+lexbuilder_finish(lexbuilder_t* builder, size_t* lenp)
+{
+    if (builder == NULL || lenp == NULL || !builder->ok) {
+        return NULL;
+    }
+    size_t tableSize = 4 * (size_t)builder->numBlocks;
+    size_t len = HEADER_SIZE + tableSize + builder->len;
+    if (len > UINT32_MAX) {
+        return NULL;        // block offsets would not fit
+    }
+    unsigned char* bytes = malloc(len);
+    if (bytes == NULL) {
+        return NULL;
+    }
+    le32_put(bytes, builder->numWords);
+    le32_put(bytes + 4, LEXICON_BLOCK);
+    le32_put(bytes + 8, builder->numBlocks);
+    le32_put(bytes + 12, builder->maxLen);
+    for (int b = 0; b < builder->numBlocks; b++) {
+        le32_put(bytes + HEADER_SIZE + 4 * b, HEADER_SIZE + tableSize + builder->offsets[b]);
+    }
+    if (builder->len > 0) {
+        memcpy(bytes + HEADER_SIZE + tableSize, builder->blocks, builder->len);
+    }
+    *lenp = len;
+    return bytes;
+}
+
+/**************** lexbuilder_delete ****************/
+/* see lexicon.h header for more details */
+void
+lexbuilder_delete(lexbuilder_t* builder)
+{
+    if (builder != NULL) {
+        free(builder->blocks);
+        free(builder->offsets);
+        free(builder->prev);
+        free(builder);
+    }
+}
+
+/**************** lexicon_open ****************/
+/* see lexicon.h header for more details */
+lexicon_t*
+lexicon_open(const unsigned char* bytes, size_t len)
+{
+    if (bytes == NULL || len < HEADER_SIZE || len > UINT32_MAX) {
+        return NULL;
+    }
+    uint32_t numWords = le32_get(bytes);
+    uint32_t numBlocks = le32_get(bytes + 8);
+    if (le32_get(bytes + 4) != LEXICON_BLOCK
+        || numWords > INT32_MAX
+        || numBlocks != (numWords + LEXICON_BLOCK - 1) / LEXICON_BLOCK
+        || numBlocks > (len - HEADER_SIZE) / 4) {
+        return NULL;
+    }
+    // block offsets must increase, and stay inside the lexicon
+    uint32_t prev = HEADER_SIZE + 4 * numBlocks;
+    for (uint32_t b = 0; b < numBlocks; b++) {
+        uint32_t offset = le32_get(bytes + HEADER_SIZE + 4 * b);
+        if (offset < prev || offset >= len) {
+            return NULL;
+        }
+        prev = offset + 1;
+    }
+
+    lexicon_t* lex = malloc(sizeof(lexicon_t));
+    if (lex == NULL) {
+        return NULL;
+    }
+    lex->bytes = bytes;
+    lex->end = bytes + len;
+    lex->table = bytes + HEADER_SIZE;
+    lex->numWords = numWords;
+    lex->numBlocks = numBlocks;
+    lex->maxLen = le32_get(bytes + 12);
+    return lex;
+}
+
+/**************** lexicon_size ****************/
+/* see lexicon.h header for more details */
+int
+lexicon_size(lexicon_t* lex)
+{
+    return (lex == NULL) ? 0 : lex->numWords;
+}
+
+/**************** lexicon_find ****************/
+/* see lexicon.h header for more details */
+bool
+lexicon_find(lexicon_t* lex, const char* word, uint64_t* value, int* termID)
+{
+    if (lex == NULL || word == NULL) {
+        return false;
+    }
+    int b = find_block(lex, word);
+    if (b < 0) {
+        return false;
+    }
+
+    // Scan the block without rebuilding its words: matched is how many
+    // leading bytes the previous word has in common with ours.  A word
+    // sharing fewer bytes than that with its predecessor is already
+    // past ours; one sharing more is still before it.
+    size_t wordLen = strlen(word);
+    size_t matched = 0;
+    size_t prevLen = 0;
+    const unsigned char* end;
+    const unsigned char* p = block_start(lex, b, &end);
+    int count = block_words(lex, b);
+    for (int i = 0; i < count; i++) {
+        uint64_t shared, suffixLen, v;
+        const unsigned char* suffix;
+        p = entry_get(p, end, &shared, &suffixLen, &suffix, &v);
+        if (p == NULL || shared > prevLen) {
+            return false;       // corrupt
+        }
+        prevLen = shared + suffixLen;
+        if (shared < matched) {
+            return false;
+        }
+        if (shared > matched) {
+            continue;
+        }
+        // shared == matched, so compare the rest of both words
+        size_t rest = wordLen - matched;
+        size_t k = 0;
+        while (k < suffixLen && k < rest && suffix[k] == (unsigned char)word[matched + k]) {
+            k++;
+        }
+        if (k == suffixLen && k == rest) {
+            if (value != NULL) {
+                *value = v;
+            }
+            if (termID != NULL) {
+                *termID = b * LEXICON_BLOCK + i;
+            }
+            return true;
+        }
+        if (k == rest || (k < suffixLen && suffix[k] > (unsigned char)word[matched + k])) {
+            return false;       // this word is already past ours
+        }
+        matched += k;
+    }
+    return false;
+}
+
+/**************** lexicon_range ****************/
+/* see lexicon.h header for more details */
+void
+lexicon_range(lexicon_t* lex, const char* lo, const char* hi, void* arg,
+              void (*itemfunc)(void* arg, const char* word, uint64_t value))
+{
+    scan(lex, lo, hi, NULL, arg, itemfunc);
+}
+
+/**************** lexicon_prefix ****************/
+/* see lexicon.h header for more details */
+void
+lexicon_prefix(lexicon_t* lex, const char* prefix, void* arg,
+               void (*itemfunc)(void* arg, const char* word, uint64_t value))
+{
+    if (prefix != NULL) {
+        scan(lex, prefix, NULL, prefix, arg, itemfunc);
+    }
+}
+
+/**************** lexicon_cursor ****************/
+/* see lexicon.h header for more details */
+lexcursor_t*
+lexicon_cursor(lexicon_t* lex)
+{
+    if (lex == NULL) {
+        return NULL;
+    }
+    lexcursor_t* cursor = malloc(sizeof(lexcursor_t) + lex->maxLen + 1);
+    if (cursor == NULL) {
+        return NULL;
+    }
+    cursor->lex = lex;
+    cursor->next = 0;
+    cursor->p = NULL;
+    cursor->end = NULL;
+    cursor->len = 0;
+    cursor->word[0] = '\0';
+    return cursor;
+}
+
+/**************** lexcursor_next ****************/
+/* see lexicon.h header for more details */
+bool
+lexcursor_next(lexcursor_t* cursor, const char** word, uint64_t* value)
+{
+    if (cursor == NULL || cursor->next >= cursor->lex->numWords) {
+        return false;
+    }
+    lexicon_t* lex = cursor->lex;
+    if (cursor->next % LEXICON_BLOCK == 0) {
+        cursor->p = block_start(lex, cursor->next / LEXICON_BLOCK, &cursor->end);
+        cursor->len = 0;
+    }
+    uint64_t shared, suffixLen, v;
+    const unsigned char* suffix;
+    const unsigned char* p = entry_get(cursor->p, cursor->end, &shared, &suffixLen, &suffix, &v);
+    if (p == NULL || shared > cursor->len || shared + suffixLen > lex->maxLen) {
+        cursor->next = lex->numWords;       // corrupt; stop here
+        return false;
+    }
+    memcpy(cursor->word + shared, suffix, suffixLen);
+    cursor->len = shared + suffixLen;
+    cursor->word[cursor->len] = '\0';
+    cursor->p = p;
+    cursor->next++;
+    if (word != NULL) {
+        *word = cursor->word;
+    }
+    if (value != NULL) {
+        *value = v;
+    }
+    return true;
+}
+
+/**************** lexcursor_delete ****************/
+/* see lexicon.h header for more details */
+void
+lexcursor_delete(lexcursor_t* cursor)
+{
+    free(cursor);
+}
+
+/**************** lexicon_close ****************/
+/* see lexicon.h header for more details */
+void
+lexicon_close(lexicon_t* lex)
+{
+    free(lex);
+}
@@ -0,0 +1,170 @@
+// lexicon.h - header file for the lexicon module
+//
+// A lexicon maps each word of an index to a number, such as the
+// offset of the word's postings in an index file.  The words are
+// kept sorted and front-coded in blocks of LEXICON_BLOCK: each word
+// stores only how many leading bytes it shares with the word before
+// it, and the rest.  A table of block offsets lets a lookup binary
+// search the blocks by their first word and then scan one block.
+//
+// A lexicon is built once, with a lexbuilder, into a flat array of
+// bytes that can be written to a file as is.  A lexicon_t reads such
+// bytes in place, so the bytes may come straight from a mapped file.
+// Because the words are sorted, a lexicon also answers range and
+// prefix queries, which a hashtable cannot.
+//
+// Jake Fleming, 11/25/2024
+
+#ifndef __LEXICON_H
+#define __LEXICON_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**************** constants ****************/
+#define LEXICON_BLOCK 16        // words per front-coded block
+
+/**************** types ****************/
+// Opaque structures for a lexicon being built, and one being read
+typedef struct lexbuilder lexbuilder_t;
+typedef struct lexicon lexicon_t;
+typedef struct lexcursor lexcursor_t;
+
+/**************** lexbuilder_new ****************/
+/*
+ * Create an empty lexicon builder. Caller is responsible for
+ * later calling lexbuilder_delete.
+ *
+ * Return:
+ *   a pointer to the builder, or NULL if out of memory
+ */
+lexbuilder_t* lexbuilder_new(void);
+
+/**************** lexbuilder_add ****************/
+/*
+ * Add a word and its value to the lexicon being built.
+ * Words must be added in strictly increasing strcmp order.
+ *
+ * Return:
+ *   true if added; false if any parameter is NULL, the word is not
+ *   greater than the one added before it, or out of memory; after
+ *   a false return, lexbuilder_finish fails too
+ */
+bool lexbuilder_add(lexbuilder_t* builder, const char* word, uint64_t value);
+
+/**************** lexbuilder_finish ****************/
+/*
+ * Encode the words added so far into one array of bytes.
+ *
+ * Inputs:
+ *   builder - a pointer to the builder
+ *   lenp - where to store the number of bytes
+ *
+ * Return:
+ *   the encoded lexicon, which the caller must later free,
+ *   or NULL if error
+ */
+unsigned char* lexbuilder_finish(lexbuilder_t* builder, size_t* lenp);
+
+/**************** lexbuilder_delete ****************/
+/*
+ * Delete the builder and everything it holds.
+ */
+void lexbuilder_delete(lexbuilder_t* builder);
+
+/**************** lexicon_open ****************/
+/*
+ * Open the lexicon encoded in the given bytes, which must stay
+ * unchanged until lexicon_close.  Nothing is copied or decoded
+ * up front; the bytes are only checked for consistency.
+ *
+ * Return:
+ *   a pointer to the lexicon, or NULL if the bytes are not a lexicon
+ *   or out of memory
+ */
+lexicon_t* lexicon_open(const unsigned char* bytes, size_t len);
+
+/**************** lexicon_size ****************/
+/*
+ * Return the number of words in the lexicon, 0 if NULL.
+ */
+int lexicon_size(lexicon_t* lex);
+
+/**************** lexicon_find ****************/
+/*
+ * Look up a word.
+ *
+ * Inputs:
+ *   lex - a pointer to the lexicon
+ *   word - the word to look for
+ *   value - where to store the word's value (may be NULL)
+ *   termID - where to store the word's position in sorted order,
+ *            from 0 (may be NULL)
+ *
+ * Return:
+ *   true if the word is in the lexicon, false otherwise
+ *
+ * Notes:
+ *   allocates nothing, so it is safe from many threads at once
+ */
+bool lexicon_find(lexicon_t* lex, const char* word, uint64_t* value, int* termID);
+
+/**************** lexicon_range ****************/
+/*
+ * Call itemfunc(arg, word, value) on every word w with lo <= w < hi,
+ * in sorted order.  A NULL lo starts at the first word, and a NULL
+ * hi goes on to the last.
+ */
+void lexicon_range(lexicon_t* lex, const char* lo, const char* hi, void* arg,
+                   void (*itemfunc)(void* arg, const char* word, uint64_t value));
+
+/**************** lexicon_prefix ****************/
+/*
+ * Call itemfunc(arg, word, value) on every word that starts with
+ * prefix, in sorted order.
+ */
+void lexicon_prefix(lexicon_t* lex, const char* prefix, void* arg,
+                    void (*itemfunc)(void* arg, const char* word, uint64_t value));
+
+/**************** lexicon_cursor ****************/
+/*
+ * Start a cursor before the first word of the lexicon, for reading
+ * the words one at a time in sorted order, as a merge of several
+ * lexicons needs.  Caller is responsible for later calling
+ * lexcursor_delete, before lexicon_close.
+ *
+ * Return:
+ *   a pointer to the cursor, or NULL if lex is NULL or out of memory
+ */
+lexcursor_t* lexicon_cursor(lexicon_t* lex);
+
+/**************** lexcursor_next ****************/
+/*
+ * Move the cursor to the next word.
+ *
+ * Inputs:
+ *   cursor - a pointer to the cursor
+ *   word - where to store the word, which stays valid only until
+ *          the next call (may be NULL)
+ *   value - where to store its value (may be NULL)
+ *
+ * Return:
+ *   true if there was a next word; false at the end, or if the
+ *   lexicon turns out to be corrupt
+ */
+bool lexcursor_next(lexcursor_t* cursor, const char** word, uint64_t* value);
+
+/**************** lexcursor_delete ****************/
+/*
+ * Delete the cursor.
+ */
+void lexcursor_delete(lexcursor_t* cursor);
+
+/**************** lexicon_close ****************/
+/*
+ * Close the lexicon; the bytes it was opened on are not freed.
+ */
+void lexicon_close(lexicon_t* lex);
+
+#endif // __LEXICON_H
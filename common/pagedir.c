@@ -17,6 +17,42 @@
 #include "../libcs50/webpage.h"
 #include "../libcs50/mem.h"
 #include "../libcs50/file.h"
+#include "../libcs50/varint.h"
+#include "../libcs50/crc32.h"
+
+/************* local constants ***************/
+// the manifest file: the magic, then a 4-byte count of pages and of
+// bytes of URLs; a record per page; the URLs, each NUL-terminated;
+// and a crc32 of all that.  Numbers are little-endian.
+static const char MANIFEST_MAGIC[8] = "TSEPAGES";
+#define MANIFEST_HEADER 16      // magic, page count, URL bytes
+#define MANIFEST_RECORD 24      // docID, html offset, html size (8 bytes),
+                                // URL offset, depth
+#define MANIFEST_FOOTER 4       // crc32
+
+/************* local types ***************/
+// a page of a manifest, as pagedir_entry_t but with its URL as an
+// offset into the manifest's URLs, which may move as they grow
+typedef struct record {
+    int docID;
+    int depth;
+    long offset;
+    long size;
+    long urlOffset;
+} record_t;
+
+struct pagedir_manifest {
+    record_t* records;          // in docID order
+    int count;
+    int capacity;
+    char* urls;                 // the URLs, each NUL-terminated
+    long urlBytes;
+    long urlCapacity;
+};
+
+/************* local functions ***************/
+static char* manifestPath(const char* pageDirectory, const char* suffix);
+static pagedir_manifest_t* manifestParse(const unsigned char* bytes, const size_t len);
 
 /************* pagedir_init ***************/
 /* See pagedir.h for detailed description */
@@ -44,9 +80,15 @@ pagedir_init(const char* pageDirectory)
         return false;
     }
 
-    // close the file and return true.
+    // close the file; a manifest left by an earlier crawl would not
+    // describe this one
     fclose(file);
     free(crawlerFilePath);
+    char* manifestFile = manifestPath(pageDirectory, "");
+    if (manifestFile != NULL) {
+        unlink(manifestFile);
+    }
+    free(manifestFile);
     return true;
 }
 
@@ -162,6 +204,321 @@ pagedir_load(const char* pageDirectory, int docID)
     return page;
 }
 
+/**************** pagedir_loadEntry ****************/
+/* See pagedir.h for detailed description */
+webpage_t*
+pagedir_loadEntry(const char* pageDirectory, const pagedir_entry_t* entry)
+{
+    if (entry == NULL || entry->offset < 0 || entry->size < 0) {
+        return NULL;
+    }
+    char filePath[256];
+    snprintf(filePath, sizeof(filePath), "%s/%d", pageDirectory, entry->docID);
+    FILE* fp = fopen(filePath, "r");
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    // the html is the rest of the file from the offset, exactly size
+    // bytes of it, so it is read in one go into a buffer of its size
+    char* html = malloc(entry->size + 1);
+    char* url = malloc(strlen(entry->url) + 1);
+    bool ok = html != NULL && url != NULL
+              && fseek(fp, entry->offset, SEEK_SET) == 0
+              && fread(html, 1, entry->size, fp) == (size_t)entry->size
+              && getc(fp) == EOF;
+    fclose(fp);
+    webpage_t* page = NULL;
+    if (ok) {
+        html[entry->size] = '\0';
+        strcpy(url, entry->url);
+        page = webpage_new(url, entry->depth, html);
+    }
+    if (page == NULL) {
+        free(html);
+        free(url);
+    }
+    return page;
+}
+
+/**************** pagedir_manifestNew ****************/
+/* See pagedir.h for detailed description */
+pagedir_manifest_t*
+pagedir_manifestNew(void)
+{
+    pagedir_manifest_t* manifest = calloc(1, sizeof(pagedir_manifest_t));
+    return manifest;
+}
+
+/**************** pagedir_manifestAdd ****************/
+/* See pagedir.h for detailed description */
+bool
+pagedir_manifestAdd(pagedir_manifest_t* manifest, const webpage_t* page,
+                    const int docID)
+{
+    if (manifest == NULL || page == NULL || docID <= 0
+        || (manifest->count > 0 && docID <= manifest->records[manifest->count - 1].docID)) {
+        return false;
+    }
+    const char* url = webpage_getURL(page);
+    const char* html = webpage_getHTML(page);
+    int depth = webpage_getDepth(page);
+    if (url == NULL) {
+        return false;
+    }
+
+    // make room for the record and the URL
+    if (manifest->count == manifest->capacity) {
+        int capacity = (manifest->capacity == 0) ? 256 : manifest->capacity * 2;
+        record_t* records = realloc(manifest->records, capacity * sizeof(record_t));
+        if (records == NULL) {
+            return false;
+        }
+        manifest->records = records;
+        manifest->capacity = capacity;
+    }
+    long urlLen = strlen(url) + 1;
+    if (manifest->urlBytes + urlLen > manifest->urlCapacity) {
+        long capacity = (manifest->urlCapacity == 0) ? 4096 : manifest->urlCapacity * 2;
+        while (capacity < manifest->urlBytes + urlLen) {
+            capacity *= 2;
+        }
+        char* urls = realloc(manifest->urls, capacity);
+        if (urls == NULL) {
+            return false;
+        }
+        manifest->urls = urls;
+        manifest->urlCapacity = capacity;
+    }
+
+    // the html starts after the URL and depth lines pagedir_save writes
+    record_t* record = &manifest->records[manifest->count++];
+    record->docID = docID;
+    record->depth = depth;
+    record->offset = urlLen + snprintf(NULL, 0, "%d", depth) + 1;
+    record->size = (html == NULL) ? 0 : strlen(html);
+    record->urlOffset = manifest->urlBytes;
+    memcpy(manifest->urls + manifest->urlBytes, url, urlLen);
+    manifest->urlBytes += urlLen;
+    return true;
+}
+
+/**************** pagedir_manifestSave ****************/
+/* See pagedir.h for detailed description */
+bool
+pagedir_manifestSave(const pagedir_manifest_t* manifest, const char* pageDirectory)
+{
+    if (manifest == NULL || pageDirectory == NULL) {
+        return false;
+    }
+
+    // lay out the whole file in memory
+    size_t len = MANIFEST_HEADER + (size_t)manifest->count * MANIFEST_RECORD
+                 + manifest->urlBytes + MANIFEST_FOOTER;
+    unsigned char* bytes = malloc(len);
+    if (bytes == NULL) {
+        return false;
+    }
+    unsigned char* p = bytes;
+    memcpy(p, MANIFEST_MAGIC, sizeof(MANIFEST_MAGIC));
+    le32_put(p + 8, manifest->count);
+    le32_put(p + 12, manifest->urlBytes);
+    p += MANIFEST_HEADER;
+    for (int i = 0; i < manifest->count; i++) {
+        const record_t* record = &manifest->records[i];
+        le32_put(p, record->docID);
+        le32_put(p + 4, record->offset);
+        le64_put(p + 8, record->size);
+        le32_put(p + 16, record->urlOffset);
+        le32_put(p + 20, record->depth);
+        p += MANIFEST_RECORD;
+    }
+    if (manifest->urlBytes > 0) {
+        memcpy(p, manifest->urls, manifest->urlBytes);
+    }
+    p += manifest->urlBytes;
+    le32_put(p, crc32_update(0, bytes, p - bytes));
+
+    // write it beside the manifest, then rename it over
+    char* tempname = manifestPath(pageDirectory, ".tmp");
+    char* filename = manifestPath(pageDirectory, "");
+    FILE* fp = (tempname == NULL || filename == NULL) ? NULL : fopen(tempname, "wb");
+    bool ok = (fp != NULL) && fwrite(bytes, 1, len, fp) == len;
+    if (fp != NULL) {
+        ok = (fclose(fp) == 0) && ok;
+        ok = ok && rename(tempname, filename) == 0;
+        if (!ok) {
+            unlink(tempname);
+        }
+    }
+    free(tempname);
+    free(filename);
+    free(bytes);
+    return ok;
+}
+
+/**************** pagedir_manifestLoad ****************/
+/* See pagedir.h for detailed description */
+pagedir_manifest_t*
+pagedir_manifestLoad(const char* pageDirectory)
+{
+    char* filename = manifestPath(pageDirectory, "");
+    FILE* fp = (filename == NULL) ? NULL : fopen(filename, "rb");
+    free(filename);
+    if (fp == NULL) {
+        return NULL;                // no manifest
+    }
+    size_t len;
+    char* bytes = file_readFileLen(fp, &len);
+    fclose(fp);
+    pagedir_manifest_t* manifest = NULL;
+    if (bytes != NULL) {
+        manifest = manifestParse((unsigned char*)bytes, len);
+    }
+    free(bytes);
+    if (manifest == NULL) {
+        fprintf(stderr, "Error: Damaged manifest in %s; ignoring it\n", pageDirectory);
+    }
+    return manifest;
+}
+
+/**************** pagedir_manifestCount ****************/
+/* See pagedir.h for detailed description */
+int
+pagedir_manifestCount(const pagedir_manifest_t* manifest)
+{
+    return (manifest == NULL) ? 0 : manifest->count;
+}
+
+/**************** pagedir_manifestEntry ****************/
+/* See pagedir.h for detailed description */
+bool
+pagedir_manifestEntry(const pagedir_manifest_t* manifest, const int i,
+                      pagedir_entry_t* entry)
+{
+    if (manifest == NULL || i < 0 || i >= manifest->count || entry == NULL) {
+        return false;
+    }
+    const record_t* record = &manifest->records[i];
+    entry->docID = record->docID;
+    entry->depth = record->depth;
+    entry->offset = record->offset;
+    entry->size = record->size;
+    entry->url = manifest->urls + record->urlOffset;
+    return true;
+}
+
+/**************** pagedir_manifestSeek ****************/
+/* See pagedir.h for detailed description */
+int
+pagedir_manifestSeek(const pagedir_manifest_t* manifest, const int docID)
+{
+    if (manifest == NULL) {
+        return 0;
+    }
+    // binary search: records before lo have smaller docIDs, and
+    // records from hi on have docID or more
+    int lo = 0;
+    int hi = manifest->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (manifest->records[mid].docID < docID) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**************** pagedir_manifestDelete ****************/
+/* See pagedir.h for detailed description */
+void
+pagedir_manifestDelete(pagedir_manifest_t* manifest)
+{
+    if (manifest != NULL) {
+        free(manifest->records);
+        free(manifest->urls);
+        free(manifest);
+    }
+}
+
+/**************** manifestPath ****************/
+/* Return pageDirectory/.manifest followed by suffix, in a new string
+ * the caller frees; NULL if out of memory */
+static char*
+manifestPath(const char* pageDirectory, const char* suffix)
+{
+    size_t len = strlen(pageDirectory) + strlen(suffix) + 12;
+    char* path = malloc(len);
+    if (path != NULL) {
+        snprintf(path, len, "%s/.manifest%s", pageDirectory, suffix);
+    }
+    return path;
+}
+
+/**************** manifestParse ****************/
+/* Build a manifest from the bytes of a manifest file, checking them
+ * all; NULL if they are not a whole, undamaged manifest or out of
+ * memory */
+static pagedir_manifest_t*
+manifestParse(const unsigned char* bytes, const size_t len)
+{
+    if (len < MANIFEST_HEADER + MANIFEST_FOOTER
+        || memcmp(bytes, MANIFEST_MAGIC, sizeof(MANIFEST_MAGIC)) != 0) {
+        return NULL;
+    }
+    size_t count = le32_get(bytes + 8);
+    size_t urlBytes = le32_get(bytes + 12);
+    if (count > INT32_MAX
+        || len != MANIFEST_HEADER + count * MANIFEST_RECORD + urlBytes + MANIFEST_FOOTER
+        || le32_get(bytes + len - MANIFEST_FOOTER) != crc32_update(0, bytes, len - MANIFEST_FOOTER)) {
+        return NULL;
+    }
+    const unsigned char* p = bytes + MANIFEST_HEADER;
+    const char* urls = (const char*)p + count * MANIFEST_RECORD;
+    if (urlBytes > 0 && urls[urlBytes - 1] != '\0') {
+        return NULL;
+    }
+
+    pagedir_manifest_t* manifest = pagedir_manifestNew();
+    if (manifest == NULL) {
+        return NULL;
+    }
+    manifest->records = malloc((count + 1) * sizeof(record_t));
+    manifest->urls = malloc(urlBytes + 1);
+    if (manifest->records == NULL || manifest->urls == NULL) {
+        pagedir_manifestDelete(manifest);
+        return NULL;
+    }
+    manifest->capacity = count + 1;
+    manifest->urlCapacity = urlBytes + 1;
+    manifest->urlBytes = urlBytes;
+    memcpy(manifest->urls, urls, urlBytes);
+
+    // docIDs in order, and every URL offset inside the URLs
+    int lastDocID = 0;
+    for (size_t i = 0; i < count; i++, p += MANIFEST_RECORD) {
+        record_t* record = &manifest->records[i];
+        uint32_t docID = le32_get(p);
+        uint64_t size = le64_get(p + 8);
+        record->offset = le32_get(p + 4);
+        record->urlOffset = le32_get(p + 16);
+        uint32_t depth = le32_get(p + 20);
+        if (docID <= (uint32_t)lastDocID || docID > INT32_MAX || size > INT32_MAX
+            || depth > INT32_MAX || (size_t)record->urlOffset >= urlBytes) {
+            pagedir_manifestDelete(manifest);
+            return NULL;
+        }
+        record->docID = lastDocID = docID;
+        record->size = size;
+        record->depth = depth;
+        manifest->count++;
+    }
+    return manifest;
+}
+
 /**************** getDocumentURL ****************/
 /* See pagedir.h for detailed description */
 char* 
@@ -3,6 +3,12 @@
  *
  * Functions for initializing a pageDirectory
  * and saving pages to it.
+ *
+ * A pageDirectory may also hold a manifest, .manifest, written by
+ * the crawler when it is done: the docID, depth, URL, and where the
+ * html starts and how long it is, for every page saved.  Readers
+ * that find a manifest know the pages and their sizes up front, and
+ * a missing page is a gap rather than the end of the directory.
  * 
  * Jake Fleming, 10/21/2024
  */
@@ -13,11 +19,25 @@
 #include <stdbool.h>
 #include "../libcs50/webpage.h"
 
+/************** types ****************/
+// the manifest of a pageDirectory, opaque to users
+typedef struct pagedir_manifest pagedir_manifest_t;
+
+// one page in a manifest
+typedef struct pagedir_entry {
+    int docID;
+    int depth;
+    long offset;            // where the html starts in the page's file
+    long size;              // bytes of html
+    const char* url;        // held by the manifest
+} pagedir_entry_t;
+
 /************** pagedir_init ****************/
 /* Initializes page directory to store pages
  * crawled by the crawler. Creates a .crawler
  * file to signify that the directory is being
- * used by the crawler.
+ * used by the crawler, and removes any manifest
+ * of an earlier crawl.
  *
  * Inputs:
  *   pageDirectory - Where pages will be saved
@@ -63,6 +83,98 @@ bool pagedir_validate(const char* pageDirectory);
  */
 webpage_t* pagedir_load(const char* pageDirectory, int docID);
 
+/**************** pagedir_loadEntry ****************/
+/* Load the page a manifest entry describes, reading just its html
+ * 
+ * Inputs:
+ *   pageDirectory - the path to the directory
+ *   entry - the page's entry in the directory's manifest
+ * 
+ * Returns:
+ *   A webpage_t object with the URL, depth, and HTML content of the page,
+ *   or NULL if the file cannot be loaded or has not the html the
+ *   entry says
+ */
+webpage_t* pagedir_loadEntry(const char* pageDirectory, const pagedir_entry_t* entry);
+
+/**************** pagedir_manifestNew ****************/
+/* Create an empty manifest, for the crawler to add pages to.
+ * Caller is responsible for later calling pagedir_manifestDelete.
+ *
+ * Return:
+ *   the new manifest, or NULL if out of memory
+ */
+pagedir_manifest_t* pagedir_manifestNew(void);
+
+/**************** pagedir_manifestAdd ****************/
+/* Add a page just saved with pagedir_save to the manifest
+ *
+ * Inputs:
+ *   manifest - the manifest
+ *   page - the page as saved
+ *   docID - its docID, greater than any already in the manifest
+ *
+ * Return:
+ *   true if added; false if out of memory or docID is out of order
+ */
+bool pagedir_manifestAdd(pagedir_manifest_t* manifest, const webpage_t* page,
+                         const int docID);
+
+/**************** pagedir_manifestSave ****************/
+/* Write the manifest to pageDirectory/.manifest, replacing any
+ * there; readers see either the old manifest or the whole new one.
+ *
+ * Inputs:
+ *   manifest - the manifest
+ *   pageDirectory - the path to the directory
+ *
+ * Return:
+ *   true if successful, false otherwise
+ */
+bool pagedir_manifestSave(const pagedir_manifest_t* manifest, const char* pageDirectory);
+
+/**************** pagedir_manifestLoad ****************/
+/* Read the manifest of pageDirectory.
+ * Caller is responsible for later calling pagedir_manifestDelete.
+ *
+ * Inputs:
+ *   pageDirectory - the path to the directory
+ *
+ * Return:
+ *   the manifest, or NULL if there is none (the directory was crawled
+ *   before manifests, or the crawl did not finish) or it is damaged,
+ *   which is also reported on stderr
+ */
+pagedir_manifest_t* pagedir_manifestLoad(const char* pageDirectory);
+
+/**************** pagedir_manifestCount ****************/
+/* Return the number of pages in the manifest, 0 if it is NULL */
+int pagedir_manifestCount(const pagedir_manifest_t* manifest);
+
+/**************** pagedir_manifestEntry ****************/
+/* Get the i-th page of the manifest, in docID order
+ *
+ * Inputs:
+ *   manifest - the manifest
+ *   i - from 0 to pagedir_manifestCount() - 1
+ *   entry - where to put the page's entry; its url is good until
+ *           the manifest is changed or deleted
+ *
+ * Return:
+ *   true if there is such a page, false otherwise
+ */
+bool pagedir_manifestEntry(const pagedir_manifest_t* manifest, const int i,
+                           pagedir_entry_t* entry);
+
+/**************** pagedir_manifestSeek ****************/
+/* Return the index of the first page of the manifest with a docID
+ * of docID or more; pagedir_manifestCount() if there is none */
+int pagedir_manifestSeek(const pagedir_manifest_t* manifest, const int docID);
+
+/**************** pagedir_manifestDelete ****************/
+/* Free a manifest; NULL is ignored */
+void pagedir_manifestDelete(pagedir_manifest_t* manifest);
+
 /**************** getDocumentURL ****************/
 /* Get the url of a given document
  * 
@@ -0,0 +1,477 @@
+/*
+ * postings.c - read-only views of one word's postings
+ *
+ * see postings.h for more information
+ *
+ * Each encoded block of k postings (k = POSTINGS_BLOCK, except maybe
+ * for the last block) is laid out as
+ *   skip entry: varint last docID minus the previous block's last
+ *               docID (or minus 0, for the first block),
+ *               varint number of bytes in the rest of the block
+ *   gapBits, countBits: one byte each
+ *   k docID gaps minus 1, gapBits each, packed low bits first
+ *   k counts minus 1, countBits each, packed the same way
+ * Gaps and counts are stored minus 1 since neither can be 0, so a
+ * block of words that occur once per document packs its counts
+ * into no bits at all.
+ *
+ * Jake Fleming - 11/22/24
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "../libcs50/counters.h"
+#include "../libcs50/varint.h"
+#include "postings.h"
+
+/**************** local functions ****************/
+
+/**************** bits_needed ****************/
+/* the number of bits needed to store value */
+static int
+bits_needed(uint32_t value)
+{
+    int bits = 0;
+    while (value != 0) {
+        bits++;
+        value >>= 1;
+    }
+    return bits;
+}
+
+/**************** packed_size ****************/
+/* bytes taken by k values of the given number of bits */
+static size_t
+packed_size(int k, int bits)
+{
+    return ((size_t)k * bits + 7) / 8;
+}
+
+/**************** pack ****************/
+/* pack k values of the given width into out; return bytes written */
+static size_t
+pack(const uint32_t* values, int k, int bits, unsigned char* out)
+{
+    uint64_t acc = 0;
+    int have = 0;
+    size_t n = 0;
+    for (int i = 0; i < k; i++) {
+        acc |= (uint64_t)values[i] << have;
+        have += bits;
+        while (have >= 8) {
+            out[n++] = (unsigned char)acc;
+            acc >>= 8;
+            have -= 8;
+        }
+    }
+    if (have > 0) {
+        out[n++] = (unsigned char)acc;
+    }
+    return n;
+}
+
+/**************** unpack ****************/
+/* unpack k values of the given width from p, which holds enough bytes */
+static void
+unpack(const unsigned char* p, int k, int bits, int* values)
+{
+    uint64_t mask = (bits == 32) ? 0xffffffffu : ((uint64_t)1 << bits) - 1;
+    uint64_t acc = 0;
+    int have = 0;
+    for (int i = 0; i < k; i++) {
+        while (have < bits) {
+            acc |= (uint64_t)(*p++) << have;
+            have += 8;
+        }
+        values[i] = (int)(acc & mask);
+        acc >>= bits;
+        have -= bits;
+    }
+}
+
+/**************** block_widths ****************/
+/* bit widths for the gaps and counts of block [from, from + k) */
+static void
+block_widths(const int* docIDs, const int* counts, int from, int k,
+             int* gapBits, int* countBits)
+{
+    uint32_t gaps = 0, cnts = 0;
+    int prev = (from == 0) ? 0 : docIDs[from - 1];
+    for (int i = from; i < from + k; i++) {
+        gaps |= (uint32_t)(docIDs[i] - prev - 1);
+        cnts |= (uint32_t)(counts[i] - 1);
+        prev = docIDs[i];
+    }
+    *gapBits = bits_needed(gaps);
+    *countBits = bits_needed(cnts);
+}
+
+/**************** read_skip ****************/
+/* read the skip entry of the cursor's next block: its last docID
+ * and where its packed bytes start and stop; false if corrupt */
+static bool
+read_skip(postcursor_t* cursor, int* last, const unsigned char** data,
+          const unsigned char** dataEnd)
+{
+    const unsigned char* end = cursor->postings.end;
+    uint64_t delta, nbytes;
+    const unsigned char* p = varint_get(cursor->next, end, &delta);
+    if (p == NULL || (p = varint_get(p, end, &nbytes)) == NULL
+        || nbytes > (uint64_t)(end - p)
+        || delta == 0 || delta > (uint64_t)(INT32_MAX - cursor->blockLast)) {
+        return false;
+    }
+    *last = cursor->blockLast + (int)delta;
+    *data = p;
+    *dataEnd = p + nbytes;
+    return true;
+}
+
+/**************** load_block ****************/
+/* decode the cursor's next block; false at the end or if corrupt */
+static bool
+load_block(postcursor_t* cursor)
+{
+    int last;
+    const unsigned char* p;
+    const unsigned char* dataEnd;
+    if (cursor->remaining == 0 || !read_skip(cursor, &last, &p, &dataEnd)) {
+        return false;
+    }
+    int k = (cursor->remaining < POSTINGS_BLOCK) ? cursor->remaining : POSTINGS_BLOCK;
+    if (dataEnd - p < 2) {
+        return false;
+    }
+    int gapBits = p[0];
+    int countBits = p[1];
+    if (gapBits > 32 || countBits > 32
+        || (size_t)(dataEnd - p) != 2 + packed_size(k, gapBits) + packed_size(k, countBits)) {
+        return false;
+    }
+    unpack(p + 2, k, gapBits, cursor->docIDs);
+    unpack(p + 2 + packed_size(k, gapBits), k, countBits, cursor->counts);
+
+    // turn gaps into docIDs, and check they end where the skip entry says
+    int64_t docID = cursor->blockLast;
+    for (int i = 0; i < k; i++) {
+        docID += (int64_t)(uint32_t)cursor->docIDs[i] + 1;
+        if (docID > INT32_MAX) {
+            return false;
+        }
+        cursor->docIDs[i] = (int)docID;
+        cursor->counts[i] = (int)((uint32_t)cursor->counts[i] + 1);
+    }
+    if (docID != last) {
+        return false;
+    }
+    cursor->blockLast = last;
+    cursor->next = dataEnd;
+    cursor->remaining -= k;
+    cursor->pos = 0;
+    cursor->len = k;
+    return true;
+}
+
+/**************** skip_block ****************/
+/* step over the cursor's next block, if it ends before target;
+ * return true if it was skipped */
+static bool
+skip_block(postcursor_t* cursor, const int target)
+{
+    int last;
+    const unsigned char* data;
+    const unsigned char* dataEnd;
+    if (cursor->remaining <= POSTINGS_BLOCK     // never skip the last block
+        || !read_skip(cursor, &last, &data, &dataEnd) || last >= target) {
+        return false;
+    }
+    cursor->blockLast = last;
+    cursor->next = dataEnd;
+    cursor->remaining -= POSTINGS_BLOCK;
+    cursor->len = 0;
+    return true;
+}
+
+/**************** finish ****************/
+/* mark the cursor as past the end */
+static bool
+finish(postcursor_t* cursor)
+{
+    cursor->done = true;
+    cursor->docID = 0;
+    cursor->count = 0;
+    return false;
+}
+
+/**************** settle ****************/
+/* make docIDs[pos] the current posting */
+static bool
+settle(postcursor_t* cursor)
+{
+    cursor->docID = cursor->docIDs[cursor->pos];
+    cursor->count = cursor->counts[cursor->pos];
+    return true;
+}
+
+/**************** settle_counters ****************/
+/* make the first live counter at or after slot the current posting */
+static bool
+settle_counters(postcursor_t* cursor, int slot)
+{
+    int key, count;
+    while (counters_at(cursor->postings.counters, slot, &key, &count)) {
+        if (count > 0) {
+            cursor->slot = slot;
+            cursor->docID = key;
+            cursor->count = count;
+            return true;
+        }
+        slot++;
+    }
+    return finish(cursor);
+}
+
+/**************** next_posting ****************/
+/* move to the next posting, deleted or not */
+static bool
+next_posting(postcursor_t* cursor)
+{
+    if (cursor->postings.counters != NULL) {
+        return settle_counters(cursor, cursor->slot + 1);
+    }
+    if (cursor->pos + 1 < cursor->len) {
+        cursor->pos++;
+        return settle(cursor);
+    }
+    return load_block(cursor) ? settle(cursor) : finish(cursor);
+}
+
+/**************** advance_posting ****************/
+/* move to the first posting at or past target, deleted or not */
+static bool
+advance_posting(postcursor_t* cursor, const int target)
+{
+    if (cursor->postings.counters != NULL) {
+        int slot = counters_seek(cursor->postings.counters, target);
+        return settle_counters(cursor, (slot > cursor->slot) ? slot : cursor->slot + 1);
+    }
+
+    // unless target is in the decoded block, skip blocks that end before it
+    if (cursor->len == 0 || cursor->blockLast < target) {
+        while (skip_block(cursor, target)) {
+        }
+        if (!load_block(cursor)) {
+            return finish(cursor);
+        }
+        cursor->pos = -1;
+    }
+    // binary search the block for the first docID >= target;
+    // the block's last docID is >= target, so there is one
+    int lo = cursor->pos + 1;
+    int hi = cursor->len - 1;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (cursor->docIDs[mid] < target) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    cursor->pos = lo;
+    if (cursor->docIDs[lo] < target) {
+        return finish(cursor);     // only if the last block is short of target
+    }
+    return settle(cursor);
+}
+
+/**************** skip_deleted ****************/
+/* step past deleted postings from the current one; more is whether
+ * there is a current posting at all */
+static inline bool
+skip_deleted(postcursor_t* cursor, bool more)
+{
+    const postings_t* postings = &cursor->postings;
+    while (more && postings_isDeleted(postings->deleted, postings->deletedBytes,
+                                      cursor->docID)) {
+        more = next_posting(cursor);
+    }
+    return more;
+}
+
+/**************** global functions ****************/
+
+/**************** postings_fromCounters ****************/
+/* see postings.h header for more details */
+postings_t
+postings_fromCounters(counters_t* counters)
+{
+    postings_t postings = { counters, NULL, NULL, 0, NULL, 0 };
+    return postings;
+}
+
+/**************** postings_fromBytes ****************/
+/* see postings.h header for more details */
+postings_t
+postings_fromBytes(const unsigned char* bytes, const unsigned char* end, int size)
+{
+    postings_t postings = { NULL, bytes, end, size, NULL, 0 };
+    return postings;
+}
+
+/**************** postings_skipDeleted ****************/
+/* see postings.h header for more details */
+void
+postings_skipDeleted(postings_t* postings, const unsigned char* deleted, int deletedBytes)
+{
+    if (postings != NULL) {
+        postings->deleted = deleted;
+        postings->deletedBytes = (deleted == NULL) ? 0 : deletedBytes;
+    }
+}
+
+/**************** postings_size ****************/
+/* see postings.h header for more details */
+int
+postings_size(const postings_t* postings)
+{
+    if (postings == NULL) {
+        return 0;
+    }
+    if (postings->counters != NULL) {
+        return counters_size(postings->counters);
+    }
+    return postings->size;
+}
+
+/**************** postings_iterate ****************/
+/* see postings.h header for more details */
+void
+postings_iterate(const postings_t* postings, void* arg,
+                 void (*itemfunc)(void* arg, const int docID, const int count))
+{
+    if (postings == NULL || itemfunc == NULL) {
+        return;
+    }
+    postcursor_t cursor;
+    postings_cursor(postings, &cursor);
+    if (postings->deleted != NULL) {
+        while (postcursor_next(&cursor)) {
+            (*itemfunc)(arg, cursor.docID, cursor.count);
+        }
+        return;
+    }
+    if (postings->counters != NULL) {
+        counters_iterate(postings->counters, arg, itemfunc);
+        return;
+    }
+    while (load_block(&cursor)) {
+        for (int i = 0; i < cursor.len; i++) {
+            (*itemfunc)(arg, cursor.docIDs[i], cursor.counts[i]);
+        }
+    }
+}
+
+/**************** postings_encodedSize ****************/
+/* see postings.h header for more details */
+size_t
+postings_encodedSize(const int* docIDs, const int* counts, int n)
+{
+    size_t size = 0;
+    for (int from = 0; from < n; from += POSTINGS_BLOCK) {
+        int k = (n - from < POSTINGS_BLOCK) ? n - from : POSTINGS_BLOCK;
+        int gapBits, countBits;
+        block_widths(docIDs, counts, from, k, &gapBits, &countBits);
+        size += 2 * VARINT_MAX + 2 + packed_size(k, gapBits) + packed_size(k, countBits);
+    }
+    return size;
+}
+
+/**************** postings_encode ****************/
+/* see postings.h header for more details */
+size_t
+postings_encode(const int* docIDs, const int* counts, int n, unsigned char* out)
+{
+    uint32_t values[POSTINGS_BLOCK];
+    unsigned char* start = out;
+    for (int from = 0; from < n; from += POSTINGS_BLOCK) {
+        int k = (n - from < POSTINGS_BLOCK) ? n - from : POSTINGS_BLOCK;
+        int prev = (from == 0) ? 0 : docIDs[from - 1];
+        int gapBits, countBits;
+        block_widths(docIDs, counts, from, k, &gapBits, &countBits);
+
+        // skip entry, then the widths and the two packed arrays
+        out += varint_put(out, docIDs[from + k - 1] - prev);
+        out += varint_put(out, 2 + packed_size(k, gapBits) + packed_size(k, countBits));
+        *out++ = (unsigned char)gapBits;
+        *out++ = (unsigned char)countBits;
+        for (int i = 0; i < k; i++) {
+            values[i] = docIDs[from + i] - prev - 1;
+            prev = docIDs[from + i];
+        }
+        out += pack(values, k, gapBits, out);
+        for (int i = 0; i < k; i++) {
+            values[i] = counts[from + i] - 1;
+        }
+        out += pack(values, k, countBits, out);
+    }
+    return out - start;
+}
+
+/**************** postings_cursor ****************/
+/* see postings.h header for more details */
+void
+postings_cursor(const postings_t* postings, postcursor_t* cursor)
+{
+    cursor->postings = *postings;
+    cursor->docID = 0;
+    cursor->count = 0;
+    cursor->done = false;
+    cursor->slot = -1;
+    cursor->next = postings->bytes;
+    cursor->remaining = (postings->counters == NULL) ? postings->size : 0;
+    cursor->blockLast = 0;
+    cursor->pos = -1;
+    cursor->len = 0;
+}
+
+/**************** postcursor_next ****************/
+/* see postings.h header for more details */
+bool
+postcursor_next(postcursor_t* cursor)
+{
+    if (cursor->done) {
+        return false;
+    }
+    return skip_deleted(cursor, next_posting(cursor));
+}
+
+/**************** postcursor_advance ****************/
+/* see postings.h header for more details */
+bool
+postcursor_advance(postcursor_t* cursor, const int target)
+{
+    if (cursor->done) {
+        return false;
+    }
+    if (cursor->docID != 0 && cursor->docID >= target) {
+        return true;
+    }
+    return skip_deleted(cursor, advance_posting(cursor, target));
+}
+
+/**************** postcursor_docID ****************/
+/* see postings.h header for more details */
+int
+postcursor_docID(const postcursor_t* cursor)
+{
+    return cursor->docID;
+}
+
+/**************** postcursor_count ****************/
+/* see postings.h header for more details */
+int
+postcursor_count(const postcursor_t* cursor)
+{
+    return cursor->docID == 0 ? 0 : cursor->count;
+}
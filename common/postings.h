@@ -0,0 +1,169 @@
+// postings.h - header file for the postings module
+//
+// A postings_t is a read-only view of one word's (docID, count)
+// pairs, in increasing docID order.  It either wraps the counters
+// of an index built in memory, or points straight at the encoded
+// postings inside a memory-mapped index file; either way it is a
+// small struct the caller keeps on the stack, and reading it
+// allocates nothing.
+//
+// Encoded postings are split into blocks of POSTINGS_BLOCK.  Each
+// block starts with a skip entry, its last docID and its length in
+// bytes, so a cursor looking for a later docID can step over whole
+// blocks without decoding them.  Inside a block, the docID gaps and
+// the counts are bit-packed, each with just as many bits as the
+// largest of them needs.
+//
+// A view may also carry a bitmap of deleted docIDs, which its
+// cursors skip as they go, so the postings of a deleted document
+// are never seen although they are still in the index.
+//
+// Jake Fleming, 11/22/2024
+
+#ifndef __POSTINGS_H
+#define __POSTINGS_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "../libcs50/counters.h"
+
+/**************** constants ****************/
+#define POSTINGS_BLOCK 128      // postings per encoded block
+
+/**************** postings_t ****************/
+// Filled in by index_postings; treat the fields as private
+typedef struct postings {
+    counters_t* counters;           // postings of a built index, or NULL
+    const unsigned char* bytes;     // otherwise, the encoded blocks
+    const unsigned char* end;       // no further than here
+    int size;                       // number of postings in bytes
+    const unsigned char* deleted;   // bit d set if docID d is deleted, or NULL
+    int deletedBytes;               // bytes in deleted
+} postings_t;
+
+/**************** postcursor_t ****************/
+// A position in a postings_t; also private, and about 1KB, since
+// it holds one decoded block
+typedef struct postcursor {
+    postings_t postings;
+    int docID;                      // current posting, or 0 if none yet
+    int count;
+    bool done;                      // true once past the last posting
+    int slot;                       // counters: position of current posting
+    const unsigned char* next;      // bytes: next block's skip entry
+    int remaining;                  // bytes: postings in blocks after this one
+    int blockLast;                  // bytes: last docID of decoded block
+    int pos, len;                   // bytes: place in the decoded block
+    int docIDs[POSTINGS_BLOCK];
+    int counts[POSTINGS_BLOCK];
+} postcursor_t;
+
+/**************** postings_fromCounters ****************/
+/*
+ * Make a view of an existing counters_t, which must outlive it.
+ */
+postings_t postings_fromCounters(counters_t* counters);
+
+/**************** postings_fromBytes ****************/
+/*
+ * Make a view of size encoded postings starting at bytes;
+ * decoding never reads at or past end.
+ */
+postings_t postings_fromBytes(const unsigned char* bytes,
+                              const unsigned char* end, int size);
+
+/**************** postings_skipDeleted ****************/
+/*
+ * Have cursors on the postings, and postings_iterate, skip every
+ * docID d whose bit, (deleted[d / 8] >> (d % 8)) & 1, is set.
+ * The bitmap is deletedBytes long and must outlive the view;
+ * docIDs past its end are not deleted.
+ */
+void postings_skipDeleted(postings_t* postings,
+                          const unsigned char* deleted, int deletedBytes);
+
+/**************** postings_isDeleted ****************/
+/*
+ * Return true if docID's bit is set in the bitmap, as above.
+ */
+static inline bool
+postings_isDeleted(const unsigned char* deleted, int deletedBytes, int docID)
+{
+    return deleted != NULL && (docID >> 3) < deletedBytes
+           && ((deleted[docID >> 3] >> (docID & 7)) & 1) != 0;
+}
+
+/**************** postings_size ****************/
+/*
+ * Return the number of documents in the postings, 0 if NULL;
+ * deleted documents are included, so this is an upper bound
+ * on what a cursor will visit.
+ */
+int postings_size(const postings_t* postings);
+
+/**************** postings_iterate ****************/
+/*
+ * Call itemfunc(arg, docID, count) on every posting,
+ * in increasing docID order.
+ *
+ * Notes:
+ *   encoded postings that turn out to be corrupt end the
+ *   iteration early, at the first bad block.
+ */
+void postings_iterate(const postings_t* postings, void* arg,
+                      void (*itemfunc)(void* arg, const int docID, const int count));
+
+/**************** postings_encodedSize ****************/
+/*
+ * Return the number of bytes postings_encode needs for n postings.
+ *
+ * Inputs:
+ *   docIDs - n docIDs, positive and strictly increasing
+ *   counts - the n matching counts, all positive
+ */
+size_t postings_encodedSize(const int* docIDs, const int* counts, int n);
+
+/**************** postings_encode ****************/
+/*
+ * Encode n postings into out, which has room for
+ * postings_encodedSize bytes; return the number of bytes written.
+ * The number of postings is not part of the encoding; whoever
+ * stores it passes it back to postings_fromBytes.
+ */
+size_t postings_encode(const int* docIDs, const int* counts, int n, unsigned char* out);
+
+/**************** postings_cursor ****************/
+/*
+ * Start a cursor before the first posting of postings,
+ * which must outlive the cursor.
+ */
+void postings_cursor(const postings_t* postings, postcursor_t* cursor);
+
+/**************** postcursor_next ****************/
+/*
+ * Move the cursor to the next posting.
+ *
+ * Return:
+ *   true if there is one; false at the end (or on corrupt bytes)
+ */
+bool postcursor_next(postcursor_t* cursor);
+
+/**************** postcursor_advance ****************/
+/*
+ * Move the cursor forward to the first posting whose docID is at
+ * least target; if the current posting already is, stay there.
+ * Blocks that end before target are skipped without being decoded.
+ *
+ * Return:
+ *   true if there is such a posting; false at the end
+ */
+bool postcursor_advance(postcursor_t* cursor, const int target);
+
+/**************** postcursor_docID, postcursor_count ****************/
+/*
+ * Return the docID and count of the current posting.
+ */
+int postcursor_docID(const postcursor_t* cursor);
+int postcursor_count(const postcursor_t* cursor);
+
+#endif // __POSTINGS_H
@@ -0,0 +1,403 @@
+/*
+ * segments.c - a directory of index segments
+ *
+ * see segments.h for more information
+ *
+ * Jake Fleming - 11/28/24
+ */
+
+#define _POSIX_C_SOURCE 200809L     // opendir, stat
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "index.h"
+#include "segments.h"
+
+/**************** local types ****************/
+typedef struct segment {
+    int first;                  // lowest docID the segment covers
+    int last;                   // highest
+    off_t size;                 // bytes in its file
+    char* path;
+    index_t* index;             // the file mapped, or NULL
+} segment_t;
+
+/**************** global types ****************/
+struct segments {
+    segment_t* list;            // in docID order
+    int count;
+    int capacity;
+};
+
+/**************** local constants ****************/
+static const off_t TIER_SIZE = 65536;       // segments up to here are tier 0
+static const int NAME_LEN = 25;             // strlen("0000000001-0000000400.seg")
+
+/**************** local functions ****************/
+
+/**************** segment_path ****************/
+/* return the malloc'd path of the segment for first..last in dirname */
+static char*
+segment_path(const char* dirname, int first, int last)
+{
+    size_t len = strlen(dirname) + NAME_LEN + 2;
+    char* path = malloc(len);
+    if (path != NULL) {
+        snprintf(path, len, "%s/%010d-%010d.seg", dirname, first, last);
+    }
+    return path;
+}
+
+/**************** list_add ****************/
+/* append a copy of seg to the list */
+static bool
+list_add(segments_t* segs, segment_t* seg)
+{
+    if (segs->count == segs->capacity) {
+        int capacity = (segs->capacity == 0) ? 16 : 2 * segs->capacity;
+        segment_t* list = realloc(segs->list, capacity * sizeof(segment_t));
+        if (list == NULL) {
+            return false;
+        }
+        segs->list = list;
+        segs->capacity = capacity;
+    }
+    segs->list[segs->count++] = *seg;
+    return true;
+}
+
+/**************** list_free ****************/
+/* unmap and free every segment of the list, and the list */
+static void
+list_free(segments_t* segs)
+{
+    for (int i = 0; i < segs->count; i++) {
+        index_delete(segs->list[i].index);
+        free(segs->list[i].path);
+    }
+    free(segs->list);
+    segs->list = NULL;
+    segs->count = segs->capacity = 0;
+}
+
+/**************** compare_segments ****************/
+/* order segments by first docID, and the widest first among equals */
+static int
+compare_segments(const void* a, const void* b)
+{
+    const segment_t* first = a;
+    const segment_t* second = b;
+    if (first->first != second->first) {
+        return (first->first < second->first) ? -1 : 1;
+    }
+    return (first->last > second->last) ? -1 : (first->last < second->last);
+}
+
+/**************** scan ****************/
+/* list the directory's segments in docID order into live; those whose
+ * range lies within one listed before go into stale, if given, and
+ * those that overlap one are dropped; false if not a directory */
+static bool
+scan(const char* dirname, segments_t* live, segments_t* stale)
+{
+    segments_t all = { NULL, 0, 0 };
+    DIR* dir = opendir(dirname);
+    if (dir == NULL) {
+        return false;
+    }
+    bool ok = true;
+    struct dirent* entry;
+    while (ok && (entry = readdir(dir)) != NULL) {
+        segment_t seg = { 0, 0, 0, NULL, NULL };
+        int n = 0;
+        if (strlen(entry->d_name) != (size_t)NAME_LEN
+            || sscanf(entry->d_name, "%d-%d.seg%n", &seg.first, &seg.last, &n) != 2
+            || n != NAME_LEN || seg.first < 1 || seg.last < seg.first) {
+            continue;       // not a segment; perhaps a merge in progress
+        }
+        struct stat st;
+        seg.path = segment_path(dirname, seg.first, seg.last);
+        if (seg.path == NULL || stat(seg.path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            free(seg.path);
+            continue;
+        }
+        seg.size = st.st_size;
+        if (!list_add(&all, &seg)) {
+            free(seg.path);
+            ok = false;
+        }
+    }
+    closedir(dir);
+
+    if (all.count > 0) {
+        qsort(all.list, all.count, sizeof(segment_t), compare_segments);
+    }
+    for (int i = 0; i < all.count; i++) {
+        segment_t* seg = &all.list[i];
+        int lastLive = (live->count == 0) ? 0 : live->list[live->count - 1].last;
+        bool isLive = (seg->first > lastLive);
+        bool isStale = (seg->last <= lastLive);    // else it overlaps; ignore it
+        if (ok && isLive) {
+            ok = list_add(live, seg);
+            if (!ok) {
+                free(seg->path);
+            }
+        }
+        else if (!ok || !isStale || stale == NULL || !list_add(stale, seg)) {
+            free(seg->path);
+        }
+    }
+    free(all.list);
+    if (!ok) {
+        list_free(live);
+    }
+    return ok;
+}
+
+/**************** tier ****************/
+/* the tier of a segment of the given size */
+static int
+tier(off_t size, int fanout)
+{
+    int t = 0;
+    for (off_t rest = size / TIER_SIZE; rest > 0; rest /= fanout) {
+        t++;
+    }
+    return t;
+}
+
+/**************** merge_run ****************/
+/* merge segments [from, to) of the list into one, then remove them;
+ * a single segment is rewritten in place, without its deleted docs */
+static bool
+merge_run(const char* dirname, segments_t* segs, int from, int to, FILE* log)
+{
+    int n = to - from;
+    index_t** indexes = calloc(n, sizeof(index_t*));
+    char* path = segment_path(dirname, segs->list[from].first, segs->list[to - 1].last);
+    bool ok = (indexes != NULL && path != NULL);
+    for (int i = 0; i < n && ok; i++) {
+        indexes[i] = segs->list[from + i].index = index_map(segs->list[from + i].path);
+        ok = (indexes[i] != NULL);
+    }
+    ok = ok && index_merge(indexes, n, path);
+    for (int i = from; i < to; i++) {
+        index_delete(segs->list[i].index);
+        segs->list[i].index = NULL;
+        if (ok && n > 1) {
+            unlink(segs->list[i].path);
+        }
+    }
+    if (ok && log != NULL && n == 1) {
+        fprintf(log, "compacted %s, dropping its deleted documents\n", path);
+    }
+    else if (ok && log != NULL) {
+        fprintf(log, "merged %d segments, docIDs %d-%d, into %s\n",
+                n, segs->list[from].first, segs->list[to - 1].last, path);
+    }
+    free(path);
+    free(indexes);
+    return ok;
+}
+
+/**************** pick_run ****************/
+/* find the newest run of fanout neighboring segments of one tier,
+ * or all of them if fanout is 0, even if that is one segment with
+ * deleted documents; false if there is none */
+static bool
+pick_run(segments_t* segs, int fanout, int* from, int* to)
+{
+    if (fanout == 0) {
+        *from = 0;
+        *to = segs->count;
+        if (segs->count == 1) {
+            index_t* index = index_map(segs->list[0].path);
+            bool deleted = index_numDeleted(index) > 0;
+            index_delete(index);
+            return deleted;
+        }
+        return segs->count > 1;
+    }
+    int run = 0;
+    for (int i = segs->count - 1; i >= 0; i--) {
+        int t = tier(segs->list[i].size, fanout);
+        run = (run > 0 && t == tier(segs->list[i + 1].size, fanout)) ? run + 1 : 1;
+        if (run == fanout) {
+            *from = i;
+            *to = i + fanout;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**************** global functions ****************/
+
+/**************** segments_open ****************/
+/* see segments.h header for more details */
+segments_t*
+segments_open(const char* dirname)
+{
+    if (dirname == NULL) {
+        return NULL;
+    }
+    segments_t* segs = calloc(1, sizeof(segments_t));
+    if (segs == NULL) {
+        return NULL;
+    }
+    if (!scan(dirname, segs, NULL)) {
+        free(segs);
+        return NULL;
+    }
+    for (int i = 0; i < segs->count; i++) {
+        segs->list[i].index = index_map(segs->list[i].path);
+        if (segs->list[i].index == NULL) {
+            segments_close(segs);
+            return NULL;
+        }
+    }
+    return segs;
+}
+
+/**************** segments_count ****************/
+/* see segments.h header for more details */
+int
+segments_count(segments_t* segs)
+{
+    return (segs == NULL) ? 0 : segs->count;
+}
+
+/**************** segments_index ****************/
+/* see segments.h header for more details */
+index_t*
+segments_index(segments_t* segs, int i)
+{
+    if (segs == NULL || i < 0 || i >= segs->count) {
+        return NULL;
+    }
+    return segs->list[i].index;
+}
+
+/**************** segments_close ****************/
+/* see segments.h header for more details */
+void
+segments_close(segments_t* segs)
+{
+    if (segs != NULL) {
+        list_free(segs);
+        free(segs);
+    }
+}
+
+/**************** segments_last ****************/
+/* see segments.h header for more details */
+int
+segments_last(const char* dirname)
+{
+    segments_t segs = { NULL, 0, 0 };
+    if (dirname == NULL || !scan(dirname, &segs, NULL)) {
+        return -1;
+    }
+    int last = (segs.count == 0) ? 0 : segs.list[segs.count - 1].last;
+    list_free(&segs);
+    return last;
+}
+
+/**************** segments_add ****************/
+/* see segments.h header for more details */
+bool
+segments_add(const char* dirname, index_t* index, int firstDocID, int lastDocID)
+{
+    if (dirname == NULL || index == NULL || firstDocID < 1 || lastDocID < firstDocID) {
+        return false;
+    }
+    int last = segments_last(dirname);
+    if (last < 0 || firstDocID <= last) {
+        return false;
+    }
+    char* path = segment_path(dirname, firstDocID, lastDocID);
+    bool ok = (path != NULL) && index_saveFile(index, path, INDEX_BINARY);
+    free(path);
+    return ok;
+}
+
+/**************** segments_deleteDocs ****************/
+/* see segments.h header for more details */
+int
+segments_deleteDocs(const char* dirname, const int* docIDs, const int n, bool* deleted)
+{
+    segments_t segs = { NULL, 0, 0 };
+    if (dirname == NULL || docIDs == NULL || deleted == NULL || n < 0) {
+        return -1;
+    }
+    for (int j = 0; j < n; j++) {
+        deleted[j] = false;
+    }
+    if (!scan(dirname, &segs, NULL)) {
+        return -1;
+    }
+
+    // map each segment that covers some docID once, for all of them
+    int count = 0;
+    for (int i = 0; i < segs.count; i++) {
+        segment_t* seg = &segs.list[i];
+        index_t* index = NULL;
+        for (int j = 0; j < n; j++) {
+            if (docIDs[j] < seg->first || docIDs[j] > seg->last) {
+                continue;
+            }
+            if (index == NULL && (index = index_map(seg->path)) == NULL) {
+                break;
+            }
+            // a page past the segment's last posting has none to hide
+            deleted[j] = docIDs[j] > index_lastDocID(index)
+                         || index_markDeleted(seg->path, docIDs[j]);
+            count += deleted[j];
+        }
+        index_delete(index);
+    }
+    list_free(&segs);
+    return count;
+}
+
+/**************** segments_merge ****************/
+/* see segments.h header for more details */
+int
+segments_merge(const char* dirname, int fanout, FILE* log)
+{
+    if (dirname == NULL || fanout == 1 || fanout < 0) {
+        return -1;
+    }
+
+    // first clear out the inputs of a merge that stopped short of it
+    segments_t segs = { NULL, 0, 0 };
+    segments_t stale = { NULL, 0, 0 };
+    if (!scan(dirname, &segs, &stale)) {
+        list_free(&stale);
+        return -1;
+    }
+    for (int i = 0; i < stale.count; i++) {
+        unlink(stale.list[i].path);
+    }
+    list_free(&stale);
+
+    int merges = 0;
+    int from, to;
+    while (pick_run(&segs, fanout, &from, &to)) {
+        if (!merge_run(dirname, &segs, from, to, log)) {
+            list_free(&segs);
+            return -1;
+        }
+        merges++;
+        list_free(&segs);
+        if (!scan(dirname, &segs, NULL)) {
+            return -1;
+        }
+    }
+    list_free(&segs);
+    return merges;
+}
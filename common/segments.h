@@ -0,0 +1,127 @@
+// segments.h - header file for the segments module
+//
+// A segmented index is a directory of binary index files, the
+// segments, each holding the postings of one range of docIDs.  A
+// segment's postings never change once written: new pages go into a new
+// segment after the last one, and small segments are merged into
+// bigger ones, which replace them.  Adding pages therefore costs time
+// in proportion to the new pages, not to the whole index.
+//
+// A segment's file is named for its range of docIDs, zero-padded so
+// that the names sort in docID order:
+//   0000000001-0000000400.seg
+// Deleting a document sets its bit in the deleted-docs bitmap of the
+// segment that holds it, in place (see index_markDeleted); the next
+// merge of that segment drops its postings.
+//
+// A merge writes its output under a temporary name, renames it into
+// place and only then removes its inputs, so a reader may for a moment
+// see both; a segment whose range lies within another's is ignored.
+//
+// Jake Fleming, 11/28/2024
+
+#ifndef __SEGMENTS_H
+#define __SEGMENTS_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "index.h"
+
+/**************** constants ****************/
+#define SEGMENTS_FANOUT 10      // segments of one size merged at a time
+
+/**************** types ****************/
+// Opaque structure for the segments of a directory, mapped for reading
+typedef struct segments segments_t;
+
+/**************** segments_open ****************/
+/*
+ * Map every segment in the directory with index_map.
+ * Caller is responsible for later calling segments_close.
+ *
+ * Return:
+ *   a pointer to the segments, or NULL if dirname is not a directory,
+ *   a segment cannot be mapped, or out of memory
+ */
+segments_t* segments_open(const char* dirname);
+
+/**************** segments_count ****************/
+/*
+ * Return the number of segments, 0 if NULL.
+ */
+int segments_count(segments_t* segs);
+
+/**************** segments_index ****************/
+/*
+ * Return the i-th segment in docID order, counting from 0, as a mapped
+ * index; it belongs to segs and is unmapped by segments_close.
+ */
+index_t* segments_index(segments_t* segs, int i);
+
+/**************** segments_close ****************/
+/*
+ * Unmap all the segments and free segs.
+ */
+void segments_close(segments_t* segs);
+
+/**************** segments_last ****************/
+/*
+ * Return the highest docID any segment in the directory covers,
+ * or 0 if there are no segments; -1 if dirname is not a directory.
+ */
+int segments_last(const char* dirname);
+
+/**************** segments_add ****************/
+/*
+ * Save an index of the pages firstDocID through lastDocID as a new
+ * segment of the directory.
+ *
+ * Inputs:
+ *   dirname - the segment directory
+ *   index - an index built in memory, holding no docIDs outside the range
+ *   firstDocID, lastDocID - the range, which must come after every
+ *                           segment already there
+ *
+ * Return:
+ *   true if successful, false otherwise
+ */
+bool segments_add(const char* dirname, index_t* index, int firstDocID, int lastDocID);
+
+/**************** segments_deleteDocs ****************/
+/*
+ * Mark documents deleted in the segments that cover them, in place,
+ * scanning the directory and mapping each segment once for them all.
+ *
+ * Inputs:
+ *   docIDs - the n documents to delete, in any order
+ *   deleted - n flags, set to whether each one was deleted; false if
+ *     no segment covers it, or on error
+ *
+ * Return:
+ *   the number deleted, or -1 if the directory cannot be read
+ */
+int segments_deleteDocs(const char* dirname, const int* docIDs, const int n, bool* deleted);
+
+/**************** segments_merge ****************/
+/*
+ * Merge segments with a tiered policy.  Each segment has a tier by
+ * its file size: tier 0 up to 64KB, and one tier up for each factor
+ * of fanout beyond that.  Whenever fanout neighboring segments share
+ * a tier, they are merged into one, which usually lands a tier up;
+ * this repeats until no such run is left.  Each segment is thus
+ * merged about log(size) times in all, however the index grew.
+ * Leftovers of an interrupted merge are removed first.
+ *
+ * Inputs:
+ *   dirname - the segment directory
+ *   fanout - segments per merge, at least 2; or 0 to merge all the
+ *            segments into one, which also compacts a lone segment
+ *            with deleted documents
+ *   log - where to report each merge (may be NULL)
+ *
+ * Return:
+ *   the number of merges done, or -1 on error
+ */
+int segments_merge(const char* dirname, int fanout, FILE* log);
+
+#endif // __SEGMENTS_H
@@ -5,9 +5,13 @@
 // Jake Fleming, 10/28/2024
 
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
 #include "word.h"
 
+/************ local constants ************/
+#define SCRATCH_SIZE 128        // letters of a word scanWords holds on the stack
+
 /************ normalizeWord ************/
 /* see word.h for more details */
 void 
@@ -22,4 +26,77 @@ normalizeWord(char* word)
             *c = tolower(*c);
         }
     }
-}
\ No newline at end of file
+}
+
+/************ local types ************/
+// what scanWords keeps while webpage_iterateWords calls scanSpan
+typedef struct scan {
+    int minLength;                      // shortest word passed on
+    void* arg;                          // the caller's arg and itemfunc
+    void (*itemfunc)(void* arg, const char* word, const int len);
+    char scratch[SCRATCH_SIZE];         // the word, lowercased
+    char* buffer;                       // scratch, or a bigger one
+    int capacity;                       // size of buffer
+    int count;                          // words passed on, or -1
+} scan_t;
+
+/************ local functions ************/
+static void scanSpan(void* arg, const char* span, const int len);
+
+/************ scanWords ************/
+/* see word.h for more details */
+int
+scanWords(webpage_t* page, const int minLength, void* arg,
+          void (*itemfunc)(void* arg, const char* word, const int len))
+{
+    if (page == NULL || itemfunc == NULL) {
+        return 0;
+    }
+    scan_t scan;
+    scan.minLength = minLength;
+    scan.arg = arg;
+    scan.itemfunc = itemfunc;
+    scan.buffer = scan.scratch;
+    scan.capacity = SCRATCH_SIZE;
+    scan.count = 0;
+
+    webpage_iterateWords(page, &scan, scanSpan);
+
+    if (scan.buffer != scan.scratch) {
+        free(scan.buffer);
+    }
+    return scan.count;
+}
+
+/************ scanSpan ************/
+/* lowercase one word found by webpage_iterateWords and pass it on */
+static void
+scanSpan(void* arg, const char* span, const int len)
+{
+    scan_t* scan = arg;
+    if (len < scan->minLength || scan->count < 0) {
+        return;
+    }
+    if (len >= scan->capacity) {
+        char* bigger = malloc(len + 1);
+        if (bigger == NULL) {
+            scan->count = -1;
+            return;
+        }
+        if (scan->buffer != scan->scratch) {
+            free(scan->buffer);
+        }
+        scan->buffer = bigger;
+        scan->capacity = len + 1;
+    }
+
+    // a span is all letters, so lowercasing is just the A-Z range
+    char* buffer = scan->buffer;
+    for (int i = 0; i < len; i++) {
+        char c = span[i];
+        buffer[i] = (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+    }
+    buffer[len] = '\0';
+    (*scan->itemfunc)(scan->arg, buffer, len);
+    scan->count++;
+}
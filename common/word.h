@@ -8,6 +8,7 @@
 #define __WORD_H
 
 #include <stdbool.h>
+#include "../libcs50/webpage.h"
 
 /**************** normalizeWord ****************/
 /* Normalize the given word to lowercase. 
@@ -19,4 +20,26 @@
  */
 void normalizeWord(char* word);
 
+/**************** scanWords ****************/
+/* Call itemfunc on each word of the page's html that is at least
+ * minLength letters long, in order, normalized to lowercase.
+ * Words are found with webpage_iterateWords and lowercased into a
+ * scratch buffer reused from word to word, so short words are
+ * dropped, and the rest passed on, without allocating anything
+ * for words under 128 letters; a longer word moves the buffer to
+ * the heap, reallocated to fit each longer word after it.
+ *
+ * Inputs:
+ *   page - the webpage, with html
+ *   minLength - the fewest letters a word passed on has
+ *   arg - passed to itemfunc
+ *   itemfunc - called with arg, the NUL-terminated word, and its
+ *              length; the word is only good until itemfunc returns
+ *
+ * Return:
+ *   the number of words passed to itemfunc, or -1 if out of memory
+ */
+int scanWords(webpage_t* page, const int minLength, void* arg,
+              void (*itemfunc)(void* arg, const char* word, const int len));
+
 #endif // __WORD_H
\ No newline at end of file
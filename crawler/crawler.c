@@ -18,6 +18,7 @@
 #include "../libcs50/bag.h"
 #include "../libcs50/hashtable.h"
 #include "../libcs50/webpage.h"
+#include "../libcs50/mem.h"
 #include "../common/pagedir.h"
 
 
@@ -43,6 +44,9 @@ main(int argc, char* argv[])
     char* pageDirectory;
     int maxDepth;
 
+    // memory report at exit, if TSE_MEMREPORT is set
+    mem_reportAtExit();
+
     parseArgs(argc, argv, &seedURL, &pageDirectory, &maxDepth);
     crawl(seedURL, pageDirectory, maxDepth);
 
@@ -110,7 +114,8 @@ parseArgs(const int argc, char* argv[],
 /* Perform the web crawl on every webpage
  * in the bag, checking if they have been
  * visited and scanning them into the bag
- * if we haven't reached the maxDepth
+ * if we haven't reached the maxDepth; then
+ * write the manifest of the pages saved
  *
  * Inputs: 
  *   seedURL - URL of where crawler starts
@@ -125,14 +130,19 @@ crawl(char* seedURL, char* pageDirectory, const int maxDepth)
     bag_t* pagesToCrawl = bag_new();
     int docID = 1;
 
+    // the manifest of the pages saved, written when the crawl is done
+    pagedir_manifest_t* manifest = pagedir_manifestNew();
+
     // add seedURL to both
     hashtable_insert(pagesSeen, seedURL, "");
     bag_insert(pagesToCrawl, webpage_new(seedURL, 0, NULL));
+    mem_account(MEM_FRONTIER, strlen(seedURL) + 1);
 
     // loop through every URL in the bag
     webpage_t* page;
     while ((page = bag_extract(pagesToCrawl)) != NULL) {
         int depth = webpage_getDepth(page);
+        mem_account(MEM_FRONTIER, -(long)(strlen(webpage_getURL(page)) + 1));
 
         // fetch html - sleep(1) is within this method
         if (webpage_fetch(page)) {
@@ -141,6 +151,11 @@ crawl(char* seedURL, char* pageDirectory, const int maxDepth)
 
             // save webpage to pageDirectory
             pagedir_save(page, pageDirectory, docID);
+            if (manifest != NULL && !pagedir_manifestAdd(manifest, page, docID)) {
+                fprintf(stderr, "Error: Out of memory for the manifest; not writing one\n");
+                pagedir_manifestDelete(manifest);
+                manifest = NULL;
+            }
             docID++;
             
             // scan html if we haven't reached maxDepth
@@ -157,6 +172,13 @@ crawl(char* seedURL, char* pageDirectory, const int maxDepth)
         // free memory and sleep between fetches
         webpage_delete(page);
     }
+    // without a manifest, readers of pageDirectory fall back to
+    // loading docIDs in turn until one is missing
+    if (manifest != NULL && !pagedir_manifestSave(manifest, pageDirectory)) {
+        fprintf(stderr, "Error: Could not write the manifest in %s\n", pageDirectory);
+    }
+    pagedir_manifestDelete(manifest);
+
     // free memory
     hashtable_delete(pagesSeen, dummyDelete);
     bag_delete(pagesToCrawl, webpage_delete);
@@ -196,6 +218,7 @@ pageScan(webpage_t* page, bag_t* pagesToCrawl, hashtable_t* pagesSeen)
                 // add to pagesToCrawl at a higher depth
                 webpage_t* newPage = webpage_new(normalizedURL, webpage_getDepth(page) + 1, NULL);
                 bag_insert(pagesToCrawl, newPage);
+                mem_account(MEM_FRONTIER, strlen(normalizedURL) + 1);
             }
             else {
                 // log
@@ -0,0 +1,65 @@
+/*
+ * pagedirtest.c - Test program for the manifest of a pageDirectory
+ *
+ * Writes the manifest of a pageDirectory from the pages already in
+ * it, as the crawler would have at the end of its crawl, so that
+ * readers of the manifest can be tested on pages that were not
+ * crawled, or were crawled before the crawler wrote manifests.
+ *
+ * Jake Fleming - 12/09/24
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../common/pagedir.h"
+#include "../libcs50/webpage.h"
+
+/************ main *************/
+/* test pagedir_manifestAdd and pagedir_manifestSave
+ * by adding every page of a pageDirectory, from docID 1
+ * up to the first that is missing, to a new manifest
+ *
+ * Usage:
+ *   ./pagedirtest pageDirectory
+ */
+int
+main(int argc, char* argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "Usage: ./pagedirtest pageDirectory\n");
+        return 1;
+    }
+    char* pageDirectory = argv[1];
+    if (!pagedir_validate(pageDirectory)) {
+        fprintf(stderr, "Error: Invalid pageDirectory: %s\n", pageDirectory);
+        return 2;
+    }
+
+    pagedir_manifest_t* manifest = pagedir_manifestNew();
+    if (manifest == NULL) {
+        fprintf(stderr, "Error: Out of memory for the manifest\n");
+        return 3;
+    }
+
+    // the pages as saved, in docID order, as the crawler adds them
+    webpage_t* page;
+    for (int docID = 1; (page = pagedir_load(pageDirectory, docID)) != NULL; docID++) {
+        bool added = pagedir_manifestAdd(manifest, page, docID);
+        webpage_delete(page);
+        if (!added) {
+            fprintf(stderr, "Error: Could not add docID %d to the manifest\n", docID);
+            pagedir_manifestDelete(manifest);
+            return 3;
+        }
+    }
+
+    if (!pagedir_manifestSave(manifest, pageDirectory)) {
+        fprintf(stderr, "Error: Could not write the manifest in %s\n", pageDirectory);
+        pagedir_manifestDelete(manifest);
+        return 4;
+    }
+    printf("Wrote the manifest of %d pages in %s\n",
+           pagedir_manifestCount(manifest), pageDirectory);
+    pagedir_manifestDelete(manifest);
+    return 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * docdelete.c - delete documents from an index
+ *
+ * Marks documents deleted, so queries no longer find them, without
+ * rebuilding the index.  In a binary index or a segment, that sets a
+ * bit in the file's deleted-docs bitmap in place, and queriers that
+ * have the file mapped stop seeing the documents at once; the
+ * postings themselves go at the next merge (see segmerge -a).  A text
+ * index is loaded, and saved again without the documents.
+ *
+ * Jake Fleming - 12/02/24
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../common/index.h"
+#include "../common/segments.h"
+
+/************ Function Prototypes ************/
+static int deleteText(char* indexFilename, int* docIDs, int n);
+
+/************ main *************/
+/* delete each docID given from the index
+ *
+ * Usage:
+ *   ./docdelete indexFilename|segmentDirectory docID...
+ */
+int
+main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        fprintf(stderr, "Usage: ./docdelete indexFilename|segmentDirectory docID...\n");
+        return 1;
+    }
+    char* indexFilename = argv[1];
+    int n = argc - 2;
+    int* docIDs = malloc(n * sizeof(int));
+    if (docIDs == NULL) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return 3;
+    }
+    for (int i = 0; i < n; i++) {
+        char* end;
+        long docID = strtol(argv[i + 2], &end, 10);
+        if (*argv[i + 2] == '\0' || *end != '\0' || docID < 1 || docID > 2147483647) {
+            fprintf(stderr, "Error: Invalid docID: %s\n", argv[i + 2]);
+            free(docIDs);
+            return 1;
+        }
+        docIDs[i] = (int)docID;
+    }
+
+    // a segment directory, a binary index, or else a text index;
+    // a segment directory is scanned once for all the docIDs
+    int status = 0;
+    bool segmented = (segments_last(indexFilename) >= 0);
+    index_t* mapped = segmented ? NULL : index_map(indexFilename);
+    bool isBinary = (mapped != NULL);
+    index_delete(mapped);
+    bool* deleted = calloc(n, sizeof(bool));
+    if (deleted == NULL) {
+        fprintf(stderr, "Error: Out of memory\n");
+        free(docIDs);
+        return 3;
+    }
+    if (segmented) {
+        segments_deleteDocs(indexFilename, docIDs, n, deleted);
+    }
+    else if (!isBinary) {
+        status = deleteText(indexFilename, docIDs, n);
+    }
+    for (int i = 0; i < n && (segmented || isBinary); i++) {
+        bool ok = segmented ? deleted[i] : index_markDeleted(indexFilename, docIDs[i]);
+        if (ok) {
+            printf("Deleted docID %d from %s\n", docIDs[i], indexFilename);
+        }
+        else {
+            fprintf(stderr, "Error: Could not delete docID %d from %s\n",
+                    docIDs[i], indexFilename);
+            status = 3;
+        }
+    }
+    free(deleted);
+    free(docIDs);
+    return status;
+}
+
+/************ deleteText ************/
+/* Load a text index, delete the documents from it,
+ * and save it back in their place
+ *
+ * inputs:
+ *   indexFilename - the text index
+ *   docIDs - the n documents to delete
+ *
+ * return:
+ *   the exit status for main
+ */
+static int
+deleteText(char* indexFilename, int* docIDs, int n)
+{
+    FILE* fp = fopen(indexFilename, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Error: Could not open %s\n", indexFilename);
+        return 2;
+    }
+    index_t* index = index_new(500);
+    bool loaded = (index != NULL) && index_load(index, fp);
+    fclose(fp);
+    if (!loaded) {
+        fprintf(stderr, "Error: Could not load the index in %s\n", indexFilename);
+        index_delete(index);
+        return 2;
+    }
+    for (int i = 0; i < n; i++) {
+        if (!index_deleteDoc(index, docIDs[i])) {
+            fprintf(stderr, "Error: Could not delete docID %d\n", docIDs[i]);
+            index_delete(index);
+            return 3;
+        }
+    }
+    if (!index_saveFile(index, indexFilename, INDEX_TEXT)) {
+        fprintf(stderr, "Error: Failed to save index to file\n");
+        index_delete(index);
+        return 3;
+    }
+    for (int i = 0; i < n; i++) {
+        printf("Deleted docID %d from %s\n", docIDs[i], indexFilename);
+    }
+    index_delete(index);
+    return 0;
+}
@@ -3,7 +3,15 @@
  * 
  * Reads the documents from the given pageDirectory and builds an index
  * of words and their occurrences across documents. Saves this index
- * to a file
+ * to a file.  With --incremental, reads the index already in the
+ * file and adds only the pages after the last docID it holds.
+ * With -j, several threads index pages at once, each into an index
+ * of its own, and the partial indexes are merged at the end.  With
+ * -m, the index is written out in sorted runs whenever it outgrows a
+ * memory budget, and the runs are merged into the index file.
+ * Pages are found through the manifest of pageDirectory, if the
+ * crawler wrote one, and otherwise by loading docIDs 1, 2, 3...
+ * until one is missing.
  * 
  * Jake Fleming - 10/28/24
  */
@@ -11,73 +19,527 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
 #include "../common/index.h"
 #include "../common/pagedir.h"
+#include "../common/segments.h"
 #include "../common/word.h"
 #include "../libcs50/webpage.h"
+#include "../libcs50/mem.h"
+
+/************ Local Types ************/
+// the pages left to index, handed out in docID order to the threads
+typedef struct pagequeue {
+    char* pageDirectory;
+    const pagedir_manifest_t* manifest;     // or NULL, for no manifest
+    int next;               // the next docID to hand out
+    int stop;               // the first docID found to have no page
+    pthread_mutex_t lock;
+} pagequeue_t;
+
+// where the words of a page go, for indexWord
+typedef struct pagewords {
+    index_t* index;
+    int docID;
+} pagewords_t;
+
+// one indexing thread and the partial index it builds
+typedef struct worker {
+    pagequeue_t* queue;
+    index_t* part;
+    int first;              // with a manifest: the entries to index,
+    int stop;               // from first up to stop, instead of the queue
+} worker_t;
+
+/************ Constants ************/
+#define MAX_THREADS 64
+#define BYTES_PER_WORD 1024     // html per distinct word, roughly, to presize by
+#define DEFAULT_SLOTS 500       // hashtable slots without a manifest to go by
+#define MAX_SLOTS (1 << 22)
 
 /************ Function Prototypes ************/
-static index_t* indexBuild(char* pageDirectory);
+static int indexDirectory(char* pageDirectory, const pagedir_manifest_t* manifest,
+                          char* indexFilename, const bool incremental,
+                          const int threads, const long budget);
+static int indexBuild(index_t* index, char* pageDirectory,
+                      const pagedir_manifest_t* manifest, const int firstDocID,
+                      const int threads, const long budget);
+static int indexExternal(char* pageDirectory, const pagedir_manifest_t* manifest,
+                         char* indexFilename, const long budget);
+static char* runFilename(char* indexFilename, const int run);
+static bool canWrite(const char* filename);
+static long indexMemory(void);
+static int indexSlots(const pagedir_manifest_t* manifest, const int firstDocID,
+                      const int ways);
+static int indexParallel(index_t* index, char* pageDirectory,
+                         const pagedir_manifest_t* manifest, const int firstDocID,
+                         const int threads);
+static void splitBytes(const pagedir_manifest_t* manifest, const int firstDocID,
+                       worker_t* workers, const int n);
+static void* indexWorker(void* arg);
+static int indexIncremental(char* pageDirectory, const pagedir_manifest_t* manifest,
+                            char* indexFilename, const int threads);
+static int indexSegment(char* pageDirectory, const pagedir_manifest_t* manifest,
+                        char* segmentDirectory, const int threads, const long budget);
+static void indexEntry(index_t* index, char* pageDirectory,
+                       const pagedir_entry_t* entry);
 static void indexPage(index_t* index, webpage_t* page, const int docID);
+static void indexWord(void* arg, const char* word, const int len);
 
 /***************** main *****************/
 /* processes the arguments and runs indexer */
 int
 main(int argc, char* argv[])
 {
-    // check for 3 arguments
-    if (argc != 3) {
-        fprintf(stderr, "Usage: ./indexer pageDirectory indexFilename\n");
+    // memory report at exit, if TSE_MEMREPORT is set
+    mem_reportAtExit();
+
+    // options first: --incremental, -j with a number of threads,
+    // and -m with a memory budget in megabytes
+    bool incremental = false;
+    int threads = 1;
+    long budget = 0;
+    int arg = 1;
+    while (arg < argc && argv[arg][0] == '-') {
+        if (strcmp(argv[arg], "--incremental") == 0) {
+            incremental = true;
+            arg++;
+        }
+        else if (strcmp(argv[arg], "-j") == 0 && arg + 1 < argc) {
+            char* end;
+            long n = strtol(argv[arg + 1], &end, 10);
+            if (*argv[arg + 1] == '\0' || *end != '\0' || n < 1 || n > MAX_THREADS) {
+                fprintf(stderr, "Error: -j takes a number of threads from 1 to %d\n",
+                        MAX_THREADS);
+                return 1;
+            }
+            threads = (int)n;
+            arg += 2;
+        }
+        else if (strcmp(argv[arg], "-m") == 0 && arg + 1 < argc) {
+            char* end;
+            long n = strtol(argv[arg + 1], &end, 10);
+            if (*argv[arg + 1] == '\0' || *end != '\0' || n < 1 || n > LONG_MAX >> 20) {
+                fprintf(stderr, "Error: -m takes a memory budget in megabytes\n");
+                return 1;
+            }
+            budget = n << 20;
+            arg += 2;
+        }
+        else {
+            break;
+        }
+    }
+
+    // then exactly 2 arguments
+    if (argc - arg != 2) {
+        fprintf(stderr, "Usage: ./indexer [--incremental] [-j threads] [-m megabytes] "
+                        "pageDirectory indexFilename|segmentDirectory\n");
+        return 1;
+    }
+    if (budget > 0 && (incremental || threads > 1)) {
+        fprintf(stderr, "Error: -m cannot be used with --incremental or -j\n");
         return 1;
     }
     
     // pageDirectory checks
-    char* pageDirectory = argv[1];
+    char* pageDirectory = argv[argc - 2];
     if (!pagedir_validate(pageDirectory)) {
         fprintf(stderr, "Error: Invalid pageDirectory: %s\n", pageDirectory);
         return 2;
     }
 
-    // indexFilename checks
-    char* indexFilename = argv[2];
-    FILE* indexFile = fopen(indexFilename, "w");
-    if (indexFile == NULL) {
+    // the manifest, if the crawler wrote one, says which pages there are
+    pagedir_manifest_t* manifest = pagedir_manifestLoad(pageDirectory);
+    int status = indexDirectory(pageDirectory, manifest, argv[argc - 1],
+                                incremental, threads, budget);
+    pagedir_manifestDelete(manifest);
+    return status;
+}
+
+/************ indexDirectory ************/
+/* Index pageDirectory into indexFilename as the options say
+ *
+ * inputs:
+ *   pageDirectory - pointer to pageDirectory
+ *   manifest - its manifest, or NULL if it has none
+ *   indexFilename - the index file, or a directory of segments
+ *   incremental - true to add to the index already in indexFilename
+ *   threads - how many threads to index with
+ *   budget - bytes of memory the index may use, 0 for no limit
+ *
+ * return:
+ *   the exit status for main
+ */
+static int
+indexDirectory(char* pageDirectory, const pagedir_manifest_t* manifest,
+               char* indexFilename, const bool incremental,
+               const int threads, const long budget)
+{
+    // a directory of segments gets a new segment of the pages after
+    // those it already holds, --incremental or not
+    if (segments_last(indexFilename) >= 0) {
+        return indexSegment(pageDirectory, manifest, indexFilename, threads, budget);
+    }
+
+    // indexFilename checks; the file itself is left alone until the
+    // index is saved to a temporary file and renamed over it
+    if (!canWrite(indexFilename)) {
         fprintf(stderr, "Error: Could not open %s for writing\n", indexFilename);
         return 3;
     }
 
-    index_t* index = indexBuild(pageDirectory);
+    if (incremental) {
+        return indexIncremental(pageDirectory, manifest, indexFilename, threads);
+    }
+    if (budget > 0) {
+        return indexExternal(pageDirectory, manifest, indexFilename, budget);
+    }
+
+    index_t* index = index_new(indexSlots(manifest, 1, 1));
+    if (index == NULL) {
+        fprintf(stderr, "Error: Could not create index structure\n");
+        return 4;
+    }
+    if (indexBuild(index, pageDirectory, manifest, 1, threads, 0) < 0) {
+        index_delete(index);
+        return 4;
+    }
 
     // save index to indexFilename
-    if (!index_save(index, indexFile)) {
+    if (!index_saveFile(index, indexFilename, INDEX_TEXT)) {
         fprintf(stderr, "Error: Failed to save index to file\n");
         index_delete(index);
-        fclose(indexFile);
         return 4;
     }
 
     // cleanup
     index_delete(index);
-    fclose(indexFile);
 
     return 0;
 }
 
+/************ indexIncremental ************/
+/* Load the index in indexFilename, add the pages of pageDirectory
+ * after the last docID it holds, and save it back in the same format
+ *
+ * inputs:
+ *   pageDirectory - pointer to pageDirectory
+ *   manifest - its manifest, or NULL if it has none
+ *   indexFilename - the index to add to; a missing or empty file is
+ *                   an empty index, so the first run indexes everything
+ *   threads - how many threads to index with
+ *
+ * return:
+ *   the exit status for main
+ */
+static int
+indexIncremental(char* pageDirectory, const pagedir_manifest_t* manifest,
+                 char* indexFilename, const int threads)
+{
+    // a binary index is saved back as binary, anything else as text
+    index_t* mapped = index_map(indexFilename);
+    index_format_t format = (mapped != NULL) ? INDEX_BINARY : INDEX_TEXT;
+    index_delete(mapped);
+
+    index_t* index = index_new(500);
+    if (index == NULL) {
+        fprintf(stderr, "Error: Could not create index structure\n");
+        return 4;
+    }
+    FILE* fp = fopen(indexFilename, "r");
+    bool loaded = (fp != NULL) ? index_load(index, fp) : (errno == ENOENT);
+    if (fp != NULL) {
+        fclose(fp);
+    }
+    if (!loaded) {
+        fprintf(stderr, "Error: Could not load the index in %s\n", indexFilename);
+        index_delete(index);
+        return 5;
+    }
+
+    // the pages up to the last docID with a posting are already in it
+    int firstDocID = index_lastDocID(index) + 1;
+    int lastDocID = indexBuild(index, pageDirectory, manifest, firstDocID, threads, 0);
+    if (lastDocID < 0) {
+        index_delete(index);
+        return 4;
+    }
+    if (lastDocID < firstDocID) {
+        printf("No pages after docID %d in %s\n", firstDocID - 1, pageDirectory);
+        index_delete(index);
+        return 0;
+    }
+    if (!index_saveFile(index, indexFilename, format)) {
+        fprintf(stderr, "Error: Failed to save index to file\n");
+        index_delete(index);
+        return 4;
+    }
+    printf("Indexed docIDs %d-%d into %s\n", firstDocID, lastDocID, indexFilename);
+    index_delete(index);
+    return 0;
+}
+
+/************ indexSegment ************/
+/* Index the pages of pageDirectory after the last one the segments
+ * in segmentDirectory cover, and add them as one new segment, or
+ * one each time the index outgrows the memory budget
+ *
+ * inputs:
+ *   pageDirectory - pointer to pageDirectory
+ *   manifest - its manifest, or NULL if it has none
+ *   segmentDirectory - pointer to the directory of segments
+ *   threads - how many threads to index with
+ *   budget - bytes of memory the index may use, 0 for no limit
+ *
+ * return:
+ *   the exit status for main
+ */
+static int
+indexSegment(char* pageDirectory, const pagedir_manifest_t* manifest,
+             char* segmentDirectory, const int threads, const long budget)
+{
+    int firstDocID = segments_last(segmentDirectory) + 1;
+    for (bool first = true; ; first = false) {
+        // a presized hashtable would count against the budget
+        index_t* index = index_new((budget > 0) ? DEFAULT_SLOTS
+                                   : indexSlots(manifest, firstDocID, 1));
+        if (index == NULL) {
+            fprintf(stderr, "Error: Could not create index structure\n");
+            return 4;
+        }
+        int lastDocID = indexBuild(index, pageDirectory, manifest, firstDocID,
+                                   threads, budget);
+        if (lastDocID < 0) {
+            index_delete(index);
+            return 4;
+        }
+
+        // no new pages, no new segment
+        if (lastDocID < firstDocID) {
+            if (first) {
+                printf("No pages after docID %d in %s\n", firstDocID - 1, pageDirectory);
+            }
+            index_delete(index);
+            return 0;
+        }
+        if (!segments_add(segmentDirectory, index, firstDocID, lastDocID)) {
+            fprintf(stderr, "Error: Failed to add a segment to %s\n", segmentDirectory);
+            index_delete(index);
+            return 4;
+        }
+        printf("Indexed docIDs %d-%d into a new segment of %s\n",
+               firstDocID, lastDocID, segmentDirectory);
+        index_delete(index);
+        firstDocID = lastDocID + 1;
+    }
+}
+
+/************ indexExternal ************/
+/* Index pageDirectory in runs that each fit in the memory budget:
+ * build an index until it outgrows the budget, save it as a binary
+ * run next to indexFilename, and start again with the next page;
+ * then merge the runs into indexFilename, a word at a time
+ *
+ * inputs:
+ *   pageDirectory - pointer to pageDirectory
+ *   manifest - its manifest, or NULL if it has none
+ *   indexFilename - the text index to write
+ *   budget - bytes of memory the index may use
+ *
+ * return:
+ *   the exit status for main
+ */
+static int
+indexExternal(char* pageDirectory, const pagedir_manifest_t* manifest,
+              char* indexFilename, const long budget)
+{
+    int numRuns = 0;
+    int firstDocID = 1;
+    bool ok = true;
+    for (;;) {
+        index_t* index = index_new(DEFAULT_SLOTS);
+        if (index == NULL) {
+            ok = false;
+            break;
+        }
+        int lastDocID = indexBuild(index, pageDirectory, manifest, firstDocID, 1, budget);
+        if (lastDocID < 0) {
+            index_delete(index);
+            ok = false;
+            break;
+        }
+
+        // no pages at all is an empty index, as without -m
+        if (lastDocID < firstDocID && numRuns > 0) {
+            index_delete(index);
+            break;
+        }
+        char* run = runFilename(indexFilename, numRuns);
+        ok = (run != NULL) && index_saveFile(index, run, INDEX_BINARY);
+        free(run);
+        index_delete(index);
+        if (!ok) {
+            break;
+        }
+        numRuns++;
+        if (lastDocID < firstDocID) {
+            break;
+        }
+        firstDocID = lastDocID + 1;
+    }
+
+    // merge the runs, which map without loading, then remove them
+    index_t** runs = calloc(numRuns + 1, sizeof(index_t*));
+    ok = ok && runs != NULL;
+    for (int i = 0; i < numRuns && ok; i++) {
+        char* run = runFilename(indexFilename, i);
+        ok = (run != NULL) && (runs[i] = index_map(run)) != NULL;
+        free(run);
+    }
+    ok = ok && index_mergeFormat(runs, numRuns, indexFilename, INDEX_TEXT);
+    for (int i = 0; i < numRuns; i++) {
+        char* run = runFilename(indexFilename, i);
+        if (run != NULL) {
+            unlink(run);
+        }
+        free(run);
+        if (runs != NULL) {
+            index_delete(runs[i]);
+        }
+    }
+    free(runs);
+    if (!ok) {
+        fprintf(stderr, "Error: Failed to save index to file\n");
+        return 4;
+    }
+    return 0;
+}
+
+/************ runFilename ************/
+/* Return the name of a run of indexExternal, indexFilename.runN,
+ * in a new string the caller frees; NULL if out of memory */
+static char*
+runFilename(char* indexFilename, const int run)
+{
+    size_t len = strlen(indexFilename) + 16;
+    char* filename = malloc(len);
+    if (filename != NULL) {
+        snprintf(filename, len, "%s.run%d", indexFilename, run);
+    }
+    return filename;
+}
+
+/************ canWrite ************/
+/* Return true if filename can be written as the index is saved: to a
+ * temporary file in its directory, renamed over it.  So the directory
+ * must be writable, and the file, if it exists, not a directory and
+ * writable itself, as it had to be when it was opened in place. */
+static bool
+canWrite(const char* filename)
+{
+    struct stat st;
+    if (stat(filename, &st) == 0
+        && (S_ISDIR(st.st_mode) || access(filename, W_OK) != 0)) {
+        return false;
+    }
+
+    // the directory part of filename, "." if it has none
+    const char* slash = strrchr(filename, '/');
+    if (slash == NULL) {
+        return access(".", W_OK | X_OK) == 0;
+    }
+    size_t len = (slash == filename) ? 1 : (size_t)(slash - filename);
+    char* dirname = malloc(len + 1);
+    if (dirname == NULL) {
+        return false;
+    }
+    memcpy(dirname, filename, len);
+    dirname[len] = '\0';
+    bool ok = access(dirname, W_OK | X_OK) == 0;
+    free(dirname);
+    return ok;
+}
+
+/************ indexMemory ************/
+/* Return the bytes held now by indexes' words, postings, hashtables,
+ * and the rest of them (index_t, per-document arrays, scratch) */
+static long
+indexMemory(void)
+{
+    return mem_bytes(MEM_INDEXKEYS, NULL) + mem_bytes(MEM_POSTINGS, NULL)
+           + mem_bytes(MEM_INDEX, NULL) + mem_bytes(MEM_HASHTABLE, NULL);
+}
+
+/************ indexSlots ************/
+/* Return how many hashtable slots to start an index with, for one of
+ * ways equal shares of the pages from firstDocID on: going by the
+ * manifest, about one per BYTES_PER_WORD of their html, which saves
+ * growing the hashtable again and again on a big crawl; the hashtable
+ * still grows if that is too few.  DEFAULT_SLOTS without a manifest.
+ */
+static int
+indexSlots(const pagedir_manifest_t* manifest, const int firstDocID, const int ways)
+{
+    if (manifest == NULL) {
+        return DEFAULT_SLOTS;
+    }
+    long bytes = 0;
+    pagedir_entry_t entry;
+    for (int i = pagedir_manifestSeek(manifest, firstDocID);
+         pagedir_manifestEntry(manifest, i, &entry); i++) {
+        bytes += entry.size;
+    }
+    long slots = bytes / BYTES_PER_WORD / ways;
+    return (slots < DEFAULT_SLOTS) ? DEFAULT_SLOTS
+           : (slots > MAX_SLOTS) ? MAX_SLOTS : (int)slots;
+}
+
 /************ indexBuild ************/
 /* Build the index by reading each page
- * in the pageDirectory
+ * in the pageDirectory, from firstDocID on: each page in the
+ * manifest, or without one, each docID until one has no page
  *
  * inputs:
+ *   index - the index to add the pages to
  *   pageDirectory - pointer to pageDirectory
+ *   manifest - its manifest, or NULL if it has none
+ *   firstDocID - the first page to read
+ *   threads - how many threads to index with
+ *   budget - stop after the page that takes the index past this
+ *            many bytes (see indexMemory); 0 for no limit, and
+ *            ignored with more than one thread
  * 
  * return:
- *   index object
+ *   the last docID read, firstDocID - 1 if there were none; -1 if
+ *   the pages could not all be put in the index (the partial indexes
+ *   of several threads could not be merged), which is reported
  */
-static index_t*
-indexBuild(char* pageDirectory)
+static int
+indexBuild(index_t* index, char* pageDirectory, const pagedir_manifest_t* manifest,
+           const int firstDocID, const int threads, const long budget)
 {
-    int docID = 1;
-    index_t* index = index_new(500);
+    if (threads > 1) {
+        return indexParallel(index, pageDirectory, manifest, firstDocID, threads);
+    }
+    if (manifest != NULL) {
+        int lastDocID = firstDocID - 1;
+        pagedir_entry_t entry;
+        for (int i = pagedir_manifestSeek(manifest, firstDocID);
+             pagedir_manifestEntry(manifest, i, &entry); i++) {
+            indexEntry(index, pageDirectory, &entry);
+            lastDocID = entry.docID;
+            if (budget > 0 && indexMemory() >= budget) {
+                break;
+            }
+        }
+        return lastDocID;
+    }
+    int docID = firstDocID;
 
     webpage_t* page;
     while ((page = pagedir_load(pageDirectory, docID)) != NULL) {
@@ -85,8 +547,202 @@ indexBuild(char* pageDirectory)
         indexPage(index, page, docID);
         docID++;
         webpage_delete(page);
+        if (budget > 0 && indexMemory() >= budget) {
+            break;
+        }
+    }
+    return docID - 1;
+}
+
+/************ indexParallel ************/
+/* Build the index with several threads: each takes the next docID
+ * from a shared queue and indexes the page into a partial index of
+ * its own, until one finds a docID with no page.  With a manifest,
+ * each thread instead indexes its own run of pages, the runs split
+ * so they have about the same bytes of html.  The partial indexes
+ * are then merged, a slice of the words per thread.
+ *
+ * inputs:
+ *   as for indexBuild
+ *
+ * return:
+ *   as for indexBuild
+ */
+static int
+indexParallel(index_t* index, char* pageDirectory, const pagedir_manifest_t* manifest,
+              const int firstDocID, const int threads)
+{
+    pagequeue_t queue = { pageDirectory, manifest, firstDocID, INT_MAX,
+                          PTHREAD_MUTEX_INITIALIZER };
+    worker_t workers[MAX_THREADS];
+    pthread_t tids[MAX_THREADS];
+    index_t* parts[MAX_THREADS];
+    int slots = indexSlots(manifest, firstDocID, threads);
+    int n = 0;
+    for (int i = 0; i < threads; i++) {
+        parts[n] = index_new(slots);
+        if (parts[n] != NULL) {
+            workers[n].queue = &queue;
+            workers[n].part = parts[n];
+            n++;
+        }
+    }
+    if (n == 0) {
+        return indexBuild(index, pageDirectory, manifest, firstDocID, 1, 0);
+    }
+    if (manifest != NULL) {
+        splitBytes(manifest, firstDocID, workers, n);
+    }
+
+    // worker 0 runs on this thread, and so do any whose threads cannot
+    // be started: with a manifest they have runs of pages of their own,
+    // and from the queue they find it empty, the others having taken
+    // their share
+    int started = 0;
+    for (int i = 1; i < n; i++) {
+        if (pthread_create(&tids[i], NULL, indexWorker, &workers[i]) != 0) {
+            break;
+        }
+        started = i;
+    }
+    indexWorker(&workers[0]);
+    for (int i = started + 1; i < n; i++) {
+        indexWorker(&workers[i]);
+    }
+    for (int i = 1; i <= started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+
+    // without a manifest, a page past the first missing one may have
+    // been indexed before that one was found missing; the serial build
+    // never reads it
+    for (int i = 0; i < n && manifest == NULL; i++) {
+        for (int docID = queue.stop; docID <= index_lastDocID(parts[i]); docID++) {
+            index_deleteDoc(parts[i], docID);
+        }
+    }
+    bool merged = index_mergeParts(index, parts, n, threads);
+    for (int i = 0; i < n; i++) {
+        index_delete(parts[i]);
+    }
+    pthread_mutex_destroy(&queue.lock);
+    if (!merged) {
+        fprintf(stderr, "Error: Failed to merge the partial indexes\n");
+        return -1;
+    }
+    if (manifest != NULL) {
+        // the last page of the manifest, if it was one of these
+        pagedir_entry_t entry;
+        int last = pagedir_manifestCount(manifest) - 1;
+        if (pagedir_manifestEntry(manifest, last, &entry) && entry.docID >= firstDocID) {
+            return entry.docID;
+        }
+        return firstDocID - 1;
+    }
+    return queue.stop - 1;
+}
+
+/************ splitBytes ************/
+/* Give each of n workers a run of the manifest's pages from
+ * firstDocID on, in order, so each run has about 1/n of their html
+ *
+ * inputs:
+ *   manifest - the manifest of pageDirectory
+ *   firstDocID - the first page to index
+ *   workers - the workers, whose first and stop this sets
+ *   n - how many workers
+ */
+static void
+splitBytes(const pagedir_manifest_t* manifest, const int firstDocID,
+           worker_t* workers, const int n)
+{
+    int first = pagedir_manifestSeek(manifest, firstDocID);
+    int count = pagedir_manifestCount(manifest);
+    pagedir_entry_t entry;
+    long total = 0;
+    for (int i = first; pagedir_manifestEntry(manifest, i, &entry); i++) {
+        total += entry.size;
+    }
+
+    // worker k takes the pages whose middle byte falls in the k-th
+    // n-th of the total; the last takes whatever is left
+    long bytes = 0;
+    int i = first;
+    for (int k = 0; k < n; k++) {
+        workers[k].first = i;
+        long target = total / n * (k + 1);
+        while (i < count && pagedir_manifestEntry(manifest, i, &entry)
+               && (k == n - 1 || bytes + entry.size / 2 < target)) {
+            bytes += entry.size;
+            i++;
+        }
+        workers[k].stop = i;
+    }
+}
+
+/************ indexWorker ************/
+/* One indexing thread: index pages from the queue into the worker's
+ * partial index until the queue runs out, or with a manifest, the
+ * worker's own run of its pages
+ *
+ * inputs:
+ *   arg - the worker_t
+ */
+static void*
+indexWorker(void* arg)
+{
+    worker_t* worker = arg;
+    pagequeue_t* queue = worker->queue;
+    if (queue->manifest != NULL) {
+        pagedir_entry_t entry;
+        for (int i = worker->first; i < worker->stop; i++) {
+            if (pagedir_manifestEntry(queue->manifest, i, &entry)) {
+                indexEntry(worker->part, queue->pageDirectory, &entry);
+            }
+        }
+        return NULL;
+    }
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        int docID = (queue->next < queue->stop) ? queue->next++ : 0;
+        pthread_mutex_unlock(&queue->lock);
+        if (docID == 0) {
+            return NULL;
+        }
+        webpage_t* page = pagedir_load(queue->pageDirectory, docID);
+        if (page == NULL) {
+            pthread_mutex_lock(&queue->lock);
+            if (docID < queue->stop) {
+                queue->stop = docID;
+            }
+            pthread_mutex_unlock(&queue->lock);
+            return NULL;
+        }
+        indexPage(worker->part, page, docID);
+        webpage_delete(page);
+    }
+}
+
+/************ indexEntry ************/
+/* Load the page a manifest entry describes and index it; a page
+ * listed but missing or changed is reported and skipped
+ *
+ * inputs:
+ *   index - pointer to the index
+ *   pageDirectory - pointer to pageDirectory
+ *   entry - the page's manifest entry
+ */
+static void
+indexEntry(index_t* index, char* pageDirectory, const pagedir_entry_t* entry)
+{
+    webpage_t* page = pagedir_loadEntry(pageDirectory, entry);
+    if (page == NULL) {
+        fprintf(stderr, "Error: Could not load page %d of %s; skipping it\n",
+                entry->docID, pageDirectory);
+        return;
     }
-    return index;
+    indexPage(index, page, entry->docID);
+    webpage_delete(page);
 }
 
 /************ indexPage ************/
@@ -101,17 +757,22 @@ indexBuild(char* pageDirectory)
 static void
 indexPage(index_t* index, webpage_t* page, const int docID)
 {
-    int pos = 0;
-    char* word;
+    // words of 3 letters or more, lowercased, without copying each one
+    pagewords_t words = { index, docID };
+    scanWords(page, 3, &words, indexWord);
+}
 
-    // extract word from webpage
-    while ((word = webpage_getNextWord(page, &pos)) != NULL) {
-        // ignore words with fewer than 3 characters
-        if (strlen(word) >= 3) {
-            normalizeWord(word);
-            // add or increment word count in index
-            index_insert(index, word, docID);
-        }
-        free(word);
-    }
-}
\ No newline at end of file
+/************ indexWord ************/
+/* scanWords helper: add or increment a word's count in the index
+ *
+ * inputs:
+ *   arg - the pagewords_t with the index and docID
+ *   word - the normalized word
+ *   len - its length
+ */
+static void
+indexWord(void* arg, const char* word, const int len)
+{
+    pagewords_t* words = arg;
+    index_insert(words->index, word, words->docID);
+}
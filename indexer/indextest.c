@@ -2,7 +2,10 @@
  * indextest.c - Test program for the Tiny Search Engine indexer
  * 
  * Loads an index from an existing file and saves it to a new file,
- * allowing verification that loading and saving preserve data integrity
+ * allowing verification that loading and saving preserve data integrity.
+ * The old file may be in either index format; the new one is written
+ * as text unless -b asks for binary, so indextest also converts
+ * between the two.
  * 
  * Jake Fleming - 10/28/24
  */
@@ -10,6 +13,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include "../common/index.h"
 
 /************ main *************/
@@ -18,20 +22,32 @@
  * into a new one
  * 
  * Usage:
- *   ./indextest oldIndexFile newIndexFile
+ *   ./indextest [-b|-t] oldIndexFile newIndexFile
+ *   -b writes the new file in binary, -t (the default) in text
  */
 int 
 main(int argc, char* argv[])
 {
+    // an optional first argument picks the output format
+    index_format_t format = INDEX_TEXT;
+    int arg = 1;
+    if (argc == 4 && strcmp(argv[1], "-b") == 0) {
+        format = INDEX_BINARY;
+        arg++;
+    }
+    else if (argc == 4 && strcmp(argv[1], "-t") == 0) {
+        arg++;
+    }
+
     // ensure correct number of arguments
-    if (argc != 3) {
-        fprintf(stderr, "Usage: ./indextest oldIndexFilename newIndexFilename\n");
+    if (argc - arg != 2) {
+        fprintf(stderr, "Usage: ./indextest [-b|-t] oldIndexFilename newIndexFilename\n");
         return 1;
     }
 
     // open the old index file for reading
-    char* oldIndexFilename = argv[1];
-    FILE* oldFile = fopen(oldIndexFilename, "r");
+    char* oldIndexFilename = argv[arg];
+    FILE* oldFile = fopen(oldIndexFilename, "rb");
     if (oldFile == NULL) {
         fprintf(stderr, "Error: Could not open %s for reading\n", oldIndexFilename);
         return 2;
@@ -55,26 +71,16 @@ main(int argc, char* argv[])
 
     fclose(oldFile);
 
-    // open the new index file for writing
-    char* newIndexFilename = argv[2];
-    FILE* newFile = fopen(newIndexFilename, "w");
-    if (newFile == NULL) {
-        fprintf(stderr, "Error: Could not open %s for writing\n", newIndexFilename);
-        index_delete(index);
-        return 5;
-    }
-
     // save the index structure to the new file
-    if (!index_save(index, newFile)) {
+    char* newIndexFilename = argv[arg + 1];
+    if (!index_saveFile(index, newIndexFilename, format)) {
         fprintf(stderr, "Error: Failed to save index to file %s\n", newIndexFilename);
         index_delete(index);
-        fclose(newFile);
         return 6;
     }
 
     // cleanup
     index_delete(index);
-    fclose(newFile);
 
     printf("Index successfully loaded from %s and saved to %s\n", oldIndexFilename, newIndexFilename);
     return 0;
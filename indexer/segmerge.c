@@ -0,0 +1,63 @@
+/*
+ * segmerge.c - merge the segments of a segmented index
+ *
+ * Runs the tiered merge policy of the segments module over a
+ * directory of segments, so that the indexer can keep adding small
+ * segments while the number of segments a query visits stays
+ * logarithmic.  It is safe to run while queriers are reading the
+ * directory, e.g. from cron after each indexer run.
+ * 
+ * Jake Fleming - 11/28/24
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../common/segments.h"
+
+/************ main *************/
+/* merge segments until the policy is satisfied
+ * 
+ * Usage:
+ *   ./segmerge [-a | -f fanout] segmentDirectory
+ *   -a merges all segments into one; -f sets how many segments
+ *   of one size are merged at a time (default SEGMENTS_FANOUT)
+ */
+int
+main(int argc, char* argv[])
+{
+    int fanout = SEGMENTS_FANOUT;
+    int arg = 1;
+    if (argc == 3 && strcmp(argv[1], "-a") == 0) {
+        fanout = 0;
+        arg++;
+    }
+    else if (argc == 4 && strcmp(argv[1], "-f") == 0) {
+        fanout = atoi(argv[2]);
+        arg += 2;
+        if (fanout < 2) {
+            fprintf(stderr, "Error: fanout must be at least 2\n");
+            return 1;
+        }
+    }
+    if (argc - arg != 1) {
+        fprintf(stderr, "Usage: ./segmerge [-a | -f fanout] segmentDirectory\n");
+        return 1;
+    }
+
+    char* segmentDirectory = argv[arg];
+    if (segments_last(segmentDirectory) < 0) {
+        fprintf(stderr, "Error: %s is not a directory\n", segmentDirectory);
+        return 2;
+    }
+    int merges = segments_merge(segmentDirectory, fanout, stdout);
+    if (merges < 0) {
+        fprintf(stderr, "Error: Failed to merge the segments of %s\n", segmentDirectory);
+        return 3;
+    }
+    printf("%d merges; %s is left with ", merges, segmentDirectory);
+    segments_t* segs = segments_open(segmentDirectory);
+    printf("%d segments\n", segments_count(segs));
+    segments_close(segs);
+    return 0;
+}
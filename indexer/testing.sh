@@ -5,11 +5,17 @@
 # define paths for executables and directories
 INDEXER="./indexer"
 INDEXTEST="./indextest"
+SEGMERGE="./segmerge"
+DOCDELETE="./docdelete"
+PAGEDIRTEST="../crawler/pagedirtest"
+HTMLTEST="../libcs50/htmltest"
 INDEXCMP="$HOME/cs50-dev/shared/tse/indexcmp"
 PAGE_DIR_1="$HOME/cs50-dev/shared/tse/output/letters-3"
 PAGE_DIR_2="$HOME/cs50-dev/shared/tse/output/toscrape-2"     
 PAGE_DIR_3="$HOME/cs50-dev/shared/tse/output/wikipedia-1"    
 
+PAGE_DIR_LOCAL="test-pages"   # written by make_pages below
+
 INDEX_FILE_1="letters.index"
 INDEX_FILE_2="toscrape.index"
 INDEX_FILE_3="wikipedia.index"
@@ -25,8 +31,49 @@ function test_command() {
     fi
 }
 
+# utility function for checking that two files are byte-for-byte the same
+function test_same() {
+    if cmp -s "$2" "$3"; then
+        echo "PASS: $1"
+    else
+        echo "FAIL: $1"
+    fi
+}
+
+# write a pageDirectory of $2 pages of made-up words, the same every time,
+# so these tests need no network and no shared crawl output
+function make_pages() {
+    local dir=$1 n=$2
+    local syllables=(ka lo mi ne ru ta shi bo ve qu ax ye zo pi dra nth)
+    local common=(the and for home page search engine tiny)
+    local seed=2024 doc i r words html w
+    mkdir -p $dir
+    touch $dir/.crawler
+    for ((doc = 1; doc <= n; doc++)); do
+        seed=$(( (seed * 1103515245 + 12345) % 2147483648 ))
+        words=$(( 20 + (seed >> 8) % 600 ))
+        html="<html><head><title>page $doc</title></head><body>"
+        for ((i = 0; i < words; i++)); do
+            seed=$(( (seed * 1103515245 + 12345) % 2147483648 ))
+            r=$(( seed >> 8 ))
+            if (( r % 4 == 0 )); then
+                w=${common[r / 4 % 8]}
+            else
+                w=${syllables[r / 16 % 16]}${syllables[r / 256 % 16]}
+                (( r % 3 == 0 )) && w+=${syllables[r / 4096 % 16]}
+            fi
+            (( r % 10 == 1 )) && html+="<a href=\"$((r % 99)).html\">"
+            (( r % 13 == 2 )) && w=${w^^}
+            html+=" $w"
+        done
+        printf "http://cs50tse.cs.dartmouth.edu/tse/test/%d.html\n%d\n%s</body></html>\n" \
+               $doc $((doc % 3)) "$html" > $dir/$doc
+    done
+}
+
 # cleanup old index files to restart tests
 rm -f $INDEX_FILE_1 $INDEX_FILE_2 $INDEX_FILE_3 $TEST_INDEX_FILE
+rm -rf $PAGE_DIR_LOCAL local-pages local-segments local*.index
 
 echo "Running invalid argument tests 1-6..."
 test_command $INDEXER           # no arguments
@@ -37,68 +84,161 @@ test_command $INDEXER . $INDEX_FILE_1 # not a crawler directory
 test_command $INDEXER $PAGE_DIR_1 "invalid_dir/index" # non-existent index path
 echo
 
-echo "Running valid integration tests 7-9..."
-echo
+# tests 7-15 need the crawls and indexcmp shared with the class
+if [ ! -d "$PAGE_DIR_1" ]; then
+    echo "Skipping tests 7-15: no shared crawl output in $(dirname $PAGE_DIR_1)"
+    echo
+else
+    echo "Running valid integration tests 7-9..."
+    echo
 
-# run indexer on various page directories and validate with indextest
-$INDEXER $PAGE_DIR_1 $INDEX_FILE_1
-$INDEXER $PAGE_DIR_2 $INDEX_FILE_2
-$INDEXER $PAGE_DIR_3 $INDEX_FILE_3
+    # run indexer on various page directories and validate with indextest
+    $INDEXER $PAGE_DIR_1 $INDEX_FILE_1
+    $INDEXER $PAGE_DIR_2 $INDEX_FILE_2
+    $INDEXER $PAGE_DIR_3 $INDEX_FILE_3
 
-# display a sample of the indexer output for letters.index
-echo "Sample output from letters.index (first 10 lines):"
-head -n 10 $INDEX_FILE_1
-echo
+    # display a sample of the indexer output for letters.index
+    echo "Sample output from letters.index (first 10 lines):"
+    head -n 10 $INDEX_FILE_1
+    echo
 
-# test if indextest can read and rewrite index files correctly
-echo "Test 10-12 indextest re-writing of index files..."
+    # test if indextest can read and rewrite index files correctly
+    echo "Test 10-12 indextest re-writing of index files..."
 
-$INDEXTEST $INDEX_FILE_1 $TEST_INDEX_FILE
-$INDEXCMP $INDEX_FILE_1 $TEST_INDEX_FILE
-echo "Comparison complete for letters index"
-echo
+    $INDEXTEST $INDEX_FILE_1 $TEST_INDEX_FILE
+    $INDEXCMP $INDEX_FILE_1 $TEST_INDEX_FILE
+    echo "Comparison complete for letters index"
+    echo
 
-$INDEXTEST $INDEX_FILE_2 $TEST_INDEX_FILE
-$INDEXCMP $INDEX_FILE_2 $TEST_INDEX_FILE
-echo "Comparison complete for toscrape index"
-echo
+    $INDEXTEST $INDEX_FILE_2 $TEST_INDEX_FILE
+    $INDEXCMP $INDEX_FILE_2 $TEST_INDEX_FILE
+    echo "Comparison complete for toscrape index"
+    echo
 
-$INDEXTEST $INDEX_FILE_3 $TEST_INDEX_FILE
-$INDEXCMP $INDEX_FILE_3 $TEST_INDEX_FILE
-echo "Comparison complete for wikipedia index"
-echo
+    $INDEXTEST $INDEX_FILE_3 $TEST_INDEX_FILE
+    $INDEXCMP $INDEX_FILE_3 $TEST_INDEX_FILE
+    echo "Comparison complete for wikipedia index"
+    echo
 
-echo "Test 13: Compare wikipedia-1 with provided output"
-$INDEXCMP $INDEX_FILE_3 "$HOME/cs50-dev/shared/tse/output/wikipedia-1.index"
-echo
+    echo "Test 13: Compare wikipedia-1 with provided output"
+    $INDEXCMP $INDEX_FILE_3 "$HOME/cs50-dev/shared/tse/output/wikipedia-1.index"
+    echo
 
-echo "Nothing printed by indexcmp implies files were all the same"
-echo
+    echo "Nothing printed by indexcmp implies files were all the same"
+    echo
 
 
 
-# clean up the temporary test index file
-rm -f $TEST_INDEX_FILE
+    # clean up the temporary test index file
+    rm -f $TEST_INDEX_FILE
 
-echo "Running valgrind tests 14-15..."
+    echo "Running valgrind tests 14-15..."
 
-valgrind --leak-check=full --show-leak-kinds=all $INDEXER $PAGE_DIR_1 $INDEX_FILE_1 &> valgrind_indexer.out
-if grep -q "no leaks are possible" valgrind_indexer.out; then
-    echo "PASS: No memory leaks in indexer"
-else
-    echo "FAIL: Memory leaks found in indexer"
+    valgrind --leak-check=full --show-leak-kinds=all $INDEXER $PAGE_DIR_1 $INDEX_FILE_1 &> valgrind_indexer.out
+    if grep -q "no leaks are possible" valgrind_indexer.out; then
+        echo "PASS: No memory leaks in indexer"
+    else
+        echo "FAIL: Memory leaks found in indexer"
+    fi
+    echo
+
+    valgrind --leak-check=full --show-leak-kinds=all $INDEXTEST $INDEX_FILE_1 $TEST_INDEX_FILE &> valgrind_indextest.out
+    if grep -q "no leaks are possible" valgrind_indextest.out; then
+        echo "PASS: No memory leaks in indextest"
+    else
+        echo "FAIL: Memory leaks found in indextest"
+    fi
+    echo
+
+    # clean up final test files
+    rm -f $INDEX_FILE_1 $INDEX_FILE_2 $INDEX_FILE_3 $TEST_INDEX_FILE valgrind_indexer.out valgrind_indextest.out
 fi
+
+echo "Building a local pageDirectory for tests 16-23..."
+make_pages $PAGE_DIR_LOCAL 300
+$INDEXER $PAGE_DIR_LOCAL local.index
+echo "Sample output from local.index (first 5 lines, then the last, cut at 60 characters):"
+head -n 5 local.index | cut -c 1-60
+tail -n 1 local.index
 echo
 
-valgrind --leak-check=full --show-leak-kinds=all $INDEXTEST $INDEX_FILE_1 $TEST_INDEX_FILE &> valgrind_indextest.out
-if grep -q "no leaks are possible" valgrind_indextest.out; then
-    echo "PASS: No memory leaks in indextest"
+echo "Test 16: the same index saves to the same bytes, every time"
+$INDEXER $PAGE_DIR_LOCAL local-again.index
+test_same "indexer writes the same bytes twice" local.index local-again.index
+$INDEXTEST local.index local-saved.index
+test_same "indextest saves a loaded index to the same bytes" local.index local-saved.index
+echo
+
+echo "Test 17: a text index with one byte changed is rejected"
+cp local.index local-corrupt.index
+byte=$(dd if=local-corrupt.index bs=1 skip=5000 count=1 2>/dev/null)
+if [ "$byte" = "1" ]; then byte=2; else byte=1; fi
+printf "$byte" | dd of=local-corrupt.index bs=1 seek=5000 conv=notrunc 2>/dev/null
+if $INDEXTEST local-corrupt.index local-saved.index; then
+    echo "FAIL: indextest loaded a corrupted index"
 else
-    echo "FAIL: Memory leaks found in indextest"
+    echo "PASS: indextest rejected the corrupted index"
 fi
 echo
 
-# clean up final test files
-rm -f $INDEX_FILE_1 $INDEX_FILE_2 $INDEX_FILE_3 $TEST_INDEX_FILE valgrind_indexer.out valgrind_indextest.out
+echo "Test 18: text to binary to text gives back the same bytes"
+$INDEXTEST -b local.index local-binary.index
+$INDEXTEST local-binary.index local-text.index
+test_same "text -> binary -> text round trip" local.index local-text.index
+echo
+
+echo "Test 19: threads and a memory budget do not change a byte of the index"
+for options in "-j 2" "-j 7" "-m 1"; do
+    $INDEXER $options $PAGE_DIR_LOCAL local-options.index
+    test_same "indexer $options matches the serial index" local.index local-options.index
+done
+echo
+
+echo "Test 20: indexing in two --incremental runs gives the same index"
+mkdir -p local-pages
+touch local-pages/.crawler
+cp $PAGE_DIR_LOCAL/{1..150} local-pages
+$INDEXER --incremental local-pages local-incremental.index
+cp $PAGE_DIR_LOCAL/{151..300} local-pages
+$INDEXER --incremental -j 3 local-pages local-incremental.index
+test_same "two --incremental runs match the serial index" local.index local-incremental.index
+echo
+
+echo "Test 21: segments with deleted documents merge to the index without them"
+rm -rf local-pages
+mkdir -p local-pages local-segments
+touch local-pages/.crawler
+cp $PAGE_DIR_LOCAL/{1..150} local-pages
+$INDEXER --incremental local-pages local-segments
+cp $PAGE_DIR_LOCAL/{151..300} local-pages
+$INDEXER --incremental local-pages local-segments
+$DOCDELETE local-segments 40 200
+$SEGMERGE -a local-segments
+$INDEXTEST local-segments/*.seg local-merged.index
+cp local.index local-deleted.index
+$DOCDELETE local-deleted.index 40 200
+test_same "merged segments match the text index less the same docIDs" \
+          local-deleted.index local-merged.index
+echo
+
+echo "Test 22: a manifest changes nothing, and a page missing from it is skipped"
+rm -rf local-pages
+cp -r $PAGE_DIR_LOCAL local-pages
+$PAGEDIRTEST local-pages
+$INDEXER local-pages local-manifest.index
+test_same "the index with a manifest matches the one without" local.index local-manifest.index
+rm local-pages/150
+$INDEXER -j 4 local-pages local-missing.index
+cp local.index local-deleted.index
+$DOCDELETE local-deleted.index 150 > /dev/null
+test_same "page 150 missing leaves out only page 150" local-deleted.index local-missing.index
+echo
+
+echo "Test 23: every html scanner finds the same words, at the same places"
+$HTMLTEST $PAGE_DIR_LOCAL/*
+echo
+
+# clean up the local tests
+rm -rf $PAGE_DIR_LOCAL local-pages local-segments local*.index
 
 echo "All tests completed."
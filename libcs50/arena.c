@@ -0,0 +1,205 @@
+/*
+ * arena.c - CS50 'arena' module
+ *
+ * see arena.h for more information
+ *
+ * Jake Fleming, 11/12/24
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include "arena.h"
+#include "mem.h"
+
+/**************** local types ****************/
+typedef struct arenablock {
+    struct arenablock* next;    // next (older) block
+    size_t size;                // usable bytes in data
+    size_t used;                // bytes handed out so far
+    max_align_t data[];         // the memory itself, maximally aligned
+} arenablock_t;
+
+/**************** global types ****************/
+typedef struct arena {
+    arenablock_t* head;         // block we are carving from; list of all
+    size_t blocksize;           // usable bytes in a regular block
+    char* last;                 // most recent allocation from head, or NULL
+    mem_tag_t tag;              // what the blocks are charged to
+} arena_t;
+
+/**************** local constants ****************/
+static const size_t DEFAULT_BLOCKSIZE = 64 * 1024;
+static const size_t ALIGNMENT = _Alignof(max_align_t);
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static arenablock_t* block_new(const size_t size, const mem_tag_t tag);
+static void* carve(arena_t* arena, const size_t size, const size_t align);
+
+/**************** global functions ****************/
+/* that is, visible outside this file */
+/* see arena.h for comments about exported functions */
+
+/**************** arena_new ****************/
+/* see arena.h for description */
+arena_t*
+arena_new(const size_t blocksize)
+{
+    return arena_newTagged(blocksize, MEM_UNTAGGED);
+}
+
+/**************** arena_newTagged ****************/
+/* see arena.h for description */
+arena_t*
+arena_newTagged(const size_t blocksize, const mem_tag_t tag)
+{
+    arena_t* arena = mem_malloc_tagged(sizeof(arena_t), tag);
+
+    if (arena == NULL) {
+        return NULL;    // error allocating arena
+    }
+    // initialize contents of arena structure; blocks come on demand
+    arena->head = NULL;
+    arena->blocksize = (blocksize > 0) ? blocksize : DEFAULT_BLOCKSIZE;
+    arena->last = NULL;
+    arena->tag = tag;
+    return arena;
+}
+
+/**************** arena_alloc ****************/
+/* see arena.h for description */
+void*
+arena_alloc(arena_t* arena, const size_t size)
+{
+    if (arena == NULL || size == 0) {
+        return NULL;
+    }
+    return carve(arena, size, ALIGNMENT);
+}
+
+/**************** arena_realloc ****************/
+/* see arena.h for description */
+void*
+arena_realloc(arena_t* arena, void* ptr,
+              const size_t oldsize, const size_t newsize)
+{
+    if (arena == NULL || newsize == 0) {
+        return NULL;
+    }
+    if (ptr == NULL) {
+        return arena_alloc(arena, newsize);
+    }
+
+    // the most recent allocation can often just extend into the block
+    arenablock_t* head = arena->head;
+    if (ptr == arena->last) {
+        size_t start = (char*)ptr - (char*)head->data;
+        if (start + newsize <= head->size) {
+            head->used = start + newsize;
+            return ptr;
+        }
+    }
+
+    // otherwise move it, abandoning the old space
+    void* moved = arena_alloc(arena, newsize);
+    if (moved == NULL) {
+        return NULL;
+    }
+    memcpy(moved, ptr, (oldsize < newsize) ? oldsize : newsize);
+    return moved;
+}
+
+/**************** arena_strdup ****************/
+/* see arena.h for description */
+char*
+arena_strdup(arena_t* arena, const char* str)
+{
+    if (arena == NULL || str == NULL) {
+        return NULL;
+    }
+    size_t len = strlen(str) + 1;
+    char* copy = carve(arena, len, 1);
+    if (copy != NULL) {
+        memcpy(copy, str, len);
+    }
+    return copy;
+}
+
+/**************** arena_delete ****************/
+/* see arena.h for description */
+void
+arena_delete(arena_t* arena)
+{
+    if (arena != NULL) {
+        for (arenablock_t* block = arena->head; block != NULL;) {
+            arenablock_t* next = block->next;   // remember what comes next
+            mem_free(block);                    // free the block
+            block = next;                       // and move on to next
+        }
+        mem_free(arena);
+    }
+}
+
+/**************** block_new ****************/
+/* Allocate a block with size usable bytes */
+static arenablock_t*
+block_new(const size_t size, const mem_tag_t tag)
+{
+    arenablock_t* block = mem_malloc_tagged(sizeof(arenablock_t) + size, tag);
+
+    // handle error allocating
+    if (block == NULL) {
+        return NULL;
+    }
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+/**************** carve ****************/
+/* Take size bytes, aligned to align, from the current block,
+ * starting a new block if it does not have room.
+ */
+static void*
+carve(arena_t* arena, const size_t size, const size_t align)
+{
+    // large requests get a block of their own, placed behind head
+    // so that the space left in head is not wasted
+    if (size > arena->blocksize / 4) {
+        arenablock_t* block = block_new(size, arena->tag);
+        if (block == NULL) {
+            return NULL;
+        }
+        if (arena->head == NULL) {
+            arena->head = block;
+        }
+        else {
+            block->next = arena->head->next;
+            arena->head->next = block;
+        }
+        block->used = size;
+        return block->data;
+    }
+
+    arenablock_t* head = arena->head;
+    size_t start = 0;
+    if (head != NULL) {
+        start = (head->used + align - 1) & ~(align - 1);
+    }
+    if (head == NULL || start + size > head->size) {
+        // start a fresh block in front of the list
+        arenablock_t* block = block_new(arena->blocksize, arena->tag);
+        if (block == NULL) {
+            return NULL;
+        }
+        block->next = head;
+        arena->head = head = block;
+        start = 0;
+    }
+    head->used = start + size;
+    arena->last = (char*)head->data + start;
+    return arena->last;
+}
@@ -0,0 +1,99 @@
+/* 
+ * arena.h - header file for CS50 arena module
+ *
+ * An *arena* is a bump allocator: it carves small allocations out of
+ * large blocks, and frees them all at once when the arena is deleted.
+ * There is no way to free a single allocation.  Use an arena for many
+ * small objects that all live and die together, such as the keys and
+ * counters of an index; they end up packed next to each other, and
+ * teardown costs one free per block instead of one per object.
+ *
+ * Jake Fleming, 11/12/24
+ */
+
+#ifndef __ARENA_H
+#define __ARENA_H
+
+#include <stddef.h>
+#include "mem.h"
+
+/**************** global types ****************/
+typedef struct arena arena_t;  // opaque to users of the module
+
+/**************** functions ****************/
+
+/**************** arena_new ****************/
+/* Create a new (empty) arena.
+ *
+ * Caller provides:
+ *   size in bytes of the blocks to carve allocations from,
+ *   or 0 for a reasonable default.
+ * We return:
+ *   pointer to the new arena; NULL if error (out of memory).
+ * Caller is responsible for:
+ *   later calling arena_delete.
+ */
+arena_t* arena_new(const size_t blocksize);
+
+/**************** arena_newTagged ****************/
+/* Just like arena_new, but the arena's blocks are charged to the
+ * given tag in the mem module's reports.
+ */
+arena_t* arena_newTagged(const size_t blocksize, const mem_tag_t tag);
+
+/**************** arena_alloc ****************/
+/* Allocate size bytes from the arena.
+ *
+ * Caller provides:
+ *   valid pointer to arena, and size (> 0).
+ * We return:
+ *   pointer to uninitialized memory, suitably aligned for any type;
+ *   NULL if arena is NULL, size is 0, or out of memory.
+ * Notes:
+ *   the memory stays valid until arena_delete; do not free() it.
+ *   requests larger than a quarter block get a block of their own.
+ */
+void* arena_alloc(arena_t* arena, const size_t size);
+
+/**************** arena_realloc ****************/
+/* Resize an allocation made from this arena.
+ *
+ * Caller provides:
+ *   valid pointer to arena,
+ *   pointer previously returned by this arena (or NULL),
+ *   its current size in bytes, and the new size in bytes.
+ * We return:
+ *   pointer to memory holding the first min(oldsize, newsize) bytes of
+ *   the old allocation; NULL if error, in which case ptr is untouched.
+ * Notes:
+ *   if ptr was the most recent allocation and the block has room, it
+ *   grows in place; otherwise the contents move and the old space is
+ *   simply abandoned until arena_delete.
+ */
+void* arena_realloc(arena_t* arena, void* ptr,
+                    const size_t oldsize, const size_t newsize);
+
+/**************** arena_strdup ****************/
+/* Copy a string into the arena.
+ *
+ * Caller provides:
+ *   valid pointer to arena, valid string.
+ * We return:
+ *   pointer to the copy, or NULL if error.
+ * Notes:
+ *   strings are packed without alignment padding.
+ */
+char* arena_strdup(arena_t* arena, const char* str);
+
+/**************** arena_delete ****************/
+/* Delete the arena and everything allocated from it.
+ *
+ * Caller provides:
+ *   valid pointer to arena.
+ * We do:
+ *   ignore NULL arena.
+ *   free every block; all memory obtained from the arena becomes invalid.
+ */
+void arena_delete(arena_t* arena);
+
+#endif // __ARENA_H
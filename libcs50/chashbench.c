@@ -0,0 +1,224 @@
+/*
+ * chashbench.c - contention benchmark for the concurrent hashtable
+ *
+ * Mimics the crawler's pagesSeen dedup: threads draw URLs at random
+ * from a shared pool and insert each one if it is new, with a share
+ * of plain lookups mixed in.  Each run is timed at 1, 2, 4, 8 and 16
+ * threads, once against chashtable and once against a single hashtable
+ * behind one global mutex, the obvious alternative.
+ *
+ * Usage:
+ *   ./chashbench [numKeys [opsPerThread [findPercent]]]
+ *
+ * Jake Fleming, 11/18/24
+ */
+
+#define _POSIX_C_SOURCE 200809L     // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include "chashtable.h"
+#include "hashtable.h"
+
+/**************** local types ****************/
+// a table under test, behind a uniform interface
+typedef struct table {
+    void* impl;
+    pthread_mutex_t lock;       // used only by the global-lock table
+    bool (*insert)(struct table* t, const char* key, void* item);
+    void* (*find)(struct table* t, const char* key);
+} table_t;
+
+typedef struct worker {
+    pthread_t thread;
+    table_t* table;
+    uint64_t seed;
+    long inserted;              // successful inserts by this thread
+} worker_t;
+
+/**************** file-local global variables ****************/
+static char** keys;
+static long numKeys = 200000;
+static long opsPerThread = 500000;
+static int findPercent = 50;
+
+/**************** function prototypes ****************/
+static bool stripedInsert(table_t* t, const char* key, void* item);
+static void* stripedFind(table_t* t, const char* key);
+static bool globalInsert(table_t* t, const char* key, void* item);
+static void* globalFind(table_t* t, const char* key);
+static void* work(void* arg);
+static double run(const char* name, int nthreads, bool striped);
+static double now(void);
+
+/***************** main *****************/
+int
+main(int argc, char* argv[])
+{
+    if (argc > 4) {
+        fprintf(stderr, "Usage: ./chashbench [numKeys [opsPerThread [findPercent]]]\n");
+        return 1;
+    }
+    if (argc > 1) {
+        numKeys = atol(argv[1]);
+    }
+    if (argc > 2) {
+        opsPerThread = atol(argv[2]);
+    }
+    if (argc > 3) {
+        findPercent = atoi(argv[3]);
+    }
+    if (numKeys < 1 || opsPerThread < 1 || findPercent < 0 || findPercent > 100) {
+        fprintf(stderr, "Error: bad arguments\n");
+        return 1;
+    }
+
+    // a pool of URLs shaped like the ones the crawler sees
+    keys = malloc(numKeys * sizeof(char*));
+    if (keys == NULL) {
+        return 2;
+    }
+    for (long i = 0; i < numKeys; i++) {
+        keys[i] = malloc(80);
+        if (keys[i] == NULL) {
+            return 2;
+        }
+        snprintf(keys[i], 80, "http://cs50tse.cs.dartmouth.edu/tse/page%ld.html", i);
+    }
+
+    printf("%ld keys, %ld ops/thread, %d%% finds\n", numKeys, opsPerThread, findPercent);
+    printf("%-8s %12s %12s %8s\n", "threads", "global Mops", "striped Mops", "ratio");
+    for (int nthreads = 1; nthreads <= 16; nthreads *= 2) {
+        double global = run("global", nthreads, false);
+        double striped = run("striped", nthreads, true);
+        printf("%-8d %12.2f %12.2f %7.2fx\n", nthreads, global, striped, striped / global);
+    }
+
+    for (long i = 0; i < numKeys; i++) {
+        free(keys[i]);
+    }
+    free(keys);
+    return 0;
+}
+
+/***************** run *****************/
+/* fill a fresh table from nthreads threads; return millions of ops/s */
+static double
+run(const char* name, int nthreads, bool striped)
+{
+    table_t table;
+    if (striped) {
+        table.impl = chashtable_new(numKeys);
+        table.insert = stripedInsert;
+        table.find = stripedFind;
+    }
+    else {
+        table.impl = hashtable_new(numKeys);
+        table.insert = globalInsert;
+        table.find = globalFind;
+    }
+    if (table.impl == NULL) {
+        fprintf(stderr, "Error: out of memory building %s table\n", name);
+        exit(2);
+    }
+    pthread_mutex_init(&table.lock, NULL);
+
+    worker_t workers[16];
+    double start = now();
+    for (int i = 0; i < nthreads; i++) {
+        workers[i] = (worker_t){ .table = &table, .seed = 0x9e3779b97f4a7c15ULL * (i + 1) };
+        pthread_create(&workers[i].thread, NULL, work, &workers[i]);
+    }
+    long inserted = 0;
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        inserted += workers[i].inserted;
+    }
+    double seconds = now() - start;
+
+    // every key should have been inserted exactly once, by someone
+    int size = striped ? chashtable_size(table.impl) : hashtable_size(table.impl);
+    if (inserted != size) {
+        fprintf(stderr, "Error: %s table has %d keys but %ld inserts succeeded\n",
+                name, size, inserted);
+        exit(3);
+    }
+
+    if (striped) {
+        chashtable_delete(table.impl, NULL);
+    }
+    else {
+        hashtable_delete(table.impl, NULL);
+    }
+    pthread_mutex_destroy(&table.lock);
+    return (double)nthreads * opsPerThread / seconds / 1e6;
+}
+
+/***************** work *****************/
+/* one thread's share of the operations */
+static void*
+work(void* arg)
+{
+    worker_t* w = arg;
+    uint64_t x = w->seed;
+    for (long op = 0; op < opsPerThread; op++) {
+        // xorshift64, so threads do not share a random-number state
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        const char* key = keys[x % numKeys];
+        if ((long)((x >> 32) % 100) < findPercent) {
+            w->table->find(w->table, key);
+        }
+        else if (w->table->insert(w->table, key, (void*)key)) {
+            w->inserted++;
+        }
+    }
+    return NULL;
+}
+
+/***************** stripedInsert, stripedFind *****************/
+static bool
+stripedInsert(table_t* t, const char* key, void* item)
+{
+    return chashtable_insert(t->impl, key, item);
+}
+
+static void*
+stripedFind(table_t* t, const char* key)
+{
+    return chashtable_find(t->impl, key);
+}
+
+/***************** globalInsert, globalFind *****************/
+static bool
+globalInsert(table_t* t, const char* key, void* item)
+{
+    pthread_mutex_lock(&t->lock);
+    bool inserted = hashtable_insert(t->impl, key, item);
+    pthread_mutex_unlock(&t->lock);
+    return inserted;
+}
+
+static void*
+globalFind(table_t* t, const char* key)
+{
+    pthread_mutex_lock(&t->lock);
+    void* item = hashtable_find(t->impl, key);
+    pthread_mutex_unlock(&t->lock);
+    return item;
+}
+
+/***************** now *****************/
+/* monotonic time in seconds */
+static double
+now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
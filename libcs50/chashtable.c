@@ -0,0 +1,171 @@
+/*
+ * chashtable.c - concurrent hashtable module
+ *
+ * see chashtable.h for more information
+ *
+ * The table is striped: the top bits of a key's hash pick one of
+ * NSTRIPES ordinary hashtables, and each of those has its own mutex.
+ * The hashtable module picks slots with the low bits of the same hash,
+ * so the split costs nothing in distribution, and the key is hashed
+ * once, here, and handed down.  Each stripe sits on its
+ * own cache line, so threads locking neighbouring stripes do not fight
+ * over the line that holds the locks.
+ *
+ * Jake Fleming, 11/18/24
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "chashtable.h"
+#include "hashtable.h"
+#include "mem.h"
+
+/**************** local constants ****************/
+#define STRIPE_BITS 6
+#define NSTRIPES (1 << STRIPE_BITS)     // enough for 16 threads to rarely collide
+#define CACHE_LINE 64
+
+/**************** local types ****************/
+typedef struct stripe {
+    _Alignas(CACHE_LINE) pthread_mutex_t lock;
+    hashtable_t* ht;
+} stripe_t;
+
+/**************** global types ****************/
+typedef struct chashtable {
+    stripe_t stripes[NSTRIPES];
+} chashtable_t;
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static stripe_t* stripe_for(chashtable_t* cht, const unsigned long hash);
+
+/**************** global functions ****************/
+/* that is, visible outside this file */
+/* see chashtable.h for comments about exported functions */
+
+/**************** chashtable_new ****************/
+/* see chashtable.h for description */
+chashtable_t*
+chashtable_new(const int num_slots)
+{
+    if (num_slots <= 0) {
+        return NULL;
+    }
+    // aligned_alloc, since the stripes must start on cache lines
+    chashtable_t* cht = aligned_alloc(CACHE_LINE, sizeof(chashtable_t));
+    if (cht == NULL) {
+        return NULL;
+    }
+
+    int per_stripe = num_slots / NSTRIPES + 1;
+    for (int i = 0; i < NSTRIPES; i++) {
+        stripe_t* s = &cht->stripes[i];
+        s->ht = hashtable_new(per_stripe);
+        if (s->ht == NULL || pthread_mutex_init(&s->lock, NULL) != 0) {
+            // unwind the stripes built so far
+            hashtable_delete(s->ht, NULL);
+            for (int j = 0; j < i; j++) {
+                pthread_mutex_destroy(&cht->stripes[j].lock);
+                hashtable_delete(cht->stripes[j].ht, NULL);
+            }
+            free(cht);
+            return NULL;
+        }
+    }
+    return cht;
+}
+
+/**************** chashtable_insert ****************/
+/* see chashtable.h for description */
+bool
+chashtable_insert(chashtable_t* cht, const char* key, void* item)
+{
+    if (cht == NULL || key == NULL || item == NULL) {
+        return false;
+    }
+    unsigned long hash = hashtable_hash(key);
+    stripe_t* s = stripe_for(cht, hash);
+    pthread_mutex_lock(&s->lock);
+    bool inserted = hashtable_insertHashed(s->ht, key, hash, item);
+    pthread_mutex_unlock(&s->lock);
+    return inserted;
+}
+
+/**************** chashtable_find ****************/
+/* see chashtable.h for description */
+void*
+chashtable_find(chashtable_t* cht, const char* key)
+{
+    if (cht == NULL || key == NULL) {
+        return NULL;
+    }
+    // the lock is still needed: an insert may be moving entries around
+    unsigned long hash = hashtable_hash(key);
+    stripe_t* s = stripe_for(cht, hash);
+    pthread_mutex_lock(&s->lock);
+    void* item = hashtable_findHashed(s->ht, key, hash);
+    pthread_mutex_unlock(&s->lock);
+    return item;
+}
+
+/**************** chashtable_size ****************/
+/* see chashtable.h for description */
+int
+chashtable_size(chashtable_t* cht)
+{
+    if (cht == NULL) {
+        return 0;
+    }
+    int size = 0;
+    for (int i = 0; i < NSTRIPES; i++) {
+        stripe_t* s = &cht->stripes[i];
+        pthread_mutex_lock(&s->lock);
+        size += hashtable_size(s->ht);
+        pthread_mutex_unlock(&s->lock);
+    }
+    return size;
+}
+
+/**************** chashtable_iterate ****************/
+/* see chashtable.h for description */
+void
+chashtable_iterate(chashtable_t* cht, void* arg,
+                   void (*itemfunc)(void* arg, const char* key, void* item) )
+{
+    if (cht == NULL || itemfunc == NULL) {
+        return;
+    }
+    for (int i = 0; i < NSTRIPES; i++) {
+        stripe_t* s = &cht->stripes[i];
+        pthread_mutex_lock(&s->lock);
+        hashtable_iterate(s->ht, arg, itemfunc);
+        pthread_mutex_unlock(&s->lock);
+    }
+}
+
+/**************** chashtable_delete ****************/
+/* see chashtable.h for description */
+void
+chashtable_delete(chashtable_t* cht, void (*itemdelete)(void* item) )
+{
+    if (cht == NULL) {
+        return;
+    }
+    for (int i = 0; i < NSTRIPES; i++) {
+        pthread_mutex_destroy(&cht->stripes[i].lock);
+        hashtable_delete(cht->stripes[i].ht, itemdelete);
+    }
+    free(cht);
+}
+
+/**************** stripe_for ****************/
+/* Pick the stripe for a key from the top bits of its hash. */
+static stripe_t*
+stripe_for(chashtable_t* cht, const unsigned long hash)
+{
+    return &cht->stripes[hash >> (sizeof(hash) * 8 - STRIPE_BITS)];
+}
@@ -0,0 +1,109 @@
+/*
+ * chashtable.h - header file for the concurrent hashtable module
+ *
+ * A *concurrent hashtable* is a hashtable of (key,item) pairs that many
+ * threads may insert into and search at the same time.  Keys are spread
+ * by hash over a fixed number of stripes; each stripe is an ordinary
+ * hashtable behind its own lock, so threads working on different stripes
+ * never wait for one another.
+ *
+ * Jake Fleming, 11/18/24
+ */
+
+#ifndef __CHASHTABLE_H
+#define __CHASHTABLE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+/**************** global types ****************/
+typedef struct chashtable chashtable_t;  // opaque to users of the module
+
+/**************** functions ****************/
+
+/**************** chashtable_new ****************/
+/* Create a new (empty) concurrent hashtable.
+ *
+ * Caller provides:
+ *   expected number of items (must be > 0).
+ * We return:
+ *   pointer to the new table; return NULL if error.
+ * Notes:
+ *   like hashtable_new, num_slots is only a hint; the stripes grow
+ *   on their own as items are inserted.
+ * Caller is responsible for:
+ *   later calling chashtable_delete, once no other thread is using it.
+ */
+chashtable_t* chashtable_new(const int num_slots);
+
+/**************** chashtable_insert ****************/
+/* Insert item, identified by key (string), if key is not already present.
+ *
+ * Caller provides:
+ *   valid pointer to table, valid string for key, valid pointer for item.
+ * We return:
+ *   false if key exists in the table, any parameter is NULL, or error;
+ *   true iff new item was inserted.
+ * Notes:
+ *   safe to call from many threads at once; when several threads insert
+ *   the same key, exactly one of them gets true.  The key is copied,
+ *   as in hashtable_insert.
+ */
+bool chashtable_insert(chashtable_t* cht, const char* key, void* item);
+
+/**************** chashtable_find ****************/
+/* Return the item associated with the given key.
+ *
+ * Caller provides:
+ *   valid pointer to table, valid string for key.
+ * We return:
+ *   pointer to the item corresponding to the given key, if found;
+ *   NULL if table is NULL, key is NULL, or key is not found.
+ * Notes:
+ *   safe to call from many threads at once, and alongside inserts.
+ */
+void* chashtable_find(chashtable_t* cht, const char* key);
+
+/**************** chashtable_size ****************/
+/* Return the number of items in the table.
+ *
+ * We return:
+ *   number of (key,item) pairs inserted so far; 0 if cht is NULL.
+ * Notes:
+ *   while other threads are inserting, the count is only a snapshot.
+ */
+int chashtable_size(chashtable_t* cht);
+
+/**************** chashtable_iterate ****************/
+/* Iterate over all items in the table; in undefined order.
+ *
+ * Caller provides:
+ *   valid pointer to table,
+ *   arbitrary void*arg pointer,
+ *   itemfunc that can handle a single (key, item) pair.
+ * We do:
+ *   nothing, if cht==NULL or itemfunc==NULL.
+ *   otherwise, call the itemfunc once for each item, with (arg, key, item).
+ * Notes:
+ *   each stripe is locked while we visit it, so itemfunc must not call
+ *   back into this table.
+ */
+void chashtable_iterate(chashtable_t* cht, void* arg,
+                        void (*itemfunc)(void* arg, const char* key, void* item) );
+
+/**************** chashtable_delete ****************/
+/* Delete the table, calling a delete function on each item.
+ *
+ * Caller provides:
+ *   valid table pointer,
+ *   valid pointer to function that handles one item (may be NULL).
+ * We do:
+ *   if cht==NULL, do nothing.
+ *   otherwise, unless itemdelete==NULL, call the itemdelete on each item;
+ *   free all the key strings, and the table itself.
+ * Notes:
+ *   no other thread may be using the table.
+ */
+void chashtable_delete(chashtable_t* cht, void (*itemdelete)(void* item) );
+
+#endif // __CHASHTABLE_H
@@ -1,8 +1,22 @@
-
 /*
  * counters.c - CS50 'counters' module
  *
  * see counters.h for more information
+ *
+ * The counters are kept in one contiguous array of (key,count) pairs,
+ * sorted by key.  Keys usually arrive in increasing order (the indexer
+ * visits documents by increasing docID), so the common case appends to
+ * the end of the array, and lookups gallop back from the end before
+ * falling into a binary search.
+ *
+ * The first few pairs live inline in the counters_t itself, and only
+ * once they overflow does the set spill to an array of its own.  Most
+ * words in an index occur in just one or two documents, so most sets
+ * never allocate anything beyond their 48-byte header.
+ *
+ * A counter set to zero is a tombstone: it stays in the array until
+ * tombstones make up more than a quarter of it, and then the next
+ * iteration squeezes them all out in a single pass.
  * 
  * Jake Fleming, 10/11/24
  */
@@ -11,22 +25,37 @@
 #include <stdlib.h>
 #include <string.h>
 #include "counters.h"
+#include "arena.h"
+#include "mem.h"
 
 /**************** local types ****************/
-typedef struct counternode {
+typedef struct counterpair {
     int key;
     int count;
-    struct counternode* next;
-} counternode_t;
+} counterpair_t;
+
+/**************** local constants ****************/
+#define INLINE_PAIRS 3      // pairs that fit inside counters_t itself
 
 /**************** global types ****************/
 typedef struct counters {
-    struct counternode* head;
+    union {
+        counterpair_t* spill;                   // when capacity > INLINE_PAIRS
+        counterpair_t inline_pairs[INLINE_PAIRS];  // otherwise
+    } u;                    // the pairs, sorted by key
+    int size;               // number of pairs in use, tombstones included
+    int capacity;           // number of pairs that fit
+    int live;               // number of pairs with a nonzero count
+    int total;              // sum of all the counts
+    arena_t* arena;         // where spilled pairs come from, or NULL for malloc
 } counters_t;
 
 /**************** local functions ****************/
 /* not visible outside this file */
-static counternode_t* counternode_new(int key);
+static inline counterpair_t* pairs_of(counters_t* ctrs);
+static int find_pos(counters_t* ctrs, const int key);
+static bool insert_at(counters_t* ctrs, int pos, const int key, const int count);
+static void compact(counters_t* ctrs);
 
 /**************** global functions ****************/
 /* that is, visible outside this file */
@@ -37,14 +66,42 @@ static counternode_t* counternode_new(int key);
 counters_t*
 counters_new(void)
 {
-    counters_t* counters = malloc(sizeof(counters_t));
+    counters_t* counters = mem_malloc_tagged(sizeof(counters_t), MEM_COUNTERS);
+
+    if (counters == NULL) {
+        return NULL;    // error allocating counters
+    }
+    else {
+        // initialize contents of counter structure
+        counters->size = 0;
+        counters->capacity = INLINE_PAIRS;
+        counters->live = 0;
+        counters->total = 0;
+        counters->arena = NULL;
+        return counters;
+    }
+}
+
+/**************** counters_newArena ****************/
+/* see counters.h for description */
+counters_t*
+counters_newArena(arena_t* arena)
+{
+    if (arena == NULL) {
+        return NULL;
+    }
+    counters_t* counters = arena_alloc(arena, sizeof(counters_t));
 
     if (counters == NULL) {
         return NULL;    // error allocating counters
     }
     else {
         // initialize contents of counter structure
-        counters->head = NULL;
+        counters->size = 0;
+        counters->capacity = INLINE_PAIRS;
+        counters->live = 0;
+        counters->total = 0;
+        counters->arena = arena;
         return counters;
     }
 }
@@ -55,60 +112,41 @@ int
 counters_add(counters_t* ctrs, const int key)
 {
     if (ctrs != NULL && key >= 0) {
-        // search for key in list
-        for (counternode_t* node = ctrs->head; node != NULL; 
-            node = node->next) {
-            if (node->key == key) {
-                node->count++;          // increment count
-                return node->count;     // return new count
+        // search for key in the array
+        counterpair_t* pairs = pairs_of(ctrs);
+        int pos = find_pos(ctrs, key);
+        if (pos < ctrs->size && pairs[pos].key == key) {
+            // a tombstone comes back to life
+            if (pairs[pos].count == 0) {
+                ctrs->live++;
             }
+            pairs[pos].count++;         // increment count
+            ctrs->total++;
+            return pairs[pos].count;    // return new count
         }
-        // if key isn't found, create a new node
-        counternode_t* new = counternode_new(key);
-
-        // handle error allocating
-        if (new == NULL) {
+        // if key isn't found, create a new counter where it belongs
+        if (!insert_at(ctrs, pos, key, 1)) {
             return 0;
         }
-        // insert new at the head of the list
-        new->next = ctrs->head;
-        ctrs->head = new;
-        return new->count;
+        ctrs->live++;
+        ctrs->total++;
+        return 1;
     }
     return 0;
 }
 
-/**************** counternode_new ****************/
-/* Allocate and initialize a counternode */
-static counternode_t* 
-counternode_new(int key)
-{
-    counternode_t* node = malloc(sizeof(counternode_t));
-
-    // handle error allocating
-    if (node == NULL) {
-        return NULL;
-    }
-    // create new node
-    node->key = key;
-    node->count = 1;
-    node->next = NULL;
-    return node;
-}
-
 /**************** counters_get ****************/
 /* see counters.h for description */
 int
 counters_get(counters_t* ctrs, const int key)
 {
     if (ctrs != NULL && key >= 0) {
-        // search for key in list
-        for (counternode_t* node = ctrs->head; node != NULL; 
-            node = node->next) {
-            // return count of key if found
-            if (node->key == key) {
-                return node->count;
-            }
+        // search for key in the array
+        counterpair_t* pairs = pairs_of(ctrs);
+        int pos = find_pos(ctrs, key);
+        // return count of key if found
+        if (pos < ctrs->size && pairs[pos].key == key) {
+            return pairs[pos].count;
         }
     }
     return 0;
@@ -120,31 +158,55 @@ bool
 counters_set(counters_t* ctrs, const int key, const int count)
 {
     if (ctrs != NULL && key >= 0 && count >=0) {
-        // search for key in list
-        for (counternode_t* node = ctrs->head; node != NULL; 
-            node = node->next) {
-            // update count if key is found
-            if (node->key == key) {
-                node->count = count;
-                return true;
-            }
+        // search for key in the array
+        counterpair_t* pairs = pairs_of(ctrs);
+        int pos = find_pos(ctrs, key);
+        // update count if key is found
+        if (pos < ctrs->size && pairs[pos].key == key) {
+            // track counters moving between live and tombstone
+            ctrs->live += (count > 0) - (pairs[pos].count > 0);
+            ctrs->total += count - pairs[pos].count;
+            pairs[pos].count = count;
+            return true;
         }
-        // if key isn't found, add it
-        counternode_t* new_node = counternode_new(key);
-        // handle error allocating
-        if (new_node != NULL) {
-            // set the count
-            new_node->count = count;
-            
-            // insert the new node at the head of the list
-            new_node->next = ctrs->head;
-            ctrs->head = new_node;
+        // a zero counter is the same as no counter at all
+        if (count == 0) {
             return true;
         }
+        // if key isn't found, add it
+        if (!insert_at(ctrs, pos, key, count)) {
+            return false;
+        }
+        ctrs->live++;
+        ctrs->total += count;
+        return true;
     }
     return false;
 }
 
+/**************** counters_remove ****************/
+/* see counters.h for description */
+bool
+counters_remove(counters_t* ctrs, const int key)
+{
+    if (ctrs != NULL && key >= 0) {
+        counterpair_t* pairs = pairs_of(ctrs);
+        int pos = find_pos(ctrs, key);
+        if (pos < ctrs->size && pairs[pos].key == key) {
+            // a tombstone is removed too, but was never in live or total
+            if (pairs[pos].count > 0) {
+                ctrs->live--;
+                ctrs->total -= pairs[pos].count;
+            }
+            // close the gap so the array stays dense and sorted
+            memmove(&pairs[pos], &pairs[pos + 1],
+                    (ctrs->size - pos - 1) * sizeof(counterpair_t));
+            ctrs->size--;
+            return true;
+        }
+    }
+    return false;
+}
 
 /**************** counters_print ****************/
 /* see counters.h for description */
@@ -153,15 +215,21 @@ counters_print(counters_t* ctrs, FILE* fp)
 {
     if (fp != NULL) {
         if (ctrs != NULL) {
+            compact(ctrs);
+            counterpair_t* pairs = pairs_of(ctrs);
             fputc('{', fp);
-            for (counternode_t* node = ctrs->head; node != NULL; 
-                node = node->next) {
-                // print key-count pair
-                fprintf(fp, "%d=%d", node->key, node->count);
-                // print ',' if not at the end
-                if (node->next != NULL) {
+            bool first = true;
+            for (int i = 0; i < ctrs->size; i++) {
+                if (pairs[i].count == 0) {
+                    continue;   // skip tombstones
+                }
+                // print ',' between pairs
+                if (!first) {
                     fputc(',', fp);
                 }
+                // print key-count pair
+                fprintf(fp, "%d=%d", pairs[i].key, pairs[i].count);
+                first = false;
             }
             fputc('}', fp);
             fputs("\n", fp);
@@ -179,10 +247,15 @@ counters_iterate(counters_t* ctrs, void* arg,
     void (*itemfunc)(void* arg, const int key, const int count))
 {
     if (ctrs != NULL && itemfunc != NULL) {
-        // call itemfunc with arg on each item
-        for (counternode_t* node = ctrs->head; node != NULL;
-            node = node->next) {
-            (*itemfunc)(arg, node->key, node->count);
+        // drop tombstones first if there are enough of them to matter
+        compact(ctrs);
+        counterpair_t* pairs = pairs_of(ctrs);
+
+        // call itemfunc with arg on each live item, in increasing key order
+        for (int i = 0; i < ctrs->size; i++) {
+            if (pairs[i].count > 0) {
+                (*itemfunc)(arg, pairs[i].key, pairs[i].count);
+            }
         }
     }
 }
@@ -192,25 +265,12 @@ counters_iterate(counters_t* ctrs, void* arg,
 void
 counters_delete(counters_t* ctrs)
 {
-    if (ctrs != NULL) {
-        for (counternode_t* node = ctrs->head; node != NULL;) {
-            counternode_t* next = node->next;
-            free(node);
-            node = next;
+    // arena-backed counters go away with their arena
+    if (ctrs != NULL && ctrs->arena == NULL) {
+        if (ctrs->capacity > INLINE_PAIRS) {
+            mem_free(ctrs->u.spill);
         }
-        free(ctrs);
-    }
-}
-
-/**************** size_helper ****************/
-/* increment a counter size */
-static void 
-size_helper(void* arg, const int key, int count) 
-{
-    // check it is in the counterset
-    if (count > 0) {
-        int* size = (int*)arg;
-        (*size)++;
+        mem_free(ctrs);
     }
 }
 
@@ -223,11 +283,15 @@ counters_size(counters_t* ctrs)
     if (ctrs == NULL) {
         return 0;
     }
-    
-    // iterate through every key
-    int size = 0;
-    counters_iterate(ctrs, &size, size_helper);
-    return size;
+    return ctrs->live;
+}
+
+/**************** counters_total ****************/
+/* see counters.h for description */
+int
+counters_total(counters_t* ctrs)
+{
+    return (ctrs == NULL) ? 0 : ctrs->total;
 }
 
 /**************** counters_copy ****************/
@@ -238,4 +302,145 @@ counters_copy(void* arg, const int key, const int count)
     // directly set each key-count pair in the destination
     counters_t* dest = arg;
     counters_set(dest, key, count);  
-}
\ No newline at end of file
+}
+
+/**************** counters_seek ****************/
+/* see counters.h for description */
+int
+counters_seek(counters_t* ctrs, const int key)
+{
+    if (ctrs == NULL) {
+        return 0;
+    }
+    return find_pos(ctrs, (key < 0) ? 0 : key);
+}
+
+/**************** counters_positions ****************/
+/* see counters.h for description */
+int
+counters_positions(counters_t* ctrs)
+{
+    return (ctrs == NULL) ? 0 : ctrs->size;
+}
+
+/**************** counters_at ****************/
+/* see counters.h for description */
+bool
+counters_at(counters_t* ctrs, const int pos, int* key, int* count)
+{
+    if (ctrs == NULL || pos < 0 || pos >= ctrs->size || key == NULL || count == NULL) {
+        return false;
+    }
+    counterpair_t* pairs = pairs_of(ctrs);
+    *key = pairs[pos].key;
+    *count = pairs[pos].count;
+    return true;
+}
+
+/**************** pairs_of ****************/
+/* Return the pairs array, wherever it currently lives. */
+static inline counterpair_t*
+pairs_of(counters_t* ctrs)
+{
+    return (ctrs->capacity > INLINE_PAIRS) ? ctrs->u.spill : ctrs->u.inline_pairs;
+}
+
+/**************** find_pos ****************/
+/* Return the position of key in the array, or the position where
+ * it would be inserted if it is not there.  We gallop backward from
+ * the end (where most keys land) and then binary search the bracket.
+ */
+static int
+find_pos(counters_t* ctrs, const int key)
+{
+    counterpair_t* pairs = pairs_of(ctrs);
+    int size = ctrs->size;
+    if (size == 0 || pairs[size - 1].key < key) {
+        return size;    // the append case
+    }
+
+    // gallop: widen the bracket [lo, hi) until pairs[lo].key < key
+    int hi = size - 1;
+    int step = 1;
+    int lo = hi - step;
+    while (lo >= 0 && pairs[lo].key >= key) {
+        hi = lo;
+        step <<= 1;
+        lo = hi - step;
+    }
+    lo = (lo < 0) ? 0 : lo + 1;
+
+    // binary search for the first pair with key >= the given key
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (pairs[mid].key < key) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**************** insert_at ****************/
+/* Insert a new pair at pos, growing the array geometrically; the
+ * first growth spills the inline pairs out to an array of their own.
+ */
+static bool
+insert_at(counters_t* ctrs, int pos, const int key, const int count)
+{
+    if (ctrs->size == ctrs->capacity) {
+        int capacity = ctrs->capacity * 2;
+        size_t oldsize = ctrs->capacity * sizeof(counterpair_t);
+        size_t newsize = capacity * sizeof(counterpair_t);
+        bool spilled = ctrs->capacity > INLINE_PAIRS;
+        counterpair_t* pairs;
+        if (ctrs->arena != NULL) {
+            pairs = spilled ? arena_realloc(ctrs->arena, ctrs->u.spill, oldsize, newsize)
+                            : arena_alloc(ctrs->arena, newsize);
+        }
+        else {
+            pairs = spilled ? mem_realloc_tagged(ctrs->u.spill, newsize, MEM_COUNTERS)
+                            : mem_malloc_tagged(newsize, MEM_COUNTERS);
+        }
+        // handle error allocating
+        if (pairs == NULL) {
+            return false;
+        }
+        if (!spilled) {
+            memcpy(pairs, ctrs->u.inline_pairs, oldsize);
+        }
+        ctrs->u.spill = pairs;
+        ctrs->capacity = capacity;
+    }
+    // shift the tail up, unless we are appending
+    counterpair_t* pairs = pairs_of(ctrs);
+    if (pos < ctrs->size) {
+        memmove(&pairs[pos + 1], &pairs[pos],
+                (ctrs->size - pos) * sizeof(counterpair_t));
+    }
+    pairs[pos].key = key;
+    pairs[pos].count = count;
+    ctrs->size++;
+    return true;
+}
+
+/**************** compact ****************/
+/* Squeeze tombstones out of the array once they pass a quarter of it. */
+static void
+compact(counters_t* ctrs)
+{
+    int dead = ctrs->size - ctrs->live;
+    if (dead == 0 || dead * 4 <= ctrs->size) {
+        return;
+    }
+    counterpair_t* pairs = pairs_of(ctrs);
+    int out = 0;
+    for (int i = 0; i < ctrs->size; i++) {
+        if (pairs[i].count > 0) {
+            pairs[out++] = pairs[i];
+        }
+    }
+    ctrs->size = out;
+}
@@ -8,6 +8,12 @@
  * empty. Each time `counters_add` is called on a given key, that key's
  * counter is incremented. The current counter value can be retrieved by
  * asking for the relevant key.
+ *
+ * Counters are stored sorted by key, so adding keys in increasing order
+ * is cheapest, and iteration visits keys in increasing order.  A counter
+ * whose value is 0 is treated as absent: it is not counted, printed,
+ * or iterated over.  The first few counters are stored inside the
+ * counterset itself, so a small counterset costs a single allocation.
  * 
  * David Kotz, April 2016, 2017, 2019, 2021
  * Xia Zhou, July 2017
@@ -18,6 +24,7 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include "arena.h"
 
 /**************** global types ****************/
 typedef struct counters counters_t;  // opaque to users of the module
@@ -36,6 +43,20 @@ typedef struct counters counters_t;  // opaque to users of the module
  */
 counters_t* counters_new(void);
 
+/**************** counters_newArena ****************/
+/* Create a new (empty) counter structure whose memory comes from an arena.
+ *
+ * Caller provides:
+ *   valid pointer to an arena.
+ * We return:
+ *   pointer to a new counterset; NULL if error (NULL arena, out of memory).
+ * Notes:
+ *   the counterset behaves exactly like one from counters_new, but
+ *   counters_delete releases nothing; its memory is reclaimed when the
+ *   arena is deleted, so the arena must outlive the counterset.
+ */
+counters_t* counters_newArena(arena_t* arena);
+
 /**************** counters_add ****************/
 /* Increment the counter indicated by key.
  * 
@@ -80,9 +101,26 @@ int counters_get(counters_t* ctrs, const int key);
  *   If the key does not yet exist, create a counter for it and initialize to
  *   the given value. 
  *   If the key does exist, update its counter value to the given value.
+ * Note:
+ *   setting a counter to 0 leaves a tombstone that is dropped lazily;
+ *   use counters_remove to drop the key immediately.
  */
 bool counters_set(counters_t* ctrs, const int key, const int count);
 
+/**************** counters_remove ****************/
+/* Remove the counter associated with the given key.
+ *
+ * Caller provides:
+ *   valid pointer to counterset, and key (must be >= 0)
+ * We return:
+ *   true if the key was present and has been removed;
+ *   false if ctrs is NULL, key < 0, or key is not found.
+ * Note:
+ *   unlike counters_set(ctrs, key, 0), which leaves a zero counter
+ *   behind, the key no longer exists in the counterset afterward.
+ */
+bool counters_remove(counters_t* ctrs, const int key);
+
 /**************** counters_print ****************/
 /* Print all counters; provide the output file.
  *
@@ -92,7 +130,8 @@ bool counters_set(counters_t* ctrs, const int key, const int count);
  * We print:
  *   Nothing if NULL fp. 
  *   "(null)" if NULL ctrs.
- *   otherwise, comma-separated list of key=counter pairs, all in {brackets}.
+ *   otherwise, comma-separated list of key=counter pairs, all in {brackets},
+ *   in increasing order of key, leaving out zero counters.
  */
 void counters_print(counters_t* ctrs, FILE* fp);
 
@@ -106,9 +145,11 @@ void counters_print(counters_t* ctrs, FILE* fp);
  * We do:
  *   nothing, if ctrs==NULL or itemfunc==NULL.
  *   otherwise, call itemfunc once for each item, with (arg, key, count).
+ *   counters whose value is 0 are skipped.
  * Note:
- *   the order in which items are handled is undefined.
- *   the counterset is unchanged by this operation.
+ *   items are handled in increasing order of key.
+ *   the counterset is unchanged by this operation; the itemfunc may
+ *   update the count of an existing key, but must not add or remove keys.
  */
 void counters_iterate(counters_t* ctrs, void* arg, 
                       void (*itemfunc)(void* arg, 
@@ -132,10 +173,21 @@ void counters_delete(counters_t* ctrs);
  *   valid pointer to counterset
  * 
  * We do:
- *   return number of keys
+ *   return number of keys with a nonzero counter, in constant time
  */
 int counters_size(counters_t* ctrs);
 
+/**************** counters_total ****************/
+/* Sum the counts of all the keys
+ * 
+ * Caller provides:
+ *   valid pointer to counterset
+ * 
+ * We do:
+ *   return the sum of all the counters, in constant time; 0 if NULL
+ */
+int counters_total(counters_t* ctrs);
+
 /**************** counters_copy ****************/
 /* copy one counter into another
  * 
@@ -149,4 +201,40 @@ int counters_size(counters_t* ctrs);
  */
 void counters_copy(void* arg, const int key, const int count);
 
+/**************** counters_seek ****************/
+/* Find where a key is, or would be, in the sorted counters
+ * 
+ * Caller provides:
+ *   valid pointer to counterset, key >= 0
+ * 
+ * We return:
+ *   the position of the first counter whose key is >= key,
+ *   which is counters_positions(ctrs) if there is none; 0 if ctrs is NULL
+ * Notes:
+ *   positions let a caller walk the counters in key order, and jump
+ *   ahead, without a callback; they are good until the counterset is
+ *   next changed, iterated or printed.
+ */
+int counters_seek(counters_t* ctrs, const int key);
+
+/**************** counters_positions ****************/
+/* Return the number of positions, that is, one past the last one;
+ * 0 if ctrs is NULL.
+ */
+int counters_positions(counters_t* ctrs);
+
+/**************** counters_at ****************/
+/* Get the key and count at a position
+ * 
+ * Caller provides:
+ *   valid pointer to counterset, a position from counters_seek or
+ *   between 0 and counters_positions - 1, where to store key and count
+ * 
+ * We return:
+ *   false if ctrs is NULL or pos is out of range; otherwise true, and
+ *   the key and its count, which may be 0 for a counter that was set
+ *   to zero, so callers usually skip such positions
+ */
+bool counters_at(counters_t* ctrs, const int pos, int* key, int* count);
+
 #endif // __COUNTERS_H
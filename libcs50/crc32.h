@@ -0,0 +1,30 @@
+/* =========================================================================
+ * crc32.h - CRC-32 checksum of a stream of bytes
+ *
+ * The common CRC-32 (as in zlib, gzip and PNG), computed a byte at a
+ * time from a table.  The checksum can be built up piece by piece, so
+ * a writer can checksum each buffer as it goes out instead of holding
+ * the whole file.
+ *
+ * Jake Fleming, 11/27/24
+ * =========================================================================
+ */
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * crc32_update - extend a checksum over len more bytes
+ * crc: the checksum of the bytes so far, 0 for none
+ * data: the next bytes (may be NULL if len is 0)
+ * len: number of bytes
+ *
+ * Returns the checksum of the bytes so far followed by data; so
+ * crc32_update(0, data, len) is the checksum of data alone.
+ */
+uint32_t crc32_update(uint32_t crc, const void* data, const size_t len);
+
+#endif // CRC32_H
@@ -0,0 +1,110 @@
+/* =========================================================================
+ * fasthash.c - fast 64-bit string hash, maps from bytes to integer
+ *
+ * Based on wyhash by Wang Yi: https://github.com/wangyi-fudan/wyhash
+ * (released into the public domain).
+ * ========================================================================= 
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include "fasthash.h"
+
+// mixing constants: odd, with balanced bits
+static const uint64_t secret[4] = {
+  0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+  0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+// multiply A*B as a 128-bit product; A gets the low half, B the high half
+static inline void
+mum(uint64_t* A, uint64_t* B)
+{
+#ifdef __SIZEOF_INT128__
+  __extension__ unsigned __int128 r = *A;
+  r *= *B;
+  *A = (uint64_t)r;
+  *B = (uint64_t)(r >> 64);
+#else
+  uint64_t ha = *A >> 32, hb = *B >> 32, la = (uint32_t)*A, lb = (uint32_t)*B;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32), c = t < rl;
+  uint64_t lo = t + (rm1 << 32);
+  c += lo < t;
+  uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+  *A = lo;
+  *B = hi;
+#endif
+}
+
+// fold a 128-bit product back into 64 bits
+static inline uint64_t
+mix(uint64_t A, uint64_t B)
+{
+  mum(&A, &B);
+  return A ^ B;
+}
+
+// unaligned little reads; memcpy compiles to a single load
+static inline uint64_t read8(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint64_t read4(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static inline uint64_t
+read3(const uint8_t* p, const size_t k)
+{
+  return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1];
+}
+
+// fasthash_bytes - see header file for usage
+uint64_t
+fasthash_bytes(const void* data, const size_t len)
+{
+  const uint8_t* p = data;
+  uint64_t seed = mix(secret[0], secret[1]);
+  uint64_t a, b;
+
+  if (len <= 16) {
+    // short keys, like nearly every word: two overlapping reads
+    if (len >= 4) {
+      a = (read4(p) << 32) | read4(p + ((len >> 3) << 2));
+      b = (read4(p + len - 4) << 32) | read4(p + len - 4 - ((len >> 3) << 2));
+    } else if (len > 0) {
+      a = read3(p, len);
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    // longer keys, like URLs: 48 bytes per round in three lanes
+    size_t i = len;
+    if (i > 48) {
+      uint64_t see1 = seed, see2 = seed;
+      do {
+        seed = mix(read8(p) ^ secret[1], read8(p + 8) ^ seed);
+        see1 = mix(read8(p + 16) ^ secret[2], read8(p + 24) ^ see1);
+        see2 = mix(read8(p + 32) ^ secret[3], read8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = mix(read8(p) ^ secret[1], read8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = read8(p + i - 16);
+    b = read8(p + i - 8);
+  }
+
+  a ^= secret[1];
+  b ^= seed;
+  mum(&a, &b);
+  return mix(a ^ secret[0] ^ len, b ^ secret[1]);
+}
+
+// fasthash_string - see header file for usage
+uint64_t
+fasthash_string(const char* str)
+{
+  return fasthash_bytes(str, strlen(str));
+}
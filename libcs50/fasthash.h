@@ -0,0 +1,53 @@
+/* =========================================================================
+ * fasthash.h - fast 64-bit string hash, maps from bytes to integer
+ *
+ * A word-at-a-time hash in the style of wyhash: it reads the key
+ * eight bytes at a time and mixes with 64x64->128 bit multiplies,
+ * so short keys cost a handful of instructions and long keys run
+ * at several bytes per cycle.  All 64 output bits are well mixed,
+ * so a table whose size is a power of two can take the low bits
+ * with a mask instead of reducing with '%'.
+ *
+ * Based on wyhash by Wang Yi: https://github.com/wangyi-fudan/wyhash
+ * Jake Fleming, 11/14/24
+ * ========================================================================= 
+ */
+
+#ifndef FASTHASH_H
+#define FASTHASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * fasthash_bytes - hash len bytes starting at data
+ * data: bytes to hash (may be NULL if len is 0)
+ * len: number of bytes
+ *
+ * Returns the 64-bit hash.  Callers that already know the
+ * length of a string should use this, and skip the strlen.
+ */
+uint64_t fasthash_bytes(const void* data, const size_t len);
+
+/*
+ * fasthash_string - hash a null-terminated string
+ * str: string to hash (non-NULL)
+ *
+ * Returns fasthash_bytes(str, strlen(str)).
+ */
+uint64_t fasthash_string(const char* str);
+
+/*
+ * fasthash_bucket - reduce a hash to a bucket number
+ * hash: value from fasthash_bytes or fasthash_string
+ * nbuckets: number of buckets, a power of two (>0)
+ *
+ * Returns hash mod nbuckets, computed with a mask.
+ */
+static inline unsigned long
+fasthash_bucket(const uint64_t hash, const unsigned long nbuckets)
+{
+  return (unsigned long)(hash & (nbuckets - 1));
+}
+
+#endif // FASTHASH_H
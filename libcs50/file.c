@@ -2,15 +2,28 @@
  * file utilities - reading a word, line, or entire file
  * 
  * See file.h for documentation.
+ *
+ * Reading is done in bulk wherever we can: whole files come in with
+ * one fread into a buffer sized from fstat, lines come from getline
+ * (which scans the stdio buffer for the newline with memchr), and
+ * every growing buffer doubles rather than growing a byte at a time.
  * 
  * David Kotz - 2016, 2017, 2019, 2021
  */
 
+#define _POSIX_C_SOURCE 200809L   // getline, fileno
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "file.h"
 
+/**************** local constants ****************/
+#define CHUNK 4096                  // first guess when size is unknown
+
 
 /**************** file_numLines ****************/
 int
@@ -22,10 +35,13 @@ file_numLines(FILE* fp)
 
   rewind(fp);
 
+  // read in big chunks and let memchr (vectorized in libc) find newlines
   int nlines = 0;
-  char c = '\0';
-  while ( (c = fgetc(fp)) != EOF) {
-    if (c == '\n') {
+  char buf[CHUNK * 16];
+  size_t n;
+  while ( (n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+    const char* end = buf + n;
+    for (const char* p = buf; (p = memchr(p, '\n', end - p)) != NULL; p++) {
       nlines++;
     }
   }
@@ -38,15 +54,86 @@ file_numLines(FILE* fp)
 /**************** utility stopfuncs ****************/
 // for use with readuntil()
 static int never(int c) { return (0); }
-static int isnewline(int c) { return (c == '\n'); }
 
 /**************** file_readFile ****************/
 /* See file.h for documentation. */
-char* file_readFile(FILE* fp) { return file_readUntil(fp, never); }
+char* file_readFile(FILE* fp) { return file_readFileLen(fp, NULL); }
+
+/**************** file_readFileLen ****************/
+/* See file.h for documentation. */
+char*
+file_readFileLen(FILE* fp, size_t* lenp)
+{
+  if (fp == NULL) {
+    return NULL;
+  }
+
+  // for a regular file, the rest of the file is exactly what we need;
+  // leave room past it so the read can see EOF without growing
+  size_t cap = CHUNK;
+  struct stat st;
+  long offset = ftell(fp);
+  if (fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode)
+      && offset >= 0 && st.st_size >= offset) {
+    cap = (size_t)(st.st_size - offset) + 2;
+  }
+
+  char* buf = malloc(cap);
+  if (buf == NULL) {
+    return NULL;
+  }
+
+  // read in bulk, doubling the buffer whenever it fills
+  size_t len = 0;
+  for (;;) {
+    len += fread(buf + len, 1, cap - 1 - len, fp);
+    if (len < cap - 1) {
+      break;                  // short read: EOF or error
+    }
+    char* newbuf = realloc(buf, cap * 2);
+    if (newbuf == NULL) {
+      free(buf);
+      return NULL;
+    }
+    buf = newbuf;
+    cap *= 2;
+  }
+
+  if (len == 0) {
+    // no characters were read and we reached EOF
+    free(buf);
+    return NULL;
+  }
+  buf[len] = '\0';
+  if (lenp != NULL) {
+    *lenp = len;
+  }
+  return buf;
+}
 
 /**************** file_readLine ****************/
 /* See file.h for documentation. */
-char* file_readLine(FILE* fp) { return file_readUntil(fp, isnewline); }
+char*
+file_readLine(FILE* fp)
+{
+  if (fp == NULL) {
+    return NULL;
+  }
+
+  // getline finds the newline within stdio's buffer and grows ours
+  char* buf = NULL;
+  size_t cap = 0;
+  ssize_t len = getline(&buf, &cap, fp);
+  if (len < 0) {
+    // error, or EOF reached without reading anything
+    free(buf);
+    return NULL;
+  }
+  if (len > 0 && buf[len-1] == '\n') {
+    buf[len-1] = '\0';       // drop the newline
+  }
+  return buf;
+}
 
 /**************** readword ****************/
 /* See file.h for documentation. */
@@ -62,7 +149,7 @@ file_readUntil(FILE* fp, int (*stopfunc)(int c))
   }
 
   // allocate buffer big enough for "typical" words/lines
-  int len = 81;
+  size_t len = 81;
   char* buf = malloc(len * sizeof(char));
   if (buf == NULL) {
     return NULL;
@@ -70,19 +157,21 @@ file_readUntil(FILE* fp, int (*stopfunc)(int c))
 
   // Read characters from file until stop-character or EOF, 
   // expanding the buffer when needed to hold more.
-  int pos;
-  char c;
-  for (pos = 0; (c = fgetc(fp)) != EOF && !(*stopfunc)(c); pos++) {
+  size_t pos;
+  int c;
+  for (pos = 0; (c = getc(fp)) != EOF && !(*stopfunc)(c); pos++) {
     // We need to save buf[pos+1] for the terminating null
     // and buf[len-1] is the last usable slot, 
-    // so if pos+1 is past that slot, we need to grow the buffer.
+    // so if pos+1 is past that slot, we need to grow the buffer;
+    // doubling keeps the total copying linear in the length.
     if (pos+1 > len-1) {
-      char* newbuf = realloc(buf, ++len * sizeof(char));
+      char* newbuf = realloc(buf, len * 2 * sizeof(char));
       if (newbuf == NULL) {
         free(buf);
         return NULL;
       } else {
         buf = newbuf;
+        len *= 2;
       }
     }
     buf[pos] = c;
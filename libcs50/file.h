@@ -39,6 +39,15 @@ char* file_readUntil(FILE* fp,    int (*stopfunc)(int c) );
  */
 char* file_readFile(FILE* fp);
 
+/**************** file_readFileLen ****************/
+/* 
+ * Just like file_readFile, and also store the number of characters
+ * read in *lenp, unless lenp is NULL.
+ * For a regular file, the buffer is sized once from the file size
+ * and filled with a single bulk read.
+ */
+char* file_readFileLen(FILE* fp, size_t* lenp);
+
 /**************** file_readLine ****************/
 /* 
  * Read a line from the file into a null-terminated string,
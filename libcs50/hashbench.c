@@ -0,0 +1,217 @@
+/*
+ * hashbench.c - compare fasthash against hash_jenkins
+ *
+ * Reads the vocabulary of an index file (the first word of each line)
+ * and reports, for each hash function, the hashing throughput and how
+ * evenly the words spread over a table of power-of-two size.
+ *
+ * Usage:
+ *   ./hashbench indexFilename [rounds]
+ *
+ * Jake Fleming, 11/14/24
+ */
+
+#define _POSIX_C_SOURCE 199309L     // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include "hash.h"
+#include "fasthash.h"
+#include "file.h"
+
+/**************** local types ****************/
+typedef struct vocab {
+    char** words;
+    size_t* lens;
+    size_t count;
+    size_t bytes;
+} vocab_t;
+
+/**************** function prototypes ****************/
+static bool loadVocab(FILE* fp, vocab_t* vocab);
+static double now(void);
+static void benchJenkins(vocab_t* vocab, unsigned long nbuckets, int rounds);
+static void benchFast(vocab_t* vocab, unsigned long nbuckets, int rounds);
+static void report(const char* name, double seconds, vocab_t* vocab,
+                   int rounds, unsigned long* loads, unsigned long nbuckets);
+
+// keeps the compiler from discarding the hash loops
+static volatile unsigned long sink;
+
+/***************** main *****************/
+int
+main(int argc, char* argv[])
+{
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "Usage: ./hashbench indexFilename [rounds]\n");
+        return 1;
+    }
+    FILE* fp = fopen(argv[1], "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Error: Could not open %s for reading\n", argv[1]);
+        return 2;
+    }
+    int rounds = (argc == 3) ? atoi(argv[2]) : 50;
+    if (rounds < 1) {
+        rounds = 1;
+    }
+
+    vocab_t vocab = { NULL, NULL, 0, 0 };
+    bool ok = loadVocab(fp, &vocab);
+    fclose(fp);
+    if (!ok || vocab.count == 0) {
+        fprintf(stderr, "Error: no words read from %s\n", argv[1]);
+        return 3;
+    }
+
+    // the table size the hashtable would settle at for this vocabulary
+    unsigned long nbuckets = 8;
+    while (nbuckets * 7 < vocab.count * 8) {
+        nbuckets <<= 1;
+    }
+
+    printf("%zu words, %zu bytes, %lu buckets, %d rounds\n",
+           vocab.count, vocab.bytes, nbuckets, rounds);
+    benchJenkins(&vocab, nbuckets, rounds);
+    benchFast(&vocab, nbuckets, rounds);
+
+    for (size_t i = 0; i < vocab.count; i++) {
+        free(vocab.words[i]);
+    }
+    free(vocab.words);
+    free(vocab.lens);
+    return 0;
+}
+
+/***************** loadVocab *****************/
+/* read the first word of every line, but for the '#' lines an index
+ * file starts and ends with (its header and crc32 footer) */
+static bool
+loadVocab(FILE* fp, vocab_t* vocab)
+{
+    size_t capacity = 0;
+    char* line;
+    while ((line = file_readLine(fp)) != NULL) {
+        char* word = strtok(line, " \t");
+        if (word == NULL || word[0] == '#') {
+            free(line);
+            continue;
+        }
+        if (vocab->count == capacity) {
+            capacity = (capacity == 0) ? 1024 : capacity * 2;
+            char** words = realloc(vocab->words, capacity * sizeof(char*));
+            size_t* lens = realloc(vocab->lens, capacity * sizeof(size_t));
+            if (words != NULL) {
+                vocab->words = words;
+            }
+            if (lens != NULL) {
+                vocab->lens = lens;
+            }
+            if (words == NULL || lens == NULL) {
+                free(line);
+                return false;
+            }
+        }
+        size_t len = strlen(word);
+        memmove(line, word, len + 1);   // keep the word at the start of line
+        vocab->words[vocab->count] = line;
+        vocab->lens[vocab->count] = len;
+        vocab->count++;
+        vocab->bytes += len;
+    }
+    return true;
+}
+
+/***************** now *****************/
+/* monotonic time in seconds */
+static double
+now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/***************** benchJenkins *****************/
+/* time hash_jenkins reduced with '%', as the old hashtable used it */
+static void
+benchJenkins(vocab_t* vocab, unsigned long nbuckets, int rounds)
+{
+    unsigned long acc = 0;
+    double start = now();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < vocab->count; i++) {
+            acc += hash_jenkins(vocab->words[i], nbuckets);
+        }
+    }
+    double seconds = now() - start;
+    sink = acc;
+
+    unsigned long* loads = calloc(nbuckets, sizeof(unsigned long));
+    if (loads == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < vocab->count; i++) {
+        loads[hash_jenkins(vocab->words[i], nbuckets)]++;
+    }
+    report("hash_jenkins", seconds, vocab, rounds, loads, nbuckets);
+    free(loads);
+}
+
+/***************** benchFast *****************/
+/* time fasthash on known lengths, reduced with a mask */
+static void
+benchFast(vocab_t* vocab, unsigned long nbuckets, int rounds)
+{
+    unsigned long acc = 0;
+    double start = now();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < vocab->count; i++) {
+            acc += fasthash_bucket(fasthash_bytes(vocab->words[i], vocab->lens[i]),
+                                   nbuckets);
+        }
+    }
+    double seconds = now() - start;
+    sink = acc;
+
+    unsigned long* loads = calloc(nbuckets, sizeof(unsigned long));
+    if (loads == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < vocab->count; i++) {
+        loads[fasthash_bucket(fasthash_string(vocab->words[i]), nbuckets)]++;
+    }
+    report("fasthash", seconds, vocab, rounds, loads, nbuckets);
+    free(loads);
+}
+
+/***************** report *****************/
+/* print throughput, and bucket statistics; for a uniform hash the
+ * chi-squared statistic is close to the number of buckets, so we
+ * print it divided by nbuckets and hope to see about 1.0
+ */
+static void
+report(const char* name, double seconds, vocab_t* vocab,
+       int rounds, unsigned long* loads, unsigned long nbuckets)
+{
+    double expected = (double)vocab->count / nbuckets;
+    double chi2 = 0;
+    unsigned long empty = 0, max = 0;
+    for (unsigned long b = 0; b < nbuckets; b++) {
+        double d = loads[b] - expected;
+        chi2 += d * d / expected;
+        if (loads[b] == 0) {
+            empty++;
+        }
+        if (loads[b] > max) {
+            max = loads[b];
+        }
+    }
+    double nhashes = (double)vocab->count * rounds;
+    printf("%-13s %8.1f MB/s %7.1f ns/word   empty %5.1f%%   max %lu   chi2/n %.3f\n",
+           name, vocab->bytes * rounds / seconds / 1e6, seconds / nhashes * 1e9,
+           100.0 * empty / nbuckets, max, chi2 / nbuckets);
+}
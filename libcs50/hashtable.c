@@ -2,7 +2,18 @@
  * hashtable.c - CS50 'hashtable' module
  *
  * see hashtable.h for more information
- * 
+ *
+ * The table uses open addressing with Robin Hood probing: every entry
+ * remembers the full hash of its key, and an entry that is further from
+ * its home slot than the one it collides with takes that slot.  This
+ * keeps probe sequences short and lets a lookup stop as soon as it meets
+ * an entry closer to home than the key being searched for.
+ *
+ * When the table passes 7/8 full it doubles in size, but entries
+ * are moved over incrementally: the old array stays readable and every
+ * insert migrates a few of its slots, so no single insert pays for the
+ * whole rehash.
+ *
  * Jake Fleming, 10/11/24
  */
 
@@ -10,19 +21,51 @@
 #include <stdlib.h>
 #include <string.h>
 #include "hashtable.h"
-#include "hash.h"
-#include "set.h"
+#include "fasthash.h"
+#include "arena.h"
+#include "mem.h"
+
 
+/**************** local types ****************/
+typedef struct htentry {
+    unsigned long hash;     // full hash of key; 0 marks an empty slot
+    char* key;
+    void* item;
+} htentry_t;
 
 /**************** global types ****************/
 typedef struct hashtable {
-    int num_slots;
-    set_t** slots;
+    htentry_t* slots;       // current array, capacity is a power of two
+    unsigned long mask;     // capacity - 1
+    unsigned long count;    // number of entries, including unmigrated ones
+
+    htentry_t* old;         // array being migrated away from, or NULL
+    unsigned long oldmask;  // capacity of old - 1
+    unsigned long migrated; // old[0..migrated-1] have been moved to slots
+
+    arena_t* arena;         // where key copies come from, or NULL for malloc
 } hashtable_t;
 
+/**************** local constants ****************/
+static const unsigned long MIN_SLOTS = 8;
+static const unsigned long MIGRATE_STEP = 16;   // old slots moved per insert
+// grow when count exceeds MAX_LOAD_NUM / MAX_LOAD_DEN of capacity
+static const unsigned long MAX_LOAD_NUM = 7;
+static const unsigned long MAX_LOAD_DEN = 8;
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static unsigned long hash_key(const char* key);
+static htentry_t* table_find(htentry_t* slots, unsigned long mask,
+                             unsigned long hash, const char* key);
+static void table_place(htentry_t* slots, unsigned long mask, htentry_t entry,
+                        unsigned long pos, unsigned long dist);
+static void migrate(hashtable_t* ht, unsigned long nslots);
+static bool grow(hashtable_t* ht);
+
 /**************** global functions ****************/
 /* that is, visible outside this file */
-/* see set.h for comments about exported functions */
+/* see hashtable.h for comments about exported functions */
 
 /**************** hashtable_new ****************/
 /* see hashtable.h for description */
@@ -30,57 +73,130 @@ hashtable_t*
 hashtable_new(const int num_slots)
 {
     if (num_slots > 0) {
-        hashtable_t* hashtable = malloc(sizeof(hashtable_t));
-        
+        hashtable_t* hashtable = mem_malloc_tagged(sizeof(hashtable_t), MEM_HASHTABLE);
+
         // handle error allocating
         if (hashtable == NULL) {
             return NULL;
         }
-        // allocate memory for the array of set pointers
-        hashtable->slots = malloc(num_slots * sizeof(set_t*));
 
-        // handle error allocating
-        if (hashtable->slots == NULL) {
-            free(hashtable);
-            return NULL;
+        // round the requested size up to a power of two
+        unsigned long capacity = MIN_SLOTS;
+        while (capacity < (unsigned long)num_slots) {
+            capacity <<= 1;
         }
-        hashtable->num_slots = num_slots;
 
-        // initialize each slot to an empty set
-        for (int i = 0; i < num_slots; i++) {
-            hashtable->slots[i] = set_new();
+        // allocate the slot array; all-zero means every slot is empty
+        hashtable->slots = mem_calloc_tagged(capacity, sizeof(htentry_t), MEM_HASHTABLE);
 
-            // handle error allocating
-            if (hashtable->slots[i] == NULL) {
-                // delete all of the previously created sets
-                for (int j = 0; j < i; j++) {
-                    set_delete(hashtable->slots[j], NULL);
-                }
-                // free the memory
-                free(hashtable->slots);
-                free(hashtable);
-                return NULL;
-            }
+        // handle error allocating
+        if (hashtable->slots == NULL) {
+            mem_free(hashtable);
+            return NULL;
         }
+        hashtable->mask = capacity - 1;
+        hashtable->count = 0;
+        hashtable->old = NULL;
+        hashtable->oldmask = 0;
+        hashtable->migrated = 0;
+        hashtable->arena = NULL;
         return hashtable;
     }
     return NULL;
 }
 
+/**************** hashtable_newArena ****************/
+/* see hashtable.h for description */
+hashtable_t*
+hashtable_newArena(const int num_slots, arena_t* arena)
+{
+    if (arena == NULL) {
+        return NULL;
+    }
+    hashtable_t* hashtable = hashtable_new(num_slots);
+    if (hashtable != NULL) {
+        hashtable->arena = arena;
+    }
+    return hashtable;
+}
+
 /**************** hashtable_insert ****************/
 /* see hashtable.h for description */
 bool
 hashtable_insert(hashtable_t* ht, const char* key, void* item)
 {
-    if (ht != NULL && key != NULL && item != NULL) {
-        // hash the key to determine the slot
-        unsigned long hash = hash_jenkins(key, ht->num_slots);
+    if (key == NULL) {
+        return false;
+    }
+    return hashtable_insertHashed(ht, key, hash_key(key), item);
+}
+
+/**************** hashtable_insertHashed ****************/
+/* see hashtable.h for description */
+bool
+hashtable_insertHashed(hashtable_t* ht, const char* key, const unsigned long hash,
+                       void* item)
+{
+    if (ht == NULL || key == NULL || item == NULL || hash == 0) {
+        return false;
+    }
+
+    // make room before probing, so the probe below can insert directly
+    if ((ht->count + 1) * MAX_LOAD_DEN > (ht->mask + 1) * MAX_LOAD_NUM) {
+        if (ht->old != NULL) {
+            migrate(ht, ht->oldmask + 1);
+        }
+        if (!grow(ht)) {
+            return false;
+        }
+    }
+
+    // a key that has not been migrated yet still lives in the old array
+    if (ht->old != NULL && table_find(ht->old, ht->oldmask, hash, key) != NULL) {
+        return false;
+    }
+
+    // one probe: walk until we find the key or a slot it may claim
+    htentry_t* slots = ht->slots;
+    unsigned long mask = ht->mask;
+    unsigned long pos = hash & mask;
+    unsigned long dist = 0;
+    for (; ; dist++, pos = (pos + 1) & mask) {
+        htentry_t* slot = &slots[pos];
+        if (slot->hash == 0) {
+            break;
+        }
+        if (slot->hash == hash && strcmp(slot->key, key) == 0) {
+            return false;
+        }
+        // Robin Hood invariant: the key cannot be further along
+        if (((pos - slot->hash) & mask) < dist) {
+            break;
+        }
+    }
+
+    // the key is absent; copy it and place the new entry where the
+    // probe stopped, at pos, dist slots from home
+    char* key_copy;
+    if (ht->arena != NULL) {
+        key_copy = arena_strdup(ht->arena, key);
+    }
+    else if ((key_copy = mem_malloc_tagged(strlen(key) + 1, MEM_HASHTABLE)) != NULL) {
+        strcpy(key_copy, key);
+    }
+    if (key_copy == NULL) {
+        return false;
+    }
+
+    htentry_t entry = { .hash = hash, .key = key_copy, .item = item };
+    table_place(slots, mask, entry, pos, dist);
+    ht->count++;
 
-        // insert key-item pair into appropriate slot
-        // set_insert handles the key copying 
-        return set_insert(ht->slots[hash], key, item);
+    // pay down some of any pending migration
+    if (ht->old != NULL) {
+        migrate(ht, MIGRATE_STEP);
     }
-    return false;
+    return true;
 }
 
 /**************** hashtable_find ****************/
@@ -88,32 +204,112 @@ hashtable_insert(hashtable_t* ht, const char* key, void* item)
 void*
 hashtable_find(hashtable_t* ht, const char* key)
 {
-    if (ht != NULL && key != NULL) {
-        // hash the key to find the slot
-        unsigned long hash = hash_jenkins(key, ht->num_slots);
+    if (key == NULL) {
+        return NULL;
+    }
+    return hashtable_findHashed(ht, key, hash_key(key));
+}
 
-        // find the item in the appropriate slot
-        return set_find(ht->slots[hash], key);
+/**************** hashtable_findHashed ****************/
+/* see hashtable.h for description */
+void*
+hashtable_findHashed(hashtable_t* ht, const char* key, const unsigned long hash)
+{
+    if (ht != NULL && key != NULL && hash != 0) {
+        htentry_t* entry = table_find(ht->slots, ht->mask, hash, key);
+        if (entry == NULL && ht->old != NULL) {
+            // not yet migrated; the old array is never modified in place
+            entry = table_find(ht->old, ht->oldmask, hash, key);
+        }
+        if (entry != NULL) {
+            return entry->item;
+        }
     }
     return NULL;
 }
 
+/**************** hashtable_hash ****************/
+/* see hashtable.h for description */
+unsigned long
+hashtable_hash(const char* key)
+{
+    return (key == NULL) ? 1 : hash_key(key);
+}
+
+/**************** hashtable_size ****************/
+/* see hashtable.h for description */
+int
+hashtable_size(hashtable_t* ht)
+{
+    return (ht == NULL) ? 0 : (int)ht->count;
+}
+
+/**************** hashtable_reserve ****************/
+/* see hashtable.h for description */
+bool
+hashtable_reserve(hashtable_t* ht, const int num_items)
+{
+    if (ht == NULL || num_items < 0) {
+        return false;
+    }
+
+    // smallest power of two that holds num_items below the load limit
+    unsigned long capacity = ht->mask + 1;
+    while ((unsigned long)num_items * MAX_LOAD_DEN > capacity * MAX_LOAD_NUM) {
+        capacity <<= 1;
+    }
+    if (capacity == ht->mask + 1) {
+        return true;    // already big enough
+    }
+
+    htentry_t* slots = mem_calloc_tagged(capacity, sizeof(htentry_t), MEM_HASHTABLE);
+    if (slots == NULL) {
+        return false;
+    }
+    // rehash everything now; reserving is done up front, before the
+    // table is busy, so there is no point spreading the work out
+    if (ht->old != NULL) {
+        migrate(ht, ht->oldmask + 1);
+    }
+    for (unsigned long i = 0; i <= ht->mask; i++) {
+        if (ht->slots[i].hash != 0) {
+            table_place(slots, capacity - 1, ht->slots[i],
+                        ht->slots[i].hash & (capacity - 1), 0);
+        }
+    }
+    mem_free(ht->slots);
+    ht->slots = slots;
+    ht->mask = capacity - 1;
+    return true;
+}
+
 /**************** hashtable_print ****************/
 /* see hashtable.h for description */
 void
-hashtable_print(hashtable_t* ht, FILE* fp, 
+hashtable_print(hashtable_t* ht, FILE* fp,
     void (*itemprint)(FILE* fp, const char* key, void* item))
 {
     if (fp != NULL) {
         if (ht != NULL) {
-            // loops over slots
-            for (int i = 0; i < ht->num_slots; i++) {
-                // print each set
-                if (itemprint != NULL) {
-                    fprintf(fp, "Slot %d: ", i);
-                    set_print(ht->slots[i], fp, itemprint);
+            // loops over slots, printing each as a set of zero or one
+            // pairs; without itemprint, just the slot lines
+            for (unsigned long i = 0; i <= ht->mask; i++) {
+                fprintf(fp, "Slot %lu: {", i);
+                if (ht->slots[i].hash != 0 && itemprint != NULL) {
+                    (*itemprint)(fp, ht->slots[i].key, ht->slots[i].item);
+                }
+                fputs("}\n", fp);
+            }
+            // then the slots of the old array not yet migrated, as they
+            // are; printing moves nothing
+            if (ht->old != NULL) {
+                for (unsigned long i = ht->migrated; i <= ht->oldmask; i++) {
+                    fprintf(fp, "Old slot %lu: {", i);
+                    if (ht->old[i].hash != 0 && itemprint != NULL) {
+                        (*itemprint)(fp, ht->old[i].key, ht->old[i].item);
+                    }
+                    fputs("}\n", fp);
                 }
-                
             }
         }
         else {
@@ -129,9 +325,19 @@ hashtable_iterate(hashtable_t* ht, void* arg,
     void (*itemfunc)(void* arg, const char* key, void* item) )
 {
     if (ht != NULL && itemfunc != NULL) {
-        // iterate over each set
-        for (int i = 0; i < ht->num_slots; i++) {
-            set_iterate(ht->slots[i], arg, itemfunc);
+        // iterate over the current array
+        for (unsigned long i = 0; i <= ht->mask; i++) {
+            if (ht->slots[i].hash != 0) {
+                (*itemfunc)(arg, ht->slots[i].key, ht->slots[i].item);
+            }
+        }
+        // and over whatever has not been migrated out of the old one
+        if (ht->old != NULL) {
+            for (unsigned long i = ht->migrated; i <= ht->oldmask; i++) {
+                if (ht->old[i].hash != 0) {
+                    (*itemfunc)(arg, ht->old[i].key, ht->old[i].item);
+                }
+            }
         }
     }
 }
@@ -142,14 +348,137 @@ void
 hashtable_delete(hashtable_t* ht, void (*itemdelete)(void* item) )
 {
     if (ht != NULL) {
-        // delete each set
-        for (int i = 0; i < ht->num_slots; i++) {
-            if (itemdelete != NULL) {
-                set_delete(ht->slots[i], itemdelete);
+        // delete each entry in the current array
+        for (unsigned long i = 0; i <= ht->mask; i++) {
+            if (ht->slots[i].hash != 0) {
+                if (itemdelete != NULL) {
+                    (*itemdelete)(ht->slots[i].item);
+                }
+                if (ht->arena == NULL) {
+                    mem_free(ht->slots[i].key);
+                }
+            }
+        }
+        // and any left behind in the old array
+        if (ht->old != NULL) {
+            for (unsigned long i = ht->migrated; i <= ht->oldmask; i++) {
+                if (ht->old[i].hash != 0) {
+                    if (itemdelete != NULL) {
+                        (*itemdelete)(ht->old[i].item);
+                    }
+                    if (ht->arena == NULL) {
+                        mem_free(ht->old[i].key);
+                    }
+                }
             }
+            mem_free(ht->old);
         }
         // free slots and hashtable
-        free(ht->slots);
-        free(ht);
+        mem_free(ht->slots);
+        mem_free(ht);
+    }
+}
+
+/**************** hash_key ****************/
+/* Hash a key to a full-width value that is never 0,
+ * since 0 marks an empty slot.
+ */
+static unsigned long
+hash_key(const char* key)
+{
+    unsigned long hash = (unsigned long)fasthash_string(key);
+    return (hash == 0) ? 1 : hash;
+}
+
+/**************** table_find ****************/
+/* Look for key in one slot array; return its entry or NULL. */
+static htentry_t*
+table_find(htentry_t* slots, unsigned long mask,
+           unsigned long hash, const char* key)
+{
+    unsigned long pos = hash & mask;
+    for (unsigned long dist = 0; ; dist++, pos = (pos + 1) & mask) {
+        htentry_t* slot = &slots[pos];
+        if (slot->hash == 0 || ((pos - slot->hash) & mask) < dist) {
+            return NULL;
+        }
+        // compare stored hashes before touching the key string
+        if (slot->hash == hash && strcmp(slot->key, key) == 0) {
+            return slot;
+        }
+    }
+}
+
+/**************** table_place ****************/
+/* Place an entry known to be absent, displacing entries that
+ * are closer to their home slot than the one being carried; the
+ * walk starts at pos, dist slots from the entry's home, where a
+ * probe for it stopped, or at its home with dist 0.
+ */
+static void
+table_place(htentry_t* slots, unsigned long mask, htentry_t entry,
+            unsigned long pos, unsigned long dist)
+{
+    for (; ; dist++, pos = (pos + 1) & mask) {
+        htentry_t* slot = &slots[pos];
+        if (slot->hash == 0) {
+            *slot = entry;
+            return;
+        }
+        unsigned long slotdist = (pos - slot->hash) & mask;
+        if (slotdist < dist) {
+            // swap, and keep going with the displaced entry
+            htentry_t displaced = *slot;
+            *slot = entry;
+            entry = displaced;
+            dist = slotdist;
+        }
     }
-}
\ No newline at end of file
+}
+
+/**************** migrate ****************/
+/* Move up to nslots slots of the old array into the current one,
+ * and release the old array once it has been fully drained.
+ */
+static void
+migrate(hashtable_t* ht, unsigned long nslots)
+{
+    unsigned long end = ht->migrated + nslots;
+    if (end > ht->oldmask + 1) {
+        end = ht->oldmask + 1;
+    }
+    for (unsigned long i = ht->migrated; i < end; i++) {
+        if (ht->old[i].hash != 0) {
+            table_place(ht->slots, ht->mask, ht->old[i], ht->old[i].hash & ht->mask, 0);
+        }
+    }
+    ht->migrated = end;
+
+    if (ht->migrated > ht->oldmask) {
+        mem_free(ht->old);
+        ht->old = NULL;
+        ht->oldmask = 0;
+        ht->migrated = 0;
+    }
+}
+
+/**************** grow ****************/
+/* Start migrating to an array twice the current size.
+ * The new array is sized for every entry, including those that
+ * still sit in the old array, so it has room for all of them.
+ */
+static bool
+grow(hashtable_t* ht)
+{
+    unsigned long capacity = (ht->mask + 1) * 2;
+    htentry_t* slots = mem_calloc_tagged(capacity, sizeof(htentry_t), MEM_HASHTABLE);
+    if (slots == NULL) {
+        return false;
+    }
+    ht->old = ht->slots;
+    ht->oldmask = ht->mask;
+    ht->migrated = 0;
+    ht->slots = slots;
+    ht->mask = capacity - 1;
+    return true;
+}
@@ -13,6 +13,7 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include "arena.h"
 
 /**************** global types ****************/
 typedef struct hashtable hashtable_t;  // opaque to users of the module
@@ -23,16 +24,35 @@ typedef struct hashtable hashtable_t;  // opaque to users of the module
 /* Create a new (empty) hashtable.
  *
  * Caller provides:
- *   number of slots to be used for the hashtable (must be > 0).
+ *   initial number of slots for the hashtable (must be > 0).
  * We return:
  *   pointer to the new hashtable; return NULL if error.
  * We guarantee:
  *   hashtable is initialized empty.
+ * Notes:
+ *   the slot count is rounded up to a power of two, and the table grows
+ *   on its own as items are inserted, so num_slots is only a hint about
+ *   the expected number of items.
  * Caller is responsible for:
  *   later calling hashtable_delete.
  */
 hashtable_t* hashtable_new(const int num_slots);
 
+/**************** hashtable_newArena ****************/
+/* Create a new (empty) hashtable that copies its keys into an arena.
+ *
+ * Caller provides:
+ *   initial number of slots for the hashtable (must be > 0),
+ *   valid pointer to an arena.
+ * We return:
+ *   pointer to the new hashtable; return NULL if error.
+ * Notes:
+ *   the hashtable behaves exactly like one from hashtable_new, but the
+ *   key copies are packed into the arena and hashtable_delete does not
+ *   free them; they are reclaimed when the arena is deleted.
+ */
+hashtable_t* hashtable_newArena(const int num_slots, arena_t* arena);
+
 /**************** hashtable_insert ****************/
 /* Insert item, identified by key (string), into the given hashtable.
  *
@@ -62,6 +82,50 @@ bool hashtable_insert(hashtable_t* ht, const char* key, void* item);
  */
 void* hashtable_find(hashtable_t* ht, const char* key);
 
+/**************** hashtable_hash ****************/
+/* Return the hash the hashtable uses for key; never 0.
+ *
+ * Notes:
+ *   for callers that hash a key once and use it more than once, as
+ *   chashtable does to pick a stripe; see hashtable_insertHashed.
+ */
+unsigned long hashtable_hash(const char* key);
+
+/**************** hashtable_insertHashed, hashtable_findHashed ****************/
+/* Just like hashtable_insert and hashtable_find, given the key's hash,
+ * which must be what hashtable_hash(key) returns; they return
+ * false/NULL if it is 0.
+ */
+bool hashtable_insertHashed(hashtable_t* ht, const char* key, const unsigned long hash,
+                            void* item);
+void* hashtable_findHashed(hashtable_t* ht, const char* key, const unsigned long hash);
+
+/**************** hashtable_size ****************/
+/* Return the number of items in the hashtable.
+ *
+ * Caller provides:
+ *   valid pointer to hashtable.
+ * We return:
+ *   number of (key,item) pairs inserted so far; 0 if ht is NULL.
+ */
+int hashtable_size(hashtable_t* ht);
+
+/**************** hashtable_reserve ****************/
+/* Make room for a number of items, so the table need not grow
+ * while they are inserted.
+ *
+ * Caller provides:
+ *   valid pointer to hashtable, expected total number of items (>= 0).
+ * We return:
+ *   true if the table now has room for num_items;
+ *   false if ht is NULL, num_items < 0, or out of memory,
+ *   in which case the table is unchanged and still usable.
+ * Notes:
+ *   this rehashes every item already in the table, so it is best
+ *   called while the table is still empty.
+ */
+bool hashtable_reserve(hashtable_t* ht, const int num_items);
+
 /**************** hashtable_print ****************/
 /* Print the whole table; provide the output file and func to print each item.
  * 
@@ -73,7 +137,10 @@ void* hashtable_find(hashtable_t* ht, const char* key);
  *   nothing, if NULL fp.
  *   "(null)" if NULL ht.
  *   one line per hash slot, with no items, if NULL itemprint.
- *   otherwise, one line per hash slot, listing (key,item) pairs in that slot.
+ *   otherwise, one line per hash slot, listing the (key,item) pair
+ *   stored in that slot, if any; while the table is growing, then a
+ *   line per slot of the old array not yet moved ("Old slot").
+ *   Printing does not move any.
  * Note:
  *   the hashtable and its contents are not changed by this function,
  */
@@ -106,8 +173,9 @@ void hashtable_iterate(hashtable_t* ht, void* arg,
  *   valid pointer to function that handles one item (may be NULL).
  * We do:
  *   if hashtable==NULL, do nothing.
- *   otherwise, unless itemfunc==NULL, call the itemfunc on each item.
- *   free all the key strings, and the hashtable itself.
+ *   otherwise, unless itemdelete==NULL, call the itemdelete on each item.
+ *   free all the key strings (unless they live in an arena),
+ *   and the hashtable itself.
  * Notes:
  *   We free the strings that represent key for each item, because 
  *   this module allocated that memory in hashtable_insert.
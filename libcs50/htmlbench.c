@@ -0,0 +1,230 @@
+/*
+ * htmlbench.c - compare the html word scanners of webpage
+ *
+ * Reads the given files (pages saved by the crawler, or any html)
+ * and scans them for words with the original byte-at-a-time scanner
+ * (isalpha() and strchr(), as webpage_getNextWord was written) and
+ * with each scanner webpage_setScanner offers on this CPU, word by
+ * word (webpage_getNextSpan) and page by page (webpage_iterateWords).
+ * Reports the throughput of each in MB/s, and checks that each finds
+ * exactly the words the original does.
+ *
+ * Usage:
+ *   ./htmlbench file...
+ *   ./htmlbench -r rounds file...
+ *
+ * Jake Fleming, 12/06/24
+ */
+
+#define _POSIX_C_SOURCE 199309L     // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <time.h>
+#include "webpage.h"
+#include "file.h"
+
+/**************** local types ****************/
+// the words of all the pages, as a running checksum and count
+typedef struct tally {
+    unsigned long sum;
+    unsigned long count;
+} tally_t;
+
+/**************** function prototypes ****************/
+static bool originalSpan(const char* doc, int* pos, const char** word, int* len);
+static void tallySpan(tally_t* tally, const char* word, int len);
+static double now(void);
+static double benchOriginal(char** html, int n, int rounds, tally_t* tally);
+static void tallyItem(void* arg, const char* word, const int len);
+static double benchScanner(webpage_t** pages, int n, int rounds, bool iterate,
+                           tally_t* tally);
+
+/***************** main *****************/
+int
+main(int argc, char* argv[])
+{
+    int rounds = 20;
+    int arg = 1;
+    if (argc > 2 && strcmp(argv[1], "-r") == 0) {
+        rounds = atoi(argv[2]);
+        arg += 2;
+    }
+    if (arg >= argc || rounds < 1) {
+        fprintf(stderr, "Usage: ./htmlbench [-r rounds] file...\n");
+        return 1;
+    }
+
+    // read every file whole, as a page of its own
+    int n = argc - arg;
+    char** html = calloc(n, sizeof(char*));
+    webpage_t** pages = calloc(n, sizeof(webpage_t*));
+    if (html == NULL || pages == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 2;
+    }
+    size_t bytes = 0;
+    for (int i = 0; i < n; i++) {
+        FILE* fp = fopen(argv[arg + i], "r");
+        char* text = (fp == NULL) ? NULL : file_readFile(fp);
+        if (fp != NULL) {
+            fclose(fp);
+        }
+        if (text == NULL) {
+            fprintf(stderr, "Error: Could not read %s\n", argv[arg + i]);
+            return 2;
+        }
+        char* url = malloc(strlen(argv[arg + i]) + 1);
+        if (url == NULL) {
+            fprintf(stderr, "Error: out of memory\n");
+            return 2;
+        }
+        strcpy(url, argv[arg + i]);
+        pages[i] = webpage_new(url, 0, text);
+        html[i] = webpage_getHTML(pages[i]);
+        bytes += strlen(text);
+    }
+    printf("%d files, %zu bytes, %d rounds\n", n, bytes, rounds);
+
+    // the original first, as the words and speed to match
+    tally_t expected = { 0, 0 };
+    double seconds = benchOriginal(html, n, rounds, &expected);
+    printf("%-16s %8.1f MB/s  %lu words\n", "original",
+           bytes * (double)rounds / seconds / 1e6, expected.count / rounds);
+
+    int status = 0;
+    const char* names[] = { "scalar", "sse2", "avx2" };
+    for (int s = 0; s < 3; s++) {
+        if (webpage_setScanner(names[s]) == NULL) {
+            printf("%-16s (not available)\n", names[s]);
+            continue;
+        }
+        for (int iterate = 0; iterate <= 1; iterate++) {
+            tally_t tally = { 0, 0 };
+            double t = benchScanner(pages, n, rounds, iterate, &tally);
+            bool same = tally.sum == expected.sum && tally.count == expected.count;
+            char label[32];
+            snprintf(label, sizeof(label), "%s %s", names[s],
+                     iterate ? "iterate" : "span");
+            printf("%-16s %8.1f MB/s  %lu words  %.2fx%s\n", label,
+                   bytes * (double)rounds / t / 1e6, tally.count / rounds,
+                   seconds / t, same ? "" : "  DIFFERENT WORDS");
+            if (!same) {
+                status = 3;
+            }
+        }
+    }
+    webpage_setScanner("best");
+
+    for (int i = 0; i < n; i++) {
+        webpage_delete(pages[i]);
+    }
+    free(pages);
+    free(html);
+    return status;
+}
+
+/***************** originalSpan *****************/
+/* the scanner as it was before webpage_getNextSpan, without the copy */
+static bool
+originalSpan(const char* doc, int* pos, const char** word, int* len)
+{
+    while (doc[*pos] != '\0' && !isalpha(doc[*pos])) {
+        if (doc[*pos] == '<') {
+            const char* end = strchr(&doc[*pos], '>');
+            if (end == NULL || *(++end) == '\0') {
+                return false;
+            }
+            *pos = end - doc;
+        }
+        else {
+            (*pos)++;
+        }
+    }
+    if (doc[*pos] == '\0') {
+        return false;
+    }
+    *word = &doc[*pos];
+    while (doc[*pos] != '\0' && isalpha(doc[*pos])) {
+        (*pos)++;
+    }
+    *len = &doc[*pos] - *word;
+    return true;
+}
+
+/***************** tallySpan *****************/
+/* fold where a word is and how long into the tally, so a scanner that
+ * finds different words, or the same words elsewhere, tallies
+ * differently; cheap, so the bench times the scanner and not this */
+static void
+tallySpan(tally_t* tally, const char* word, int len)
+{
+    tally->sum = (tally->sum * 31 + (unsigned long)(uintptr_t)word) * 31
+                 + (unsigned long)len;
+    tally->count++;
+}
+
+/***************** now *****************/
+/* monotonic time in seconds */
+static double
+now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/***************** benchOriginal *****************/
+/* scan every page rounds times with the original scanner */
+static double
+benchOriginal(char** html, int n, int rounds, tally_t* tally)
+{
+    double start = now();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < n; i++) {
+            int pos = 0;
+            const char* word;
+            int len;
+            while (originalSpan(html[i], &pos, &word, &len)) {
+                tallySpan(tally, word, len);
+            }
+        }
+    }
+    return now() - start;
+}
+
+/***************** tallyItem *****************/
+/* webpage_iterateWords helper: tally one word */
+static void
+tallyItem(void* arg, const char* word, const int len)
+{
+    tallySpan(arg, word, len);
+}
+
+/***************** benchScanner *****************/
+/* scan every page rounds times with the current scanner, through
+ * webpage_iterateWords or else webpage_getNextSpan */
+static double
+benchScanner(webpage_t** pages, int n, int rounds, bool iterate, tally_t* tally)
+{
+    double start = now();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < n; i++) {
+            if (iterate) {
+                webpage_iterateWords(pages[i], tally, tallyItem);
+                continue;
+            }
+            int pos = 0;
+            const char* word;
+            int len;
+            while (webpage_getNextSpan(pages[i], &pos, &word, &len)) {
+                tallySpan(tally, word, len);
+            }
+        }
+    }
+    return now() - start;
+}
@@ -0,0 +1,308 @@
+/*
+ * htmltest.c - test that the html word scanners of webpage agree
+ *
+ * Scans pages with each scanner webpage_setScanner offers on this
+ * CPU, word by word (webpage_getNextSpan) and page by page
+ * (webpage_iterateWords), and checks that each finds exactly the
+ * words the scalar scanner finds, at exactly the same places.  The
+ * pages are the given files, if any, and pages made up here to put
+ * '<' and '>' on either side of every 16-, 32- and 64-byte boundary
+ * the vector scanners cross, and to leave tags unterminated.
+ *
+ * Usage:
+ *   ./htmltest [file...]
+ *
+ * Exits 0 if every scanner agrees on every page, 3 if not.
+ *
+ * Jake Fleming, 12/09/24
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "webpage.h"
+#include "file.h"
+
+/**************** local types ****************/
+// the words of a page, as where each starts and how long it is
+typedef struct words {
+    const char* html;       // the page's html, where starts count from
+    int* start;
+    int* len;
+    int count;
+    int size;
+} words_t;
+
+// the pages to scan
+typedef struct pages {
+    webpage_t** list;
+    int count;
+    int size;
+} pages_t;
+
+/**************** function prototypes ****************/
+static bool addPage(pages_t* pages, const char* html, const char* name);
+static bool makePages(pages_t* pages);
+static void addWord(void* arg, const char* word, const int len);
+static bool scanPage(webpage_t* page, bool iterate, words_t* words);
+static bool sameWords(const words_t* a, const words_t* b);
+
+// the html all made-up pages start from: words and spaces, no tags
+static const char FILLER[] =
+    "ab cde fghij kl mnopq rs tuv wxyz AB CDE FGHIJ KL MNOPQ RS TUV WXYZ "
+    "alpha beta gamma delta epsilon zeta eta theta iota kappa lambda mu "
+    "nu xi omicron pi rho sigma tau upsilon phi chi psi omega";
+
+/***************** main *****************/
+int
+main(int argc, char* argv[])
+{
+    pages_t pages = { NULL, 0, 0 };
+    if (!makePages(&pages)) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 2;
+    }
+    int made = pages.count;
+    for (int i = 1; i < argc; i++) {
+        FILE* fp = fopen(argv[i], "r");
+        char* text = (fp == NULL) ? NULL : file_readFile(fp);
+        if (fp != NULL) {
+            fclose(fp);
+        }
+        if (text == NULL) {
+            fprintf(stderr, "Error: Could not read %s\n", argv[i]);
+            return 2;
+        }
+        bool added = addPage(&pages, text, argv[i]);
+        free(text);
+        if (!added) {
+            fprintf(stderr, "Error: out of memory\n");
+            return 2;
+        }
+    }
+    printf("%d made-up pages and %d files\n", made, pages.count - made);
+
+    // the scalar scanner's words are the ones to match
+    words_t* expected = calloc(pages.count, sizeof(words_t));
+    words_t found = { NULL, NULL, NULL, 0, 0 };
+    if (expected == NULL || webpage_setScanner("scalar") == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 2;
+    }
+    for (int i = 0; i < pages.count; i++) {
+        if (!scanPage(pages.list[i], false, &expected[i])) {
+            fprintf(stderr, "Error: out of memory\n");
+            return 2;
+        }
+    }
+
+    int status = 0;
+    const char* names[] = { "scalar", "sse2", "avx2" };
+    for (int s = 0; s < 3; s++) {
+        if (webpage_setScanner(names[s]) == NULL) {
+            printf("SKIP: %s is not available on this CPU\n", names[s]);
+            continue;
+        }
+        for (int iterate = 0; iterate <= 1; iterate++) {
+            int differ = 0;
+            for (int i = 0; i < pages.count; i++) {
+                if (!scanPage(pages.list[i], iterate, &found)) {
+                    fprintf(stderr, "Error: out of memory\n");
+                    return 2;
+                }
+                if (!sameWords(&expected[i], &found)) {
+                    if (differ++ == 0) {
+                        printf("%s %s finds different words in %s\n", names[s],
+                               iterate ? "iterate" : "span",
+                               webpage_getURL(pages.list[i]));
+                    }
+                }
+            }
+            if (differ > 0) {
+                printf("FAIL: %s %s differs from scalar span on %d pages\n",
+                       names[s], iterate ? "iterate" : "span", differ);
+                status = 3;
+            }
+            else {
+                printf("PASS: %s %s finds the same words as scalar span\n",
+                       names[s], iterate ? "iterate" : "span");
+            }
+        }
+    }
+    webpage_setScanner("best");
+
+    for (int i = 0; i < pages.count; i++) {
+        free(expected[i].start);
+        free(expected[i].len);
+        webpage_delete(pages.list[i]);
+    }
+    free(expected);
+    free(found.start);
+    free(found.len);
+    free(pages.list);
+    return status;
+}
+
+/***************** addPage *****************/
+/* add a page with a copy of html, named name, to pages */
+static bool
+addPage(pages_t* pages, const char* html, const char* name)
+{
+    if (pages->count == pages->size) {
+        int size = (pages->size == 0) ? 256 : 2 * pages->size;
+        webpage_t** list = realloc(pages->list, size * sizeof(webpage_t*));
+        if (list == NULL) {
+            return false;
+        }
+        pages->list = list;
+        pages->size = size;
+    }
+    char* url = malloc(strlen(name) + 1);
+    char* copy = malloc(strlen(html) + 1);
+    webpage_t* page = NULL;
+    if (url != NULL && copy != NULL) {
+        strcpy(url, name);
+        strcpy(copy, html);
+        page = webpage_new(url, 0, copy);
+    }
+    if (page == NULL) {
+        free(url);
+        free(copy);
+        return false;
+    }
+    pages->list[pages->count++] = page;
+    return true;
+}
+
+/***************** makePages *****************/
+/* add the made-up pages: a '<' at every position up to 130, with its
+ * '>' on either side of the next 16-, 32-, 64- and 128-byte
+ * boundaries, next to it, or nowhere; a lone '>' at every position;
+ * and the filler cut at every length, bare and with an unterminated
+ * tag at its end */
+static bool
+makePages(pages_t* pages)
+{
+    const int length = 160;
+    const int ends[] = { 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 128, 129 };
+    const int numEnds = sizeof(ends) / sizeof(ends[0]);
+    char html[sizeof(FILLER)];
+    char name[64];
+
+    for (int open = 0; open <= 130; open++) {
+        for (int e = -2; e < numEnds; e++) {
+            // e -2: no '>'; e -1: '>' just after '<'; else at ends[e]
+            int close = (e == -2) ? -1 : (e == -1) ? open + 1 : ends[e];
+            if (e >= 0 && close <= open) {
+                continue;
+            }
+            memcpy(html, FILLER, length);
+            html[length] = '\0';
+            html[open] = '<';
+            if (close >= 0) {
+                html[close] = '>';
+            }
+            snprintf(name, sizeof(name), "made-up page '<' at %d, '>' at %d", open, close);
+            if (!addPage(pages, html, name)) {
+                return false;
+            }
+        }
+        memcpy(html, FILLER, length);
+        html[length] = '\0';
+        html[open] = '>';
+        snprintf(name, sizeof(name), "made-up page lone '>' at %d", open);
+        if (!addPage(pages, html, name)) {
+            return false;
+        }
+    }
+
+    for (int cut = 0; cut < (int)sizeof(FILLER); cut++) {
+        memcpy(html, FILLER, cut);
+        html[cut] = '\0';
+        snprintf(name, sizeof(name), "made-up page of %d bytes", cut);
+        if (!addPage(pages, html, name)) {
+            return false;
+        }
+        if (cut > 0) {
+            html[cut - 1] = '<';
+            snprintf(name, sizeof(name), "made-up page of %d bytes, '<' last", cut);
+            if (!addPage(pages, html, name)) {
+                return false;
+            }
+        }
+        if (cut > 8) {
+            memcpy(html + cut - 8, "<a href", 7);
+            snprintf(name, sizeof(name), "made-up page of %d bytes, open tag last", cut);
+            if (!addPage(pages, html, name)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/***************** addWord *****************/
+/* webpage_iterateWords helper: add one word to a words_t; on running
+ * out of memory, mark it with size -1 */
+static void
+addWord(void* arg, const char* word, const int len)
+{
+    words_t* words = arg;
+    if (words->size < 0) {
+        return;
+    }
+    if (words->count == words->size) {
+        int size = (words->size == 0) ? 64 : 2 * words->size;
+        int* start = realloc(words->start, size * sizeof(int));
+        if (start != NULL) {
+            words->start = start;
+        }
+        int* lens = realloc(words->len, size * sizeof(int));
+        if (lens != NULL) {
+            words->len = lens;
+        }
+        if (start == NULL || lens == NULL) {
+            words->size = -1;
+            return;
+        }
+        words->size = size;
+    }
+    words->start[words->count] = word - words->html;
+    words->len[words->count] = len;
+    words->count++;
+}
+
+/***************** scanPage *****************/
+/* find the words of a page with the current scanner, through
+ * webpage_iterateWords or else webpage_getNextSpan; false if out of
+ * memory */
+static bool
+scanPage(webpage_t* page, bool iterate, words_t* words)
+{
+    words->html = webpage_getHTML(page);
+    words->count = 0;
+    if (iterate) {
+        webpage_iterateWords(page, words, addWord);
+    }
+    else {
+        int pos = 0;
+        const char* word;
+        int len;
+        while (webpage_getNextSpan(page, &pos, &word, &len)) {
+            addWord(words, word, len);
+        }
+    }
+    return words->size >= 0;
+}
+
+/***************** sameWords *****************/
+/* true if both found the same words at the same places */
+static bool
+sameWords(const words_t* a, const words_t* b)
+{
+    return a->count == b->count
+           && (a->count == 0
+               || (memcmp(a->start, b->start, a->count * sizeof(int)) == 0
+                   && memcmp(a->len, b->len, a->count * sizeof(int)) == 0));
+}
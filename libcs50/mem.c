@@ -8,19 +8,54 @@
  * 2. Variants that 'assert' the result is non-NULL;
  *    if NULL occurs, kick out an error and die.
  *
+ * 3. Byte accounting, overall and per tag.  Every allocation carries
+ *    a small header recording its size and tag, so mem_free knows
+ *    what to give back.
+ *
  * David Kotz, April 2016, 2017, 2019, 2021
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdatomic.h>
 #include "mem.h"
 
+/**************** local types ****************/
+// sits just before every block we hand out; padded so the
+// caller's memory keeps malloc's alignment
+typedef union memheader {
+  struct {
+    size_t size;              // bytes requested by the caller
+    mem_tag_t tag;            // who the bytes are charged to
+  } info;
+  max_align_t align;
+} memheader_t;
+
+// bytes in use and their high-water mark
+typedef struct memaccount {
+  atomic_long bytes;
+  atomic_long peak;
+} memaccount_t;
+
 /**************** file-local global variables ****************/
 // track malloc and free across *all* calls within this program.
-static int nmalloc = 0;         // number of successful malloc calls
-static int nfree = 0;           // number of free calls
-static int nfreenull = 0;       // number of free(NULL) calls
+static atomic_int nmalloc = 0;        // number of successful malloc calls
+static atomic_int nfree = 0;          // number of free calls
+static atomic_int nfreenull = 0;      // number of free(NULL) calls
+
+static memaccount_t total;            // all bytes
+static memaccount_t tags[MEM_NTAGS];  // bytes per tag
 
+static const char* tagnames[MEM_NTAGS] = {
+  "untagged", "index keys", "postings", "index", "counters",
+  "hashtable", "webpage html", "frontier",
+};
+
+/**************** local functions ****************/
+static void charge(memaccount_t* account, const long bytes);
+static void* tagged_alloc(const size_t size, const mem_tag_t tag, const int zero);
+static void report_at_exit(void);
 
 /**************** mem_assert ****************/
 /* see mem.h for description */
@@ -51,12 +86,11 @@ mem_assert_const(const void* ptr, const char* message)
 void*
 mem_malloc_assert(const size_t size, const char* message)
 {
-  void* ptr = malloc(size);
+  void* ptr = tagged_alloc(size, MEM_UNTAGGED, 0);
   if (ptr == NULL) {
     fprintf(stderr, "Out of memory: %s\n", message);
     exit (99);
   }
-  nmalloc++;
   return ptr;
 }
 
@@ -66,11 +100,7 @@ mem_malloc_assert(const size_t size, const char* message)
 void*
 mem_malloc(const size_t size)
 {
-  void* ptr = malloc(size);
-  if (ptr != NULL) {
-    nmalloc++;
-  }
-  return ptr;
+  return tagged_alloc(size, MEM_UNTAGGED, 0);
 }
 
 /**************** mem_calloc_assert() ****************/
@@ -78,9 +108,7 @@ mem_malloc(const size_t size)
 void*
 mem_calloc_assert(const size_t nmemb, const size_t size, const char* message)
 {
-  void* ptr = mem_assert(calloc(nmemb, size), message);
-  nmalloc++;
-  return ptr;
+  return mem_assert(mem_calloc(nmemb, size), message);
 }
 
 /**************** mem_calloc() ****************/
@@ -88,11 +116,49 @@ mem_calloc_assert(const size_t nmemb, const size_t size, const char* message)
 void*
 mem_calloc(const size_t nmemb, const size_t size)
 {
-  void* ptr = calloc(nmemb, size);
-  if (ptr != NULL) {
-    nmalloc++;
+  return mem_calloc_tagged(nmemb, size, MEM_UNTAGGED);
+}
+
+/**************** mem_malloc_tagged() ****************/
+/* see mem.h for description */
+void*
+mem_malloc_tagged(const size_t size, const mem_tag_t tag)
+{
+  return tagged_alloc(size, tag, 0);
+}
+
+/**************** mem_calloc_tagged() ****************/
+/* see mem.h for description */
+void*
+mem_calloc_tagged(const size_t nmemb, const size_t size, const mem_tag_t tag)
+{
+  if (size != 0 && nmemb > ((size_t)-1 - sizeof(memheader_t)) / size) {
+    return NULL;    // nmemb*size would overflow
   }
-  return ptr;
+  return tagged_alloc(nmemb * size, tag, 1);
+}
+
+/**************** mem_realloc_tagged() ****************/
+/* see mem.h for description */
+void*
+mem_realloc_tagged(void* ptr, const size_t size, const mem_tag_t tag)
+{
+  if (ptr == NULL) {
+    return tagged_alloc(size, tag, 0);
+  }
+  memheader_t* header = (memheader_t*)ptr - 1;
+  size_t oldsize = header->info.size;
+  mem_tag_t oldtag = header->info.tag;
+
+  header = realloc(header, sizeof(memheader_t) + size);
+  if (header == NULL) {
+    return NULL;
+  }
+  header->info.size = size;
+  long delta = (long)size - (long)oldsize;
+  charge(&total, delta);
+  charge(&tags[oldtag], delta);
+  return header + 1;
 }
 
 /**************** mem_free() ****************/
@@ -101,7 +167,10 @@ void
 mem_free(void* ptr)
 {
   if (ptr != NULL) {
-    free(ptr);
+    memheader_t* header = (memheader_t*)ptr - 1;
+    charge(&total, -(long)header->info.size);
+    charge(&tags[header->info.tag], -(long)header->info.size);
+    free(header);
     nfree++;
   } else {
     // it's an error to call free(NULL)!
@@ -109,6 +178,17 @@ mem_free(void* ptr)
   }
 }
 
+/**************** mem_account() ****************/
+/* see mem.h for description */
+void
+mem_account(const mem_tag_t tag, const long bytes)
+{
+  if (tag >= 0 && tag < MEM_NTAGS) {
+    charge(&total, bytes);
+    charge(&tags[tag], bytes);
+  }
+}
+
 /**************** mem_report() ****************/
 /* see mem.h for description */
 void 
@@ -116,6 +196,26 @@ mem_report(FILE* fp, const char* message)
 {
   fprintf(fp, "%s: %d malloc, %d free, %d free(NULL), %d net\n", 
           message, nmalloc, nfree, nfreenull, nmalloc - nfree - nfreenull);
+  fprintf(fp, "  %-13s %12ld bytes in use, %12ld peak\n", "all",
+          atomic_load(&total.bytes), atomic_load(&total.peak));
+  for (int t = 0; t < MEM_NTAGS; t++) {
+    long peak = atomic_load(&tags[t].peak);
+    if (peak > 0) {
+      fprintf(fp, "  %-13s %12ld bytes in use, %12ld peak\n", tagnames[t],
+              atomic_load(&tags[t].bytes), peak);
+    }
+  }
+}
+
+/**************** mem_reportAtExit() ****************/
+/* see mem.h for description */
+void
+mem_reportAtExit(void)
+{
+  const char* env = getenv("TSE_MEMREPORT");
+  if (env != NULL && *env != '\0') {
+    atexit(report_at_exit);
+  }
 }
 
 /**************** mem_net() ****************/
@@ -125,3 +225,61 @@ mem_net(void)
 {
   return nmalloc - nfree - nfreenull;
 }
+
+/**************** mem_bytes() ****************/
+/* see mem.h for description */
+long
+mem_bytes(const mem_tag_t tag, long* peak)
+{
+  memaccount_t* account = (tag >= 0 && tag < MEM_NTAGS) ? &tags[tag] : &total;
+  if (peak != NULL) {
+    *peak = atomic_load(&account->peak);
+  }
+  return atomic_load(&account->bytes);
+}
+
+/**************** charge ****************/
+/* add bytes to an account, raising its high-water mark if need be */
+static void
+charge(memaccount_t* account, const long bytes)
+{
+  long now = atomic_fetch_add_explicit(&account->bytes, bytes,
+                                       memory_order_relaxed) + bytes;
+  long peak = atomic_load_explicit(&account->peak, memory_order_relaxed);
+  while (now > peak
+         && !atomic_compare_exchange_weak_explicit(&account->peak, &peak, now,
+                                                   memory_order_relaxed,
+                                                   memory_order_relaxed)) {
+    // peak was reloaded by the failed exchange; try again
+  }
+}
+
+/**************** tagged_alloc ****************/
+/* allocate size bytes behind a header, and charge them to tag */
+static void*
+tagged_alloc(const size_t size, const mem_tag_t tag, const int zero)
+{
+  if (size > (size_t)-1 - sizeof(memheader_t)) {
+    return NULL;
+  }
+  memheader_t* header = zero ? calloc(1, sizeof(memheader_t) + size)
+                             : malloc(sizeof(memheader_t) + size);
+  if (header == NULL) {
+    return NULL;
+  }
+  mem_tag_t t = (tag >= 0 && tag < MEM_NTAGS) ? tag : MEM_UNTAGGED;
+  header->info.size = size;
+  header->info.tag = t;
+  charge(&total, (long)size);
+  charge(&tags[t], (long)size);
+  nmalloc++;
+  return header + 1;
+}
+
+/**************** report_at_exit ****************/
+/* atexit handler installed by mem_reportAtExit */
+static void
+report_at_exit(void)
+{
+  mem_report(stderr, "memory at exit");
+}
@@ -14,6 +14,13 @@
  *    that needs to defensively check function parameters that
  *    "should never be NULL".
  *
+ * 4. Byte accounting: how many bytes are allocated right now, the
+ *    high-water mark, and the same two numbers for each 'tag', so a
+ *    report can show which structure is using the memory.  All the
+ *    counts are atomic, so any thread may allocate and free.
+ *    Setting the environment variable TSE_MEMREPORT and calling
+ *    mem_reportAtExit() prints a report to stderr when the program exits.
+ *
  * David Kotz, April 2016, 2017, 2019, 2021
  */
 
@@ -23,6 +30,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+/**************** mem_tag_t ****************/
+/* What an allocation is for; reports break down memory by tag. */
+typedef enum mem_tag {
+  MEM_UNTAGGED,       // anything not covered below
+  MEM_INDEXKEYS,      // the words of an index
+  MEM_POSTINGS,       // the (docID, count) lists of an index
+  MEM_INDEX,          // the rest of an index: per-document arrays, scratch
+  MEM_COUNTERS,       // other counters, like query results
+  MEM_HASHTABLE,      // hashtable slot arrays and key copies
+  MEM_HTML,           // webpage html
+  MEM_FRONTIER,       // pages waiting to be crawled
+  MEM_NTAGS           // number of tags; not itself a tag
+} mem_tag_t;
+
 /**************** mem_assert **************************/
 /* If pointer p is NULL, print error message to stderr and die,
  * otherwise, return p unchanged.  Works nicely as a pass-through:
@@ -85,23 +106,71 @@ void* mem_calloc_assert(const size_t nmemb, const size_t size,
  */
 void* mem_calloc(const size_t nmemb, const size_t size);
 
+/**************** mem_malloc_tagged() ****************/
+/* Just like mem_malloc(), but charge the bytes to the given tag.
+ */
+void* mem_malloc_tagged(const size_t size, const mem_tag_t tag);
+
+/**************** mem_calloc_tagged() ****************/
+/* Just like mem_calloc(), but charge the bytes to the given tag.
+ */
+void* mem_calloc_tagged(const size_t nmemb, const size_t size,
+                        const mem_tag_t tag);
+
+/**************** mem_realloc_tagged() ****************/
+/* Just like realloc(), with the bookkeeping of mem_malloc().
+ * Caller provides:
+ *   pointer produced by a mem_ allocation function, or NULL,
+ *   the new size, and the tag to use if ptr is NULL.
+ * We return
+ *   pointer to resized space, or NULL if failure (ptr is then untouched).
+ * Note:
+ *   space keeps the tag it was first allocated with.
+ */
+void* mem_realloc_tagged(void* ptr, const size_t size, const mem_tag_t tag);
+
 /**************** mem_free() ****************/
 /* Just like free() but track the number of calls.
  * We assume:
- *   caller provides pointer to space produced by mem_malloc or mem_calloc.
+ *   caller provides pointer to space produced by a mem_ allocation
+ *   function (never one from plain malloc, which we could not account for).
  * We track the number of calls - see mem_net().
  */
 void mem_free(void* ptr);
 
+/**************** mem_account() ****************/
+/* Charge (or, with negative bytes, credit) a tag for memory allocated
+ * outside this module, such as a buffer from file_readFile that is
+ * later released with plain free().
+ */
+void mem_account(const mem_tag_t tag, const long bytes);
+
 /**************** mem_report() ****************/
 /* Print a report of the current malloc/free counts.
  * We assume:
  *   caller provides a FILE open for writing, and message suitable for printf.
  * We format and print a report to that FILE, indicating the number of calls
- * to mem_malloc/calloc and of calls to mem_free, and the net difference.
+ * to mem_malloc/calloc and of calls to mem_free, and the net difference;
+ * then the bytes in use and their high-water mark, overall and for
+ * every tag that has been used.
  */
 void mem_report(FILE* fp, const char* message);
 
+/**************** mem_reportAtExit() ****************/
+/* If the environment variable TSE_MEMREPORT is set (to anything
+ * but the empty string), arrange for mem_report to print to stderr
+ * when the program exits.  Call once, early in main.
+ */
+void mem_reportAtExit(void);
+
+/**************** mem_bytes() ****************/
+/* Return the number of bytes currently allocated through this module
+ * (and charged with mem_account), and store the high-water mark in
+ * *peak unless peak is NULL.  Pass MEM_NTAGS for the overall numbers,
+ * or a tag for just that tag.
+ */
+long mem_bytes(const mem_tag_t tag, long* peak);
+
 /**************** mem_net() ****************/
 /* Return the current net malloc-free counts.
  * We assume:
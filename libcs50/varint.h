@@ -0,0 +1,115 @@
+/*
+ * varint.h - variable-length and fixed-width integer encoding
+ *
+ * A varint stores an unsigned integer seven bits per byte, low bits
+ * first; every byte but the last has its high bit set.  Small numbers,
+ * such as the gaps between sorted docIDs, take a single byte.
+ *
+ * Where a reader needs to jump straight to the i-th number, as in a
+ * table of offsets, numbers are instead stored in 4 or 8 bytes,
+ * little-endian, whatever the byte order of the machine.
+ *
+ * The functions are inline, since they sit in the innermost loops
+ * of whoever encodes or decodes with them.
+ *
+ * Jake Fleming, 11/20/24
+ */
+
+#ifndef __VARINT_H
+#define __VARINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**************** constants ****************/
+#define VARINT_MAX 10       // bytes in the longest 64-bit varint
+
+/**************** varint_put ****************/
+/* Encode value into out, which must have room for VARINT_MAX bytes.
+ *
+ * We return:
+ *   the number of bytes written (1..VARINT_MAX).
+ */
+static inline size_t
+varint_put(unsigned char* out, uint64_t value)
+{
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (unsigned char)value;
+    return n;
+}
+
+/**************** varint_get ****************/
+/* Decode one varint from the bytes at p, reading no further than end.
+ *
+ * Caller provides:
+ *   start and end of the encoded bytes, where to store the value.
+ * We return:
+ *   pointer to the byte after the varint;
+ *   NULL if the varint runs past end or is longer than VARINT_MAX,
+ *   in which case *value is unchanged.
+ */
+static inline const unsigned char*
+varint_get(const unsigned char* p, const unsigned char* end, uint64_t* value)
+{
+    // the one-byte case covers most docID gaps and counts
+    if (p < end && *p < 0x80) {
+        *value = *p;
+        return p + 1;
+    }
+    uint64_t result = 0;
+    for (int shift = 0; p < end && shift < 7 * VARINT_MAX; shift += 7) {
+        unsigned char byte = *p++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            *value = result;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/**************** le32_put, le64_put ****************/
+/* Store value in the 4 (or 8) bytes at out, little-endian. */
+static inline void
+le32_put(unsigned char* out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++) {
+        out[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static inline void
+le64_put(unsigned char* out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++) {
+        out[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+/**************** le32_get, le64_get ****************/
+/* Return the number stored by le32_put (or le64_put) at bytes. */
+static inline uint32_t
+le32_get(const unsigned char* bytes)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= (uint32_t)bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+static inline uint64_t
+le64_get(const unsigned char* bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= (uint64_t)bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+#endif // __VARINT_H
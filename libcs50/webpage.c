@@ -20,11 +20,18 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <netdb.h>
 #include "file.h"
 #include "webpage.h"
 #include "mem.h"
 
+// the html scanner has SSE2 and AVX2 kernels on x86 with gcc or clang
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define WEBPAGE_SIMD
+#include <immintrin.h>
+#endif
+
 /* ***************************************** */
 /* Private types */
 struct URL {
@@ -36,6 +43,23 @@ struct URL {
   char* fragment;             // #top
 };
 
+// one 64-byte block of html, classified: bit i is set in a mask
+// if byte i of the block is of that class
+typedef struct htmlmasks {
+  uint64_t alpha;     // A-Z or a-z
+  uint64_t open;      // '<'
+  uint64_t close;     // '>'
+  uint64_t end;       // '\0', and any bytes past the end of the html
+} htmlmasks_t;
+
+// the block of a page's html that webpage_getNextSpan classified last,
+// which the next call, a word or so further on, most likely needs again
+typedef struct htmlblock {
+  size_t base;        // where the block starts, a multiple of 64
+  int scanner;        // the scanner that classified it, or 0 if none has
+  htmlmasks_t masks;
+} htmlblock_t;
+
 /* webpage_t: structure to represent a web page, and its contents.
  * The innards should not be visible to users of the webpage module.
  */
@@ -44,6 +68,7 @@ typedef struct webpage {
   char* html;                              // html code of the page
   size_t html_len;                         // length of html code
   int depth;                               // depth of crawl
+  htmlblock_t spanBlock;                   // see htmlblock_t
 } webpage_t;
 
 /* *********************************************************************** */
@@ -58,6 +83,17 @@ static bool parseURL(const char* str, struct URL* url);
 static void freeURL(struct URL url);
 static bool burstURL(const char* url, char** hostname, 
                      int* port, char** pathname);
+static int bestScanner(void);
+static inline int currentScanner(void);
+static bool nextSpanScalar(const char* doc, int* pos, const char** word, int* len);
+#ifdef WEBPAGE_SIMD
+static inline size_t scanSpans(const char* doc, const size_t len, const size_t pos,
+                        const int scanner, htmlblock_t* last, void* arg,
+                        void (*itemfunc)(void* arg, const char* word, const int len));
+static void captureSpan(void* arg, const char* word, const int len);
+static void classifySSE2(const unsigned char* block, htmlmasks_t* masks);
+static void classifyAVX2(const unsigned char* block, htmlmasks_t* masks);
+#endif
 #ifdef DEBUG
 static void printURL(struct URL url);
 #endif // DEBUG
@@ -65,6 +101,10 @@ static void printURL(struct URL url);
 /* *********************************************************************** */
 /* Private global variables */
 
+static const char* SCANNERS[] = { "scalar", "sse2", "avx2" };
+static int scannerChoice = -1;   // index in SCANNERS, -1 for the best one
+static int scannerBest = 0;      // index in SCANNERS of the fastest here
+
 static const int MAX_TRY = 3;    // maximum attempts to fetch
 static const int HTTP_PORT = 80; // default web server port
 
@@ -107,6 +147,8 @@ webpage_new(char* url, const int depth, char* html)
   page->depth = depth;
   page->html = html;
   page->html_len = html ? strlen(html) : 0;
+  page->spanBlock.scanner = 0;
+  mem_account(MEM_HTML, page->html_len);
 
   return page;
 }
@@ -120,6 +162,7 @@ webpage_delete(void* data)
   if (page != NULL) {
     if (page->url) free(page->url);
     if (page->html) free(page->html);
+    mem_account(MEM_HTML, -(long)page->html_len);
     free(page);
   }
 }
@@ -208,9 +251,13 @@ webpage_fetch(webpage_t* page)
         free(line); // the blank line
 
         // then grab everything else - that should be the page content
-        char* html = file_readFile(http_fp);
+        size_t html_len;
+        char* html = file_readFileLen(http_fp, &html_len);
         if (html != NULL) {
           page->html = html;
+          page->html_len = html_len;
+          page->spanBlock.scanner = 0;
+          mem_account(MEM_HTML, html_len);
           success = true;
         } 
       }
@@ -224,75 +271,108 @@ webpage_fetch(webpage_t* page)
   return success;
 }
 
-/**************** webpage_getNextWord ****************/
+/**************** webpage_getNextSpan ****************/
 /* see webpage.h for usage documentation.
  *
- * Code is courtesy of Ray Jenkins and/or Charles Palmer, 
- *   cleaned by David Kotz in April 2016, 2017; updated April 2019.
- *
- * Pseudocode:
- *     1. skip any leading non-alphabetic characters
- *     2. if we find a tag, i.e., <...tag...>, skip that tag
- *     3. save beginning of the word
- *     4. find the end, i.e., first non-alphabetic character
- *     5. create a new word buffer
- *     6. copy the word into the new buffer
- *     7. update *pos to first position past end of word
- *     8. return pointer to the word
- * 
- * Assumptions:
- *     1. webpage has html
- *     2. don't care about opening/closing tags: ignore anything between <...>
- *     3. if the html is malformed, we don't care: match '<' with next '>'
+ * The scalar scanner is the original, a byte at a time (see
+ * nextSpanScalar); the others classify the html 64 bytes at a time
+ * and find the word with bit operations (see scanSpans).  The page
+ * keeps the block classified last, so a run of calls classifies each
+ * block once, not once per word.
  */
-char* 
-webpage_getNextWord(webpage_t* page, int* pos)
+bool
+webpage_getNextSpan(webpage_t* page, int* pos, const char** word, int* len)
 {
   // make sure we have something to search, and a place for the result
-  if (page == NULL || page->html == NULL || pos == NULL) {
-    return NULL;
+  if (page == NULL || page->html == NULL || pos == NULL
+      || word == NULL || len == NULL) {
+    return false;
   }
 
-  const char* doc = page->html;            // the html document
-  const char* beg;                         // beginning of word
-  const char* end;                         // end of word
-
-  // consume any non-alphabetic characters
-  while (doc[*pos] != '\0' && !isalpha(doc[*pos])) {
-    // if we find a tag, i.e., <...tag...>, skip it
-    if (doc[*pos] == '<') {
-      end = strchr(&doc[*pos], '>');          // find the close
-      
-      if (end == NULL || *(++end) == '\0') { // ran out of html
-        return NULL;
-      }
-
-      *pos = end - doc;       // skip over the <...tag...>
-    } else {
-      (*pos)++;               // just move forward
+#ifdef WEBPAGE_SIMD
+  int scanner = currentScanner();
+  if (scanner > 0) {
+    const char* span[2] = { NULL, NULL };     // where the word starts and ends
+    size_t end = scanSpans(page->html, page->html_len, *pos, scanner,
+                           &page->spanBlock, span, captureSpan);
+    *pos = end;
+    if (span[0] == NULL) {
+      return false;
     }
+    *word = span[0];
+    *len = span[1] - span[0];
+    return true;
   }
+#endif
+  return nextSpanScalar(page->html, pos, word, len);
+}
 
-  // ran out of html
-  if (doc[*pos] == '\0') {
-    return NULL;
+/**************** webpage_iterateWords ****************/
+/* see webpage.h for usage documentation. */
+void
+webpage_iterateWords(webpage_t* page, void* arg,
+                     void (*itemfunc)(void* arg, const char* word, const int len))
+{
+  if (page == NULL || page->html == NULL || itemfunc == NULL) {
+    return;
   }
 
-  // doc[*pos] is the first character of a word
-  beg = &(doc[*pos]);
-
-  // consume word
-  while (doc[*pos] != '\0' && isalpha(doc[*pos])) {
-    (*pos)++;
+#ifdef WEBPAGE_SIMD
+  int scanner = currentScanner();
+  if (scanner > 0) {
+    scanSpans(page->html, page->html_len, 0, scanner, NULL, arg, itemfunc);
+    return;
+  }
+#endif
+  int pos = 0;
+  const char* word;
+  int len;
+  while (nextSpanScalar(page->html, &pos, &word, &len)) {
+    (*itemfunc)(arg, word, len);
   }
+}
 
-  // at this point, doc[*pos] is the first character *after* the word.
-  // so doc[*pos-1] is the last character of the word.
-  end = &(doc[*pos-1]);
+/**************** webpage_setScanner ****************/
+/* see webpage.h for usage documentation. */
+const char*
+webpage_setScanner(const char* name)
+{
+  if (name != NULL) {
+    if (strcmp(name, "best") == 0) {
+      scannerChoice = -1;
+    } else {
+      int found = -1;
+      for (int s = 0; s <= bestScanner(); s++) {
+        if (strcmp(name, SCANNERS[s]) == 0) {
+          found = s;
+        }
+      }
+      if (found < 0) {
+        return NULL;          // unknown, or not on this CPU
+      }
+      scannerChoice = found;
+    }
+  }
+  return SCANNERS[currentScanner()];
+}
 
-  // 'beg' points to first character of the word
-  // 'end' points to last character of the word
-  int wordlen = end - beg + 1;
+/**************** webpage_getNextWord ****************/
+/* see webpage.h for usage documentation.
+ *
+ * Pseudocode:
+ *     1. find the next word with webpage_getNextSpan
+ *     2. create a new word buffer
+ *     3. copy the word into the new buffer
+ *     4. return pointer to the word
+ */
+char* 
+webpage_getNextWord(webpage_t* page, int* pos)
+{
+  const char* beg;
+  int wordlen;
+  if (!webpage_getNextSpan(page, pos, &beg, &wordlen)) {
+    return NULL;
+  }
 
   // allocate space for length of new word + '\0'
   char* word = calloc(wordlen + 1, sizeof(char));
@@ -1154,3 +1234,269 @@ isBlankLine(const char* line)
              || (strcmp(line, "\r") == 0) 
              || (strcmp(line, "\r\n") == 0));
 }
+
+/**************** bestScanner ****************/
+/* The index in SCANNERS of the fastest scanner this CPU can run. */
+static int
+bestScanner(void)
+{
+  return scannerBest;
+}
+
+#ifdef WEBPAGE_SIMD
+/**************** findBestScanner ****************/
+/* Ask the CPU, once, as the program loads, which scanner is best;
+ * asking on every word costs more than the scanning saves.
+ */
+__attribute__((constructor))
+static void
+findBestScanner(void)
+{
+  __builtin_cpu_init();
+  scannerBest = __builtin_cpu_supports("avx2") ? 2 : 1;
+}
+#endif
+
+/**************** currentScanner ****************/
+/* The index in SCANNERS of the scanner to use now. */
+static inline int
+currentScanner(void)
+{
+  return (scannerChoice >= 0) ? scannerChoice : bestScanner();
+}
+
+/**************** nextSpanScalar ****************/
+/* The word scanner, a byte at a time, as webpage_getNextSpan is
+ * documented.
+ *
+ * Code is courtesy of Ray Jenkins and/or Charles Palmer, 
+ *   cleaned by David Kotz in April 2016, 2017; updated April 2019.
+ *
+ * Pseudocode:
+ *     1. skip any leading non-alphabetic characters
+ *     2. if we find a tag, i.e., <...tag...>, skip that tag
+ *     3. save beginning of the word
+ *     4. find the end, i.e., first non-alphabetic character
+ *     5. update *pos to first position past end of word
+ *     6. return the beginning and length of the word
+ * 
+ * Assumptions:
+ *     1. webpage has html
+ *     2. don't care about opening/closing tags: ignore anything between <...>
+ *     3. if the html is malformed, we don't care: match '<' with next '>'
+ */
+static bool
+nextSpanScalar(const char* doc, int* pos, const char** word, int* len)
+{
+  const char* beg;                         // beginning of word
+  const char* end;                         // end of word
+
+  // consume any non-alphabetic characters
+  while (doc[*pos] != '\0' && !isalpha(doc[*pos])) {
+    // if we find a tag, i.e., <...tag...>, skip it
+    if (doc[*pos] == '<') {
+      end = strchr(&doc[*pos], '>');          // find the close
+      
+      if (end == NULL || *(++end) == '\0') { // ran out of html
+        return false;
+      }
+
+      *pos = end - doc;       // skip over the <...tag...>
+    } else {
+      (*pos)++;               // just move forward
+    }
+  }
+
+  // ran out of html
+  if (doc[*pos] == '\0') {
+    return false;
+  }
+
+  // doc[*pos] is the first character of a word
+  beg = &(doc[*pos]);
+
+  // consume word
+  while (doc[*pos] != '\0' && isalpha(doc[*pos])) {
+    (*pos)++;
+  }
+
+  // at this point, doc[*pos] is the first character *after* the word
+  *word = beg;
+  *len = &(doc[*pos]) - beg;
+  return true;
+}
+
+#ifdef WEBPAGE_SIMD
+
+/**************** scanSpans ****************/
+/* Find the words of doc from pos on, as nextSpanScalar does, and
+ * call itemfunc on each; given last, stop after the first, and keep
+ * the block classified last there.  Return the position just past the
+ * last word, or where the html ran out.
+ *
+ * The html is classified 64 bytes at a time, in blocks that start at
+ * multiples of 64, into bitmasks (see htmlmasks_t), and a state
+ * machine walks them with count-trailing-zeros instead of looking at
+ * bytes: outside a word the next set bit of alpha|open|end says
+ * whether a word or a tag starts or the html ends; in a word, the
+ * next clear bit of alpha ends it; in a tag, the next bit of
+ * close|end ends it.  Words and tags may cross blocks.  The last,
+ * partial block is copied into a buffer of zeros, which read as '\0',
+ * so no load goes past the end of the html.
+ *
+ * Always inlined, so that webpage_getNextSpan, which finds one short
+ * word a call, calls captureSpan directly, not through a pointer.
+ *
+ * A letter is A-Z or a-z, which is what isalpha() says in the "C"
+ * locale, the only one our programs run in.
+ */
+static inline __attribute__((always_inline)) size_t
+scanSpans(const char* doc, const size_t len, const size_t pos, const int scanner,
+          htmlblock_t* last, void* arg,
+          void (*itemfunc)(void* arg, const char* word, const int len))
+{
+  enum { OUTSIDE, INWORD, INTAG } state = OUTSIDE;
+  size_t start = pos;                      // where the current word starts
+  unsigned char tail[64];
+  unsigned int p = pos % 64;               // the bit to walk the block from
+
+  for (size_t base = pos - p; ; base += 64, p = 0) {
+    htmlmasks_t classified;
+    const htmlmasks_t* m = &classified;
+    if (last != NULL && last->scanner == scanner && last->base == base) {
+      m = &last->masks;
+    } else {
+      const unsigned char* block = (const unsigned char*)doc + base;
+      if (base + 64 > len) {
+        memset(tail, 0, sizeof(tail));
+        if (base < len) {
+          memcpy(tail, block, len - base);
+        }
+        block = tail;
+      }
+      if (scanner == 2) {
+        classifyAVX2(block, &classified);
+      } else {
+        classifySSE2(block, &classified);
+      }
+      if (last != NULL) {
+        last->base = base;
+        last->scanner = scanner;
+        last->masks = classified;
+      }
+    }
+
+    // walk this block from bit p
+    while (p < 64) {
+      if (state == OUTSIDE) {
+        uint64_t hits = (m->alpha | m->open | m->end) & (~0ULL << p);
+        if (hits == 0) {
+          break;
+        }
+        p = __builtin_ctzll(hits);
+        if ((m->end >> p) & 1) {
+          return base + p;                 // ran out of html
+        }
+        if ((m->open >> p) & 1) {
+          state = INTAG;
+          p++;
+          continue;
+        }
+        state = INWORD;                    // and look for its end at once
+        start = base + p;
+      }
+      if (state == INWORD) {
+        uint64_t hits = ~m->alpha & (~0ULL << p);
+        if (hits == 0) {
+          break;
+        }
+        p = __builtin_ctzll(hits);
+        (*itemfunc)(arg, doc + start, (int)(base + p - start));
+        if (last != NULL) {
+          return base + p;
+        }
+        state = OUTSIDE;                   // look at this byte again
+      } else {
+        uint64_t hits = (m->close | m->end) & (~0ULL << p);
+        if (hits == 0) {
+          break;
+        }
+        p = __builtin_ctzll(hits);
+        if ((m->end >> p) & 1) {
+          return base + p;                 // no close: ran out of html
+        }
+        state = OUTSIDE;
+        p++;
+      }
+    }
+  }
+}
+
+/**************** captureSpan ****************/
+/* scanSpans helper for webpage_getNextSpan: note the one word found */
+static void
+captureSpan(void* arg, const char* word, const int len)
+{
+  const char** span = arg;
+  span[0] = word;
+  span[1] = word + len;
+}
+
+/**************** classifySSE2 ****************/
+/* Classify a 64-byte block, 16 bytes at a time.  Letters are the
+ * bytes that land in a-z once the 0x20 bit is set; bytes over 0x7f
+ * compare as negative, so they are never letters.
+ */
+static void
+classifySSE2(const unsigned char* block, htmlmasks_t* masks)
+{
+  const __m128i lowerBit = _mm_set1_epi8(0x20);
+  const __m128i beforeA = _mm_set1_epi8('a' - 1);
+  const __m128i afterZ = _mm_set1_epi8('z' + 1);
+  const __m128i open = _mm_set1_epi8('<');
+  const __m128i close = _mm_set1_epi8('>');
+  const __m128i zero = _mm_setzero_si128();
+
+  masks->alpha = masks->open = masks->close = masks->end = 0;
+  for (int i = 0; i < 64; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(block + i));
+    __m128i lower = _mm_or_si128(v, lowerBit);
+    __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, beforeA),
+                                  _mm_cmplt_epi8(lower, afterZ));
+    masks->alpha |= (uint64_t)(uint16_t)_mm_movemask_epi8(alpha) << i;
+    masks->open |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, open)) << i;
+    masks->close |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, close)) << i;
+    masks->end |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) << i;
+  }
+}
+
+/**************** classifyAVX2 ****************/
+/* Classify a 64-byte block, 32 bytes at a time, as classifySSE2
+ * does; only called when the CPU has AVX2, so only this function is
+ * compiled for it.
+ */
+__attribute__((target("avx2")))
+static void
+classifyAVX2(const unsigned char* block, htmlmasks_t* masks)
+{
+  const __m256i lowerBit = _mm256_set1_epi8(0x20);
+  const __m256i beforeA = _mm256_set1_epi8('a' - 1);
+  const __m256i afterZ = _mm256_set1_epi8('z' + 1);
+  const __m256i open = _mm256_set1_epi8('<');
+  const __m256i close = _mm256_set1_epi8('>');
+  const __m256i zero = _mm256_setzero_si256();
+
+  masks->alpha = masks->open = masks->close = masks->end = 0;
+  for (int i = 0; i < 64; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(block + i));
+    __m256i lower = _mm256_or_si256(v, lowerBit);
+    __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, beforeA),
+                                     _mm256_cmpgt_epi8(afterZ, lower));
+    masks->alpha |= (uint64_t)(uint32_t)_mm256_movemask_epi8(alpha) << i;
+    masks->open |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, open)) << i;
+    masks->close |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, close)) << i;
+    masks->end |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero)) << i;
+  }
+}
+
+#endif // WEBPAGE_SIMD
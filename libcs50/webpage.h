@@ -107,6 +107,78 @@ void webpage_delete(void* data);
 bool webpage_fetch(webpage_t* page);
 
 
+/**************** webpage_getNextSpan ***********************************/
+/* find the next word from page->html[pos], without copying it
+ *
+ * Caller provides
+ *   page: pointer to valid webpage_t with page->html not NULL.
+ *   pos: pointer to an int representing current position in html buffer;
+ *        should be 0 on the initial call.
+ *        After return, *pos is the index after the word found.
+ *   word, len: where to put the word's start and length.
+ *
+ * We return:
+ *   true if there is another word, and *word points to its first
+ *   letter in page->html, which is not NUL-terminated after the
+ *   word; false if there are no more words.
+ *
+ * We do:
+ *   find words exactly as webpage_getNextWord does, allocating nothing.
+ *   The span is good until the page's html is changed or deleted.
+ *   The page remembers the stretch of html it last looked at, so the
+ *   next call goes faster; the html must not change between calls.
+ *
+ * Usage example: (print all words in a page)
+ * int pos = 0;
+ * const char* word;
+ * int len;
+ *
+ * while (webpage_getNextSpan(page, &pos, &word, &len)) {
+ *     printf("Found word: %.*s\n", len, word);
+ * }
+ */
+bool webpage_getNextSpan(webpage_t* page, int* pos, const char** word, int* len);
+
+/**************** webpage_iterateWords ***********************************/
+/* call itemfunc on every word of page->html, in order, without copying
+ *
+ * Caller provides:
+ *   page: pointer to valid webpage_t with page->html not NULL.
+ *   arg: passed through to itemfunc.
+ *   itemfunc: called with arg, the word's first letter in page->html
+ *             (not NUL-terminated after the word), and its length.
+ *
+ * We do:
+ *   find the same words as webpage_getNextSpan, in one pass over the
+ *   html; faster than calling webpage_getNextSpan word by word.
+ *   Nothing, if page or html or itemfunc is NULL.
+ *
+ * Notes:
+ *   itemfunc should not change the page's html.
+ */
+void webpage_iterateWords(webpage_t* page, void* arg,
+                          void (*itemfunc)(void* arg, const char* word, const int len));
+
+/**************** webpage_setScanner ***********************************/
+/* choose how webpage_getNextSpan, webpage_iterateWords, and
+ * webpage_getNextWord scan html for words and tags
+ *
+ * Caller provides:
+ *   name: "scalar" (a byte at a time), "sse2" or "avx2" (64 bytes at
+ *         a time, classified with 16- or 32-byte vectors), or "best",
+ *         the default, for the fastest this CPU has; or NULL to change
+ *         nothing.
+ *
+ * We return:
+ *   the name of the scanner now in use; NULL, changing nothing, if
+ *   name is unknown or this CPU or build lacks it.
+ *
+ * Notes:
+ *   every scanner finds the same words; this is for benchmarks and
+ *   tests, and should be called before any threads are scanning.
+ */
+const char* webpage_setScanner(const char* name);
+
 /**************** webpage_getNextWord ***********************************/
 /* return the next word from page->html[pos]
  *
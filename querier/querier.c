@@ -15,37 +15,42 @@
 #include <stdbool.h>
 #include "../common/index.h"
 #include "../common/pagedir.h"
+#include "../common/segments.h"
 #include "../libcs50/file.h"
 #include "../libcs50/counters.h"
+#include "../libcs50/mem.h"
 
 /************ Structs *************/
 
-// hold two counters for intersect operation
-typedef struct counterDuo {
-    counters_t* srcCounter;
-    counters_t* destCounter;
-} counterDuo_t;
-
 // hold document ID and score for ranking
 typedef struct scorenode {
     int docID;
     int score;
 } scorenode_t;
 
+// hold the results being collected for ranking
+typedef struct scorelist {
+    scorenode_t* nodes;
+    int count;
+} scorelist_t;
+
 /************ Function Prototypes ************/
-static void processQuery(char* line, index_t* index, const char* pageDirectory);
+static void processQuery(char* line, index_t** indexes, int numIndexes, const char* pageDirectory);
 static bool parseQuery(char* line, char** words, int* wordCount);
 static counters_t* processOrSequence(char** words, int start, int end, index_t* index);
 static counters_t* processAndSequence(char** words, int start, int end, index_t* index);
-static void counters_intersect(void* arg, const int key, int count);
 static void counters_union(void* arg, const int key, int count);
 static void printResults(counters_t* results, const char* pageDirectory);
 static bool validateSyntax(char** words, int wordCount);
-static void find_max_score_helper(void* arg, const int key, const int count);
+static void collect_scores_helper(void* arg, const int key, const int count);
+static int compare_scores(const void* a, const void* b);
 
 /******************* main *******************/
 /* handle arguemnts and call necessary functions */
 int main(int argc, char* argv[]) {
+    // memory report at exit, if TSE_MEMREPORT is set
+    mem_reportAtExit();
+
     if (argc != 3) {
         fprintf(stderr, "Usage: ./querier pageDirectory indexFilename\n");
         return 1;
@@ -58,33 +63,55 @@ int main(int argc, char* argv[]) {
         return 2;
     }
 
-    // open index file
+    // a directory of segments is searched segment by segment; a binary
+    // index is mapped and searched in place, with nothing to load
     const char* indexFilename = argv[2];
-    FILE* indexFile = fopen(indexFilename, "r");
-    if (indexFile == NULL) {
-        fprintf(stderr, "Error: Could not open index file %s.\n", indexFilename);
-        return 3;
-    }
+    segments_t* segs = segments_open(indexFilename);
+    index_t* index = (segs == NULL) ? index_map(indexFilename) : NULL;
+    if (segs == NULL && index == NULL) {
+        // open index file
+        FILE* indexFile = fopen(indexFilename, "r");
+        if (indexFile == NULL) {
+            fprintf(stderr, "Error: Could not open index file %s.\n", indexFilename);
+            return 3;
+        }
 
-    // load index
-    index_t* index = index_new(file_numLines(indexFile));
-    if (index == NULL || !index_load(index, indexFile)) {
-        fprintf(stderr, "Error: Could not load index from file %s.\n", indexFilename);
+        // load index; the index file header tells index_load how big to
+        // make the table, so there is no need to count its lines first
+        index = index_new(500);
+        if (index == NULL || !index_load(index, indexFile)) {
+            fprintf(stderr, "Error: Could not load index from file %s.\n", indexFilename);
+            fclose(indexFile);
+            index_delete(index);
+            return 5;
+        }
         fclose(indexFile);
+    }
+
+    // the indexes to search: each segment, or the one index
+    int numIndexes = (segs == NULL) ? 1 : segments_count(segs);
+    index_t** indexes = malloc((numIndexes + 1) * sizeof(index_t*));
+    if (indexes == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        segments_close(segs);
         index_delete(index);
-        return 5;
+        return 6;
+    }
+    for (int i = 0; i < numIndexes; i++) {
+        indexes[i] = (segs == NULL) ? index : segments_index(segs, i);
     }
-    fclose(indexFile);
 
     // read and process queries
     char* line;
     printf("Query? ");
     while ((line = file_readLine(stdin)) != NULL) {
-        processQuery(line, index, pageDirectory);
+        processQuery(line, indexes, numIndexes, pageDirectory);
         printf("Query? ");
         free(line);
     }
 
+    free(indexes);
+    segments_close(segs);
     index_delete(index);
     return 0;
 }
@@ -147,7 +174,7 @@ static bool validateSyntax(char** words, int wordCount) {
 
 /*************** processQuery ***************/
 /* call necessary functions to handle query */
-static void processQuery(char* line, index_t* index, const char* pageDirectory) {
+static void processQuery(char* line, index_t** indexes, int numIndexes, const char* pageDirectory) {
     char* words[100];
     int wordCount;
 
@@ -159,7 +186,16 @@ static void processQuery(char* line, index_t* index, const char* pageDirectory)
 
     // process query with OR/AND logic
     // since AND takes presidence, call it within OR
-    counters_t* results = processOrSequence(words, 0, wordCount, index);
+    counters_t* results = (numIndexes == 1) ? processOrSequence(words, 0, wordCount, indexes[0])
+                                            : counters_new();
+
+    // segments hold different docIDs, so the query runs on each one
+    // alone, and the union of their results is the whole answer
+    for (int i = 0; i < numIndexes && numIndexes > 1; i++) {
+        counters_t* segmentResults = processOrSequence(words, 0, wordCount, indexes[i]);
+        counters_iterate(segmentResults, results, counters_union);
+        counters_delete(segmentResults);
+    }
 
     // nothing found 
     if (counters_size(results) == 0) {
@@ -201,52 +237,67 @@ static counters_t* processOrSequence(char** words, int start, int end, index_t*
 }
 
 /*************** processAndSequence ***************/
-/* makes intersections of counters where AND (or nothing) separates queries */
+/* makes intersections of postings where AND (or nothing) separates queries;
+ * a cursor walks the shortest postings, and the others skip ahead to each
+ * of its docIDs, so long postings are mostly skipped block by block */
 static counters_t* processAndSequence(char** words, int start, int end, index_t* index) {
-    // get the counter for the first word in query 
-    counters_t* firstWordCounts = index_find(index, words[start]);
-    // if no match, then entire intersection will be empty 
-    if (firstWordCounts == NULL) {
-        return counters_new();
+    int n = 0;
+    counters_t* result = counters_new();
+    postings_t* postings = malloc((end - start) * sizeof(postings_t));
+    postcursor_t* cursors = malloc((end - start) * sizeof(postcursor_t));
+    bool found = (result != NULL && postings != NULL && cursors != NULL);
+
+    // get the postings for every word but the "and"s between them;
+    // if any has no match, then entire intersection will be empty
+    for (int i = start; i < end && found; i++) {
+        if (strcmp(words[i], "and") == 0) {
+            continue;
+        }
+        found = index_postings(index, words[i], &postings[n]);
+        // keep the shortest postings first, to lead the walk
+        if (found && postings_size(&postings[n]) < postings_size(&postings[0])) {
+            postings_t shortest = postings[n];
+            postings[n] = postings[0];
+            postings[0] = shortest;
+        }
+        n++;
     }
 
-    // make pointer for result and copy firstWordCounts onto it 
-    counters_t* result = counters_new();
-    counters_iterate(firstWordCounts, result, counters_copy);
-
-    // loop over provided AND sequence 
-    for (int i = start + 1; i < end; i++) {
-        // same thing, return empty counter if we ever find an empty one
-        counters_t* wordCounts = index_find(index, words[i]);
-        if (wordCounts == NULL) {
-            counters_delete(result); 
-            return counters_new();
+    if (found && n > 0) {
+        for (int i = 0; i < n; i++) {
+            postings_cursor(&postings[i], &cursors[i]);
+        }
+        bool more = postcursor_next(&cursors[0]);
+        while (more) {
+            int docID = postcursor_docID(&cursors[0]);
+            int count = postcursor_count(&cursors[0]);
+            bool inAll = true;
+            for (int i = 1; i < n && more && inAll; i++) {
+                if (!postcursor_advance(&cursors[i], docID)) {
+                    more = false;       // no later docID can be in all of them
+                }
+                else if (postcursor_docID(&cursors[i]) > docID) {
+                    // skip the leader ahead to where this word is next found
+                    more = postcursor_advance(&cursors[0], postcursor_docID(&cursors[i]));
+                    inAll = false;
+                }
+                else if (postcursor_count(&cursors[i]) < count) {
+                    // keep the smaller of the counts
+                    count = postcursor_count(&cursors[i]);
+                }
+            }
+            if (more && inAll) {
+                counters_set(result, docID, count);
+                more = postcursor_next(&cursors[0]);
+            }
         }
-        // set up counterDuo for intersection
-        counterDuo_t duo = { .srcCounter = wordCounts, .destCounter = result };
-        counters_iterate(result, &duo, counters_intersect);
     }
 
+    free(postings);
+    free(cursors);
     return result;
 }
 
-/*************** counters_intersect *******************/
-/* helper for intersection operation in counters */
-static void counters_intersect(void* arg, const int key, int count) {
-    // initialize the struct and get the count of source
-    counterDuo_t* duo = arg;
-    int srcCount = counters_get(duo->srcCounter, key);
-
-    // use smaller of two counts with conditional expression
-    if (srcCount > 0) {
-        counters_set(duo->destCounter, key, (srcCount < count) ? srcCount : count);
-    }
-    // otherwise, remove
-    else {
-        counters_set(duo->destCounter, key, 0);
-    }
-}
-
 /*************** counters_union *******************/
 /* union operation for counters, used in OR sequences */
 static void counters_union(void* arg, const int key, const int count) {
@@ -256,36 +307,49 @@ static void counters_union(void* arg, const int key, const int count) {
     counters_set(dest_counters, key, current_count + count);
 }
 
-/*************** find_max_score_helper ***************/
-/* helper function to find the max score for printing results */
-void find_max_score_helper(void* arg, const int key, const int count) {
-    scorenode_t* max_node = arg;
-    if (count > max_node->score) {
-        max_node->score = count;
-        max_node->docID = key;
+/*************** collect_scores_helper ***************/
+/* helper function to gather every result for ranking */
+static void collect_scores_helper(void* arg, const int key, const int count) {
+    scorelist_t* list = arg;
+    list->nodes[list->count].docID = key;
+    list->nodes[list->count].score = count;
+    list->count++;
+}
+
+/*************** compare_scores ***************/
+/* order by decreasing score, breaking ties by decreasing docID, the
+ * order the querier has always printed them in */
+static int compare_scores(const void* a, const void* b) {
+    const scorenode_t* first = a;
+    const scorenode_t* second = b;
+    if (first->score != second->score) {
+        return (first->score < second->score) ? 1 : -1;
     }
+    return (second->docID > first->docID) - (second->docID < first->docID);
 }
 
 /*************** printResults ***************/
 /* display hits in order of relevance */
 static void printResults(counters_t* results, const char* pageDirectory) {
-    printf("Matches %d documents (ranked):\n", counters_size(results));
-
-    // loop through all word keys
-    while (counters_size(results) > 0) {
-        scorenode_t max_node = { .docID = 0, .score = 0 };
-        counters_iterate(results, &max_node, find_max_score_helper);
+    int size = counters_size(results);
+    printf("Matches %d documents (ranked):\n", size);
 
-        // no valid documents left
-        if (max_node.score == 0) break;  
+    // gather the hits and sort them once, rather than scanning for the max
+    scorelist_t list = { .nodes = malloc(size * sizeof(scorenode_t)), .count = 0 };
+    if (list.nodes == NULL) {
+        fprintf(stderr, "Error: out of memory ranking results.\n");
+        return;
+    }
+    counters_iterate(results, &list, collect_scores_helper);
+    qsort(list.nodes, list.count, sizeof(scorenode_t), compare_scores);
 
+    for (int i = 0; i < list.count; i++) {
         // get URL if there are any
-        char* url = getDocumentURL(pageDirectory, max_node.docID);
+        char* url = getDocumentURL(pageDirectory, list.nodes[i].docID);
         if (url != NULL) {
-            printf("score %d doc %d: %s\n", max_node.score, max_node.docID, url);
+            printf("score %d doc %d: %s\n", list.nodes[i].score, list.nodes[i].docID, url);
             free(url);  // free the URL retrieved from file
         }
-
-        counters_set(results, max_node.docID, 0); // remove
     }
+    free(list.nodes);
 }
\ No newline at end of file
@@ -8,6 +8,14 @@
 QUERIER="./querier"
 PAGE_DIR="$HOME/cs50-dev/shared/tse/output/toscrape-2"
 INDEX_FILE="$HOME/cs50-dev/shared/tse/output/toscrape-2.index"
+INDEXER="../indexer/indexer"
+INDEXTEST="../indexer/indextest"
+DOCDELETE="../indexer/docdelete"
+SEGMERGE="../indexer/segmerge"
+LOCAL_PAGE_DIR="test-pages"     # written by make_page below
+LOCAL_INDEX="test-pages.index"
+LOCAL_SEG_DIR="test-segments"
+LOCAL_HALF_DIR="test-pages-half"
 
 # check exit status command
 function test_command() {
@@ -19,8 +27,31 @@ function test_command() {
     fi
 }
 
+# write page $2 of pageDirectory $1: "the" in every page, and each other
+# word in every so many pages, from 1 to 3 times; so the queries below
+# have small, known answers, with tied scores, and need no crawl
+function make_page() {
+    local dir=$1 doc=$2 entry word every i
+    local words=(the:1 fifty:50 shades:75 tears:40 joy:60 romance:90 mystery:100
+                 love:30 hate:45 war:70 peace:35 happy:80 sad:85
+                 science:64 fiction:32 fantasy:96 horror:128)
+    local html="<html><head><title>page $doc</title></head><body>"
+    for entry in ${words[@]}; do
+        word=${entry%:*}
+        every=${entry#*:}
+        if (( doc % every == 0 )); then
+            for ((i = 0; i <= (doc / every + doc) % 3; i++)); do
+                html+=" $word"
+            done
+        fi
+    done
+    printf "http://cs50tse.cs.dartmouth.edu/tse/test/%d.html\n0\n%s</body></html>\n" \
+           $doc "$html" > $dir/$doc
+}
+
 # cleanup old tests
-rm -f test*.query test*.txt valgrind_*.out
+rm -f test*.query test*.txt test19.bin valgrind_*.out $LOCAL_INDEX
+rm -rf $LOCAL_PAGE_DIR $LOCAL_SEG_DIR $LOCAL_HALF_DIR
 
 echo "Running invalid argument tests 1-4..."
 test_command $QUERIER           # no arguments
@@ -29,6 +60,14 @@ test_command $QUERIER $PAGE_DIR $INDEX_FILE extra_arg # extra argument
 test_command $QUERIER "invalid_dir" $INDEX_FILE # invalid page directory
 echo
 
+# the queries run on a local pageDirectory of 400 pages and its index
+mkdir -p $LOCAL_PAGE_DIR
+touch $LOCAL_PAGE_DIR/.crawler
+for ((doc = 1; doc <= 400; doc++)); do
+    make_page $LOCAL_PAGE_DIR $doc
+done
+$INDEXER $LOCAL_PAGE_DIR $LOCAL_INDEX
+
 echo "Run the following tests:"
 echo
 echo "fifty shades"
@@ -63,59 +102,112 @@ echo "the" > test12.query                   # Common word
 
 echo "Running querier integration tests 5-16..."
 # execute querier with various queries
-$QUERIER $PAGE_DIR $INDEX_FILE < test1.query > test1.txt
-$QUERIER $PAGE_DIR $INDEX_FILE < test2.query > test2.txt
-$QUERIER $PAGE_DIR $INDEX_FILE < test3.query > test3.txt
-$QUERIER $PAGE_DIR $INDEX_FILE < test4.query > test4.txt
-$QUERIER $PAGE_DIR $INDEX_FILE < test5.query > test5.txt
+$QUERIER $LOCAL_PAGE_DIR $LOCAL_INDEX < test1.query > test1.txt
+$QUERIER $LOCAL_PAGE_DIR $LOCAL_INDEX < test2.query > test2.txt
+$QUERIER $LOCAL_PAGE_DIR $LOCAL_INDEX < test3.query > test3.txt
+$QUERIER $LOCAL_PAGE_DIR $LOCAL_INDEX < test4.query > test4.txt
+$QUERIER $LOCAL_PAGE_DIR $LOCAL_INDEX < test5.query > test5.txt
 
-$QUERIER $PAGE_DIR $INDEX_FILE < test6.query > test6.txt
+$QUERIER $LOCAL_PAGE_DIR $LOCAL_INDEX < test6.query > test6.txt
 echo "Expected invlid query"
 echo
-$QUERIER $PAGE_DIR $INDEX_FILE < test7.query > test7.txt
+$QUERIER $LOCAL_PAGE_DIR $LOCAL_INDEX < test7.query > test7.txt
 echo "Expected leading AND error"
 echo
-$QUERIER $PAGE_DIR $INDEX_FILE < test8.query > test8.txt
+$QUERIER $LOCAL_PAGE_DIR $LOCAL_INDEX < test8.query > test8.txt
 echo "Expected trailing OR error"
 echo
-$QUERIER $PAGE_DIR $INDEX_FILE < test9.query > test9.txt
+$QUERIER $LOCAL_PAGE_DIR $LOCAL_INDEX < test9.query > test9.txt
 echo "Expected consecutive error"
 echo
-$QUERIER $PAGE_DIR $INDEX_FILE < test10.query > test10.txt
+$QUERIER $LOCAL_PAGE_DIR $LOCAL_INDEX < test10.query > test10.txt
 echo "Expected consecutive error"
 echo
-$QUERIER $PAGE_DIR $INDEX_FILE < test11.query > test11.txt
-$QUERIER $PAGE_DIR $INDEX_FILE < test12.query > test12.txt
+$QUERIER $LOCAL_PAGE_DIR $LOCAL_INDEX < test11.query > test11.txt
+$QUERIER $LOCAL_PAGE_DIR $LOCAL_INDEX < test12.query > test12.txt
 echo
 
-# display a sample of the querier output for verification
-echo "Sample output from test1.txt (fifty shades):"
-head -n 10 test1.txt
+# display the querier output for verification; all of it but for "the"
+for i in 1 2 3 4 5 11; do
+    echo "Output from test$i.txt ($(cat test$i.query)):"
+    cat test$i.txt
+    echo
+    echo
+done
+echo "Sample output from test12.txt (the):"
+head -n 10 test12.txt
 echo
 
-echo "Sample output from test4.txt (love and hate or war and peace):"
-head -n 10 test4.txt
+if ! command -v valgrind > /dev/null; then
+    echo "Skipping valgrind tests: valgrind is not installed"
+else
+    echo "Running valgrind tests for memory leaks..."
+
+    # test querier with valgrind for memory leaks
+    valgrind --leak-check=full --show-leak-kinds=all $QUERIER $LOCAL_PAGE_DIR $LOCAL_INDEX < test1.query &> valgrind_querier1.out
+    if grep -q "no leaks are possible" valgrind_querier1.out; then
+        echo "PASS: No memory leaks in querier for 'test1.query'"
+    else
+        echo "FAIL: Memory leaks found in querier for 'test1.query'"
+    fi
+
+    valgrind --leak-check=full --show-leak-kinds=all $QUERIER $LOCAL_PAGE_DIR $LOCAL_INDEX < test4.query &> valgrind_querier2.out
+    if grep -q "no leaks are possible" valgrind_querier2.out; then
+        echo "PASS: No memory leaks in querier for 'test4.query'"
+    else
+        echo "FAIL: Memory leaks found in querier for 'test4.query'"
+    fi
+fi
 echo
 
-echo "Running valgrind tests for memory leaks..."
+echo "Test 17: deleted documents drop out of a segment directory's results"
+mkdir -p $LOCAL_HALF_DIR $LOCAL_SEG_DIR
+touch $LOCAL_HALF_DIR/.crawler
+cp $LOCAL_PAGE_DIR/{1..200} $LOCAL_HALF_DIR
+$INDEXER --incremental $LOCAL_HALF_DIR $LOCAL_SEG_DIR
+cp $LOCAL_PAGE_DIR/{201..400} $LOCAL_HALF_DIR
+$INDEXER --incremental $LOCAL_HALF_DIR $LOCAL_SEG_DIR
+$DOCDELETE $LOCAL_SEG_DIR 120 240
+echo "Expected only doc 360, without the deleted 120 and 240:"
+echo "tears and joy" | $QUERIER $LOCAL_PAGE_DIR $LOCAL_SEG_DIR
+echo
+$SEGMERGE -a $LOCAL_SEG_DIR
+echo "Expected the same after merging the segments:"
+echo "tears and joy" | $QUERIER $LOCAL_PAGE_DIR $LOCAL_SEG_DIR
+echo
 
-# test querier with valgrind for memory leaks
-valgrind --leak-check=full --show-leak-kinds=all $QUERIER $PAGE_DIR $INDEX_FILE < test1.query &> valgrind_querier1.out
-if grep -q "no leaks are possible" valgrind_querier1.out; then
-    echo "PASS: No memory leaks in querier for 'test1.query'"
+echo "Test 18: tied scores are printed by decreasing docID"
+echo "tears" | $QUERIER $LOCAL_PAGE_DIR $LOCAL_INDEX > test18.txt
+cat test18.txt
+if grep "^score" test18.txt | awk -F'[ :]' '$2 == score && $4 >= doc { bad = 1 }
+                                            { score = $2; doc = $4 } END { exit bad }'; then
+    echo "PASS: every run of tied scores is in decreasing docID order"
 else
-    echo "FAIL: Memory leaks found in querier for 'test1.query'"
+    echo "FAIL: a run of tied scores is not in decreasing docID order"
 fi
+echo
 
-valgrind --leak-check=full --show-leak-kinds=all $QUERIER $PAGE_DIR $INDEX_FILE < test4.query &> valgrind_querier2.out
-if grep -q "no leaks are possible" valgrind_querier2.out; then
-    echo "PASS: No memory leaks in querier for 'test4.query'"
+echo "Test 19: AND and OR the same on a text index and a mapped binary one"
+# "the" is on all 400 pages, 128 postings to an encoded block, so the
+# rare words AND'ed with it skip whole blocks of it in the binary index
+$INDEXTEST -b $LOCAL_INDEX test19.bin
+echo "the fifty shades" > test19.query
+echo "horror and the" >> test19.query
+echo "the and love and hate" >> test19.query
+echo "fifty or shades or horror" >> test19.query
+echo "the horror or love the war" >> test19.query
+$QUERIER $LOCAL_PAGE_DIR $LOCAL_INDEX < test19.query > test19-text.txt
+$QUERIER $LOCAL_PAGE_DIR test19.bin < test19.query > test19-binary.txt
+cat test19-text.txt
+if cmp -s test19-text.txt test19-binary.txt; then
+    echo "PASS: the binary index gives the same results"
 else
-    echo "FAIL: Memory leaks found in querier for 'test4.query'"
+    echo "FAIL: the binary index gives different results"
 fi
 echo
 
 # cleanup
-rm -f test*.query test*.txt valgrind_*.out
+rm -f test*.query test*.txt test19.bin valgrind_*.out $LOCAL_INDEX
+rm -rf $LOCAL_PAGE_DIR $LOCAL_SEG_DIR $LOCAL_HALF_DIR
 
-echo "All tests completed."
\ No newline at end of file
+echo "All tests completed."